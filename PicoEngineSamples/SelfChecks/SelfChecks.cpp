@@ -0,0 +1,875 @@
+//Checks and micro benchmarks of the engine internals. It's built as one translation unit with the engine so it can
+//reach the parts the header doesn't expose, see README.md.
+#include "../../picoengine.cpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+
+//The picoPNG the samples still carry, which the engine's copy has to decode the same as
+namespace OriginalPicoPng
+{
+#include "../PicoPiExample/picopng.cpp"
+}
+
+//The engine's picoPNG once more, built without SIMD, which the SIMD unfiltering has to match to the bit. picopng.h is
+//already included, so its declarations are brought in.
+#if defined(PICO_SIMD_SSE2) || defined(PICO_SIMD_NEON)
+#define SELFCHECKS_SIMD_PNG
+#endif
+#undef PICO_SIMD_SSE2
+#undef PICO_SIMD_NEON
+#ifndef PICO_NO_SIMD
+#define PICO_NO_SIMD
+#endif
+namespace ScalarPicoPng
+{
+	namespace pico
+	{
+		using ::pico::PixelFormat;
+		using ::pico::PixelRGBA8888;
+		using ::pico::PixelRGB888;
+		using ::pico::PixelRGB565;
+		using ::pico::DecodeBuffers;
+	}
+#include "../../picopng.cpp"
+}
+
+using namespace CogitareComputing;
+using namespace CogitareComputing::Pico;
+
+namespace SelfChecks
+{
+	static int s_failures = 0;
+
+	static void Report(const char* name, const bool passed)
+	{
+		printf("%s %s\n", passed ? "PASS" : "FAIL", name);
+		if (!passed)
+			++s_failures;
+	}
+
+	class Stopwatch
+	{
+	public:
+		Stopwatch()
+			:m_start(std::chrono::steady_clock::now())
+		{}
+
+		double Nanoseconds() const
+		{
+			return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - m_start).count();
+		}
+
+	private:
+		std::chrono::steady_clock::time_point m_start;
+	};
+
+	static float Random(const float range)
+	{
+		return (static_cast<float>(rand()) / RAND_MAX * 2.0f - 1.0f) * range;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	//The SIMD kernels against a double precision reference, then their speed
+	static void CheckMatrices()
+	{
+		srand(1);
+		double worstProduct = 0.0, worstInverse = 0.0;
+		for (int round = 0; round != 10000; ++round)
+		{
+			Mat4 a, b;
+			for (int i = 0; i != 16; ++i)
+			{
+				a.M[i / 4][i % 4] = Random(10.0f) + (i / 4 == i % 4 ? 40.0f : 0.0f); //Diagonally dominant, so it inverts well
+				b.M[i / 4][i % 4] = Random(10.0f);
+			}
+
+			const Mat4 product = a * b;
+			for (int i = 0; i != 16; ++i)
+			{
+				double expected = 0.0, magnitude = 0.0; //Of the terms, which bounds the rounding error
+				for (int k = 0; k != 4; ++k)
+				{
+					expected += static_cast<double>(a.M[i / 4][k]) * b.M[k][i % 4];
+					magnitude += fabs(static_cast<double>(a.M[i / 4][k]) * b.M[k][i % 4]);
+				}
+				worstProduct = std::max(worstProduct, fabs(expected - product.M[i / 4][i % 4]) / magnitude);
+			}
+
+			Mat4 inverse;
+			if (!Inverse(a, inverse))
+			{
+				worstInverse = 1.0;
+				continue;
+			}
+			const Mat4 identity = a * inverse;
+			for (int i = 0; i != 16; ++i)
+				worstInverse = std::max(worstInverse, fabs(identity.M[i / 4][i % 4] - (i / 4 == i % 4 ? 1.0 : 0.0)));
+		}
+		Mat4 singular = Mat4();
+		Mat4 unused;
+		Report("matrix multiply matches the reference", worstProduct < 1e-6);
+		Report("matrix inverse round trips to the identity", worstInverse < 1e-4);
+		Report("a singular matrix has no inverse", !Inverse(singular, unused));
+
+		Mat4 a, b;
+		for (int i = 0; i != 16; ++i)
+		{
+			a.M[i / 4][i % 4] = Random(0.1f);
+			b.M[i / 4][i % 4] = Random(0.1f);
+		}
+		const int count = 2000000;
+		Stopwatch multiplies;
+		for (int i = 0; i != count; ++i)
+		{
+			MatrixTools::MatrixMul(a, b, a);
+			if ((i & 1023) == 0)
+				a = b;
+		}
+		const double multiplyTime = multiplies.Nanoseconds() / count;
+		Stopwatch inverses;
+		for (int i = 0; i != count; ++i)
+		{
+			Inverse(b, a);
+			b.M[0][0] += a.M[1][1] * 1e-9f;
+		}
+		printf("     multiply %.1f ns, inverse %.1f ns (%g)\n", multiplyTime, inverses.Nanoseconds() / count, a.M[0][0]);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	static void CheckJobs(JobSystem& jobs)
+	{
+		std::vector<int> visits(100000, 0);
+		jobs.ParallelFor(visits.size(), [&visits](const size_t begin, const size_t end)
+		{
+			for (auto i = begin; i != end; ++i)
+				++visits[i];
+		}, 16);
+		Report("ParallelFor visits every index once", std::count(visits.begin(), visits.end(), 1) == static_cast<std::ptrdiff_t>(visits.size()));
+
+		std::atomic<size_t> nested(0);
+		jobs.ParallelFor(64, [&jobs, &nested](const size_t begin, const size_t end)
+		{
+			for (auto i = begin; i != end; ++i)
+				jobs.ParallelFor(1000, [&nested](const size_t innerBegin, const size_t innerEnd) { nested += innerEnd - innerBegin; });
+		});
+		Report("nested ParallelFor", nested.load() == 64000);
+
+		std::mutex orderMutex;
+		std::vector<int> order;
+		JobCounter first, second, third;
+		const auto record = [&orderMutex, &order](const int step) { std::lock_guard<std::mutex> lock(orderMutex); order.push_back(step); };
+		jobs.Run([&record]() { std::this_thread::sleep_for(std::chrono::milliseconds(20)); record(1); }, first);
+		jobs.RunAfter(first, [&record]() { record(2); }, second);
+		jobs.RunAfter(second, [&record]() { record(3); }, third);
+		jobs.Wait(third);
+		Report("RunAfter keeps the order", order.size() == 3 && order[0] == 1 && order[1] == 2 && order[2] == 3);
+
+		int early = 0;
+		for (int round = 0; round != 2000; ++round)
+		{
+			JobCounter reused, after;
+			std::atomic<int> stage(0);
+			jobs.Run([&stage]() { stage = 1; }, reused);
+			jobs.Wait(reused);
+			jobs.Run([&stage]() { std::this_thread::yield(); stage = 2; }, reused);
+			jobs.RunAfter(reused, [&stage, &early]() { early += stage.load() != 2 ? 1 : 0; }, after);
+			jobs.Wait(after);
+		}
+		Report("a reused counter starts no continuation early", early == 0);
+
+		bool caught = false;
+		try
+		{
+			jobs.ParallelFor(10000, [](const size_t begin, const size_t) { if (begin > 5000) throw std::runtime_error("job"); });
+		}
+		catch (std::runtime_error&)
+		{
+			caught = true;
+		}
+		Report("Wait rethrows a job's exception", caught);
+
+		const int count = 200000;
+		JobCounter empty;
+		Stopwatch emptyJobs;
+		for (int i = 0; i != count; ++i)
+			jobs.Run([]() {}, empty);
+		jobs.Wait(empty);
+		const double emptyTime = emptyJobs.Nanoseconds() / count;
+		Stopwatch parallelFors;
+		for (int i = 0; i != count / 10; ++i)
+			jobs.ParallelFor(64, [](const size_t, const size_t) {});
+		printf("     %zu threads: empty job %.0f ns, ParallelFor over 64 %.0f ns\n", jobs.ThreadCount(), emptyTime, parallelFors.Nanoseconds() / (count / 10));
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	//Busy work, then every fifth object spawns one and every seventh removes itself, as a parallel update may
+	class SpawningObject : public IGameObject
+	{
+	public:
+		SpawningObject(const int seed)
+			:IGameObject(MeshPtr())
+			, m_seed(seed)
+			, m_sum(0.0f)
+		{
+			SetThreadSafeUpdate(true);
+		}
+
+		int Seed() const
+		{
+			return m_seed;
+		}
+
+	protected:
+		bool UpdateState(const double) override
+		{
+			for (int i = 0; i != (m_seed % 13) * 300; ++i)
+				m_sum += sinf(i * 0.001f * m_seed);
+			if (m_seed % 5 == 0 && s_deferredMutations != nullptr)
+				s_deferredMutations->Add(std::make_shared<SpawningObject>(m_seed + 100000));
+			if (m_seed % 7 == 0 && s_deferredMutations != nullptr)
+				s_deferredMutations->Remove(Id());
+			SetPosition(Vec3(m_sum, 0.0f, 0.0f));
+			return true;
+		}
+
+	private:
+		int m_seed;
+		float m_sum;
+	};
+
+	//The deferred adds and removes, and the ids of the objects created, have to be the same for any thread count
+	static void CheckParallelUpdates()
+	{
+		std::vector<size_t> reference;
+		bool same = true;
+		for (size_t threads = 1; threads <= 8; threads *= 2)
+		{
+			JobSystem jobs(threads - 1);
+			std::unordered_map<size_t, GameObjectPtr> objects;
+			IGameObject::SceneGraph sceneGraph;
+			for (int i = 0; i != 2000; ++i)
+			{
+				auto object = std::make_shared<SpawningObject>(i);
+				objects[object->Id()] = object;
+				sceneGraph.Added(*object);
+			}
+			sceneGraph.Rebuild(objects);
+
+			std::vector<DeferredMutations> deferred;
+			Stopwatch frame;
+			sceneGraph.UpdateParallel(0.0, jobs, deferred);
+			sceneGraph.UpdateSerial(0.0);
+			const double frameTime = frame.Nanoseconds();
+
+			std::vector<size_t> mutations;
+			const auto firstId = s_nextGameObjectId.load();
+			for (auto& chunk : deferred)
+			{
+				for (const auto& mutation : chunk.m_mutations)
+				{
+					if (mutation.m_added)
+					{
+						IGameObject::SceneGraph::AssignId(*mutation.m_added);
+						mutations.push_back(mutation.m_added->Id() - firstId);
+						mutations.push_back(static_cast<SpawningObject&>(*mutation.m_added).Seed());
+					}
+					else
+						mutations.push_back(mutation.m_removedId - (firstId - 2000));
+				}
+			}
+			if (reference.empty())
+				reference = mutations;
+			same = same && mutations == reference;
+			printf("     %zu threads: %.2f ms for 2000 updates\n", threads, frameTime * 1e-6);
+		}
+		Report("parallel updates defer the same mutations and ids for any thread count", same && !reference.empty());
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	//A height field over a box away from the origin, with texture coordinates within 0..1 or tiling past it
+	static tinyobj::shape_t Grid(const int size, const float tiling)
+	{
+		tinyobj::shape_t shape;
+		for (int y = 0; y <= size; ++y)
+		{
+			for (int x = 0; x <= size; ++x)
+			{
+				shape.mesh.positions.push_back(1000.0f + x * 0.37f);
+				shape.mesh.positions.push_back(Random(3.0f));
+				shape.mesh.positions.push_back(-50.0f + y * 0.21f);
+				shape.mesh.texcoords.push_back(tiling * x / size);
+				shape.mesh.texcoords.push_back(tiling * y / size);
+			}
+		}
+		for (int y = 0; y != size; ++y)
+		{
+			for (int x = 0; x != size; ++x)
+			{
+				const unsigned int corner = y * (size + 1) + x;
+				const unsigned int quad[6] = { corner, corner + 1, corner + size + 1, corner + 1, corner + size + 2, corner + size + 1 };
+				shape.mesh.indices.insert(shape.mesh.indices.end(), quad, quad + 6);
+				shape.mesh.material_ids.push_back(-1);
+				shape.mesh.material_ids.push_back(-1);
+			}
+		}
+		return shape;
+	}
+
+	//Compact vertices decoded through the dequantisation matrix, the way GLES 3 and D3D read normalised shorts and
+	//the way GLES 2 does, against the float cook of the same mesh
+	static void CheckQuantisation()
+	{
+		srand(2);
+		const float tilings[2] = { 1.0f, 4.0f };
+		for (const float tiling : tilings)
+		{
+			const std::vector<tinyobj::shape_t> shapes(1, Grid(100, tiling));
+			const std::vector<tinyobj::material_t> materials;
+			std::vector<char> floats, compact;
+			PMeshFormat::Cook(shapes, materials, floats, false);
+			PMeshFormat::Cook(shapes, materials, compact, true);
+			const auto floatHeader = PMeshFormat::ReadHeader(&floats[0]);
+			const auto compactHeader = PMeshFormat::ReadHeader(&compact[0]);
+
+			Mat4 dequantisation = Mat4::Identity();
+			for (int i = 0; i != 3; ++i)
+			{
+				dequantisation.M[i][i] = compactHeader.m_positionScale[i];
+				dequantisation.M[i][3] = compactHeader.m_positionOffset[i];
+			}
+
+			const bool shortTexCoords = (compactHeader.m_vertexFormat & PMeshFormat::VertexFormat_ShortTexCoords) != 0;
+			double worstPosition[2] = { 0.0, 0.0 }, worstTexCoord = 0.0;
+			const size_t vertexCount = floatHeader.m_vertexDataSize / floatHeader.m_vertexStride;
+			for (size_t v = 0; v != vertexCount; ++v)
+			{
+				const auto* source = reinterpret_cast<const float*>(&floats[floatHeader.m_vertexDataOffset + v * floatHeader.m_vertexStride]);
+				const char* vertex = &compact[compactHeader.m_vertexDataOffset + v * compactHeader.m_vertexStride];
+				const auto* position = reinterpret_cast<const GLshort*>(vertex);
+				for (int convention = 0; convention != 2; ++convention)
+				{
+					Vec4 normalised(0.0f, 0.0f, 0.0f, 1.0f);
+					float* n = &normalised.X;
+					for (int i = 0; i != 3; ++i)
+						n[i] = convention == 0 ? std::max(position[i] / 32767.0f, -1.0f) : (2.0f * position[i] + 1.0f) / 65535.0f;
+					Vec4 decoded;
+					MatrixTools::Transform(dequantisation, normalised, decoded);
+					const float* d = &decoded.X;
+					for (int i = 0; i != 3; ++i)
+						worstPosition[convention] = std::max(worstPosition[convention], static_cast<double>(fabs(d[i] - source[i]) / compactHeader.m_positionScale[i]));
+				}
+
+				const char* texCoords = vertex + PMeshFormat::PositionSize(compactHeader.m_vertexFormat);
+				for (int i = 0; i != 2; ++i)
+				{
+					const float decoded = shortTexCoords ? reinterpret_cast<const GLushort*>(texCoords)[i] / 65535.0f : reinterpret_cast<const float*>(texCoords)[i];
+					worstTexCoord = std::max(worstTexCoord, static_cast<double>(fabs(decoded - source[3 + i])));
+				}
+			}
+
+			//A little float slack on top of the quantisation bounds
+			const double positionBound = PMeshFormat::s_shortPositionError + 1e-6;
+			const double texCoordBound = shortTexCoords ? 0.5 / 65535.0 + 1e-7 : 0.0;
+			printf("     tiling %g: vertex data %u -> %u bytes, worst position error %.2f steps (GLES 3) %.2f steps (GLES 2), texture coordinates %.2f steps\n",
+				tiling, floatHeader.m_vertexDataSize, compactHeader.m_vertexDataSize, worstPosition[0] * 32767.0, worstPosition[1] * 32767.0, worstTexCoord * 65535.0);
+			Report(tiling == 1.0f ? "compact positions and texture coordinates are within their error bounds" : "compact positions are within bounds and tiling texture coordinates stay floats",
+				worstPosition[0] <= positionBound && worstPosition[1] <= positionBound && worstTexCoord <= texCoordBound && shortTexCoords == (tiling == 1.0f)
+				&& PMeshFormat::Validate(&compact[0], compact.size()));
+
+			//An index past its shape's vertices
+			const auto* shape = reinterpret_cast<const PMeshFormat::Shape*>(&compact[compactHeader.m_shapeOffset]);
+			const auto* range = reinterpret_cast<const PMeshFormat::Range*>(&compact[compactHeader.m_rangeOffset]) + shape->m_firstRange;
+			reinterpret_cast<GLushort*>(&compact[range->m_indexOffset])[range->m_indexCount - 1] = static_cast<GLushort>(shape->m_vertexCount);
+			Report("a pmesh indexing past its vertices is rejected", !PMeshFormat::Validate(&compact[0], compact.size()));
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	//The same files read loose, from a pack and from a compressed pack
+	static void CheckFileSystems(const std::string& assets, JobSystem& jobs)
+	{
+		const char* names[] = { "picocube.obj", "picocube.mtl", "pico.png", "powerup.wav" };
+		BuildAssetPack(assets, "SelfChecks.pak", false);
+		BuildAssetPack(assets, "SelfChecks.lz4.pak", true);
+		const FileSystemPtr fileSystems[3] = { CreateDirectoryFileSystem(assets), CreatePackFileSystem("SelfChecks.pak", &jobs), CreatePackFileSystem("SelfChecks.lz4.pak", &jobs) };
+		const char* labels[3] = { "loose", "pack", "compressed pack" };
+
+		bool same = true;
+		for (const char* name : names)
+		{
+			const auto loose = fileSystems[0]->Open(name);
+			for (int i = 1; i != 3; ++i)
+			{
+				const auto packed = fileSystems[i]->Open(name);
+				same = same && loose && packed && loose->Size() == packed->Size() && std::memcmp(loose->Data(), packed->Data(), loose->Size()) == 0;
+			}
+		}
+		Report("packed files match the loose ones", same);
+
+		for (int i = 0; i != 3; ++i)
+		{
+			const int rounds = 200;
+			size_t bytes = 0, storedBytes = 0;
+			Stopwatch opens;
+			for (int round = 0; round != rounds; ++round)
+			{
+				for (const char* name : names)
+				{
+					const auto file = fileSystems[i]->Open(name);
+					bytes += file ? file->Size() : 0;
+					storedBytes += file ? file->StoredSize() : 0;
+				}
+			}
+			const double openCount = rounds * (sizeof(names) / sizeof(names[0]));
+			printf("     %s: %.1f us per open, %zu bytes stored as %zu\n", labels[i], opens.Nanoseconds() * 1e-3 / openCount, bytes / rounds, storedBytes / rounds);
+		}
+		std::remove("SelfChecks.pak");
+		std::remove("SelfChecks.lz4.pak");
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	static bool SameFloats(const std::vector<float>& a, const std::vector<float>& b)
+	{
+		return a.size() == b.size() && (a.empty() || std::memcmp(&a[0], &b[0], a.size() * sizeof(float)) == 0);
+	}
+
+	static bool SameShapes(const std::vector<tinyobj::shape_t>& a, const std::vector<tinyobj::shape_t>& b)
+	{
+		if (a.size() != b.size())
+			return false;
+		for (size_t i = 0; i != a.size(); ++i)
+		{
+			const auto& meshA = a[i].mesh;
+			const auto& meshB = b[i].mesh;
+			if (a[i].name != b[i].name || !SameFloats(meshA.positions, meshB.positions) || !SameFloats(meshA.normals, meshB.normals)
+				|| !SameFloats(meshA.texcoords, meshB.texcoords) || meshA.indices != meshB.indices || meshA.material_ids != meshB.material_ids)
+				return false;
+		}
+		return true;
+	}
+
+	//Past ObjParser::s_parallelSize, with relative and absolute indices, quads, faces without texture coordinates or
+	//normals, CRLF line ends and shapes split by g, o and usemtl
+	static std::string GeneratedObj()
+	{
+		srand(3);
+		std::string obj("mtllib picocube.mtl\n# A generated mesh\n");
+		char line[128];
+		int positions = 0;
+		for (int group = 0; group != 8; ++group)
+		{
+			if (group % 3 == 0)
+				obj += "g group" + std::to_string(group) + " extra\r\n";
+			else if (group % 3 == 1)
+				obj += "o object" + std::to_string(group) + "\n";
+			else
+				obj += "usemtl Material\n";
+			if (group % 5 == 0)
+				obj += "usemtl NoSuchMaterial\n";
+
+			for (int i = 0; i != 3000; ++i)
+			{
+				snprintf(line, sizeof(line), "v %.6f %.7e\t%g\nvt %.5f %.5f\n  vn %.4f %.4f %.4f\r\n",
+					Random(100.0f), Random(100.0f), Random(100.0f), Random(1.0f), Random(1.0f), Random(1.0f), Random(1.0f), Random(1.0f));
+				obj += line;
+			}
+			positions += 3000;
+
+			for (int i = 0; i != 4000; ++i)
+			{
+				const int layout = rand() % 4; //v, v/vt, v//vn or v/vt/vn
+				obj += "f";
+				for (int corner = 0; corner != (i % 5 == 0 ? 4 : 3); ++corner)
+				{
+					const int back = rand() % 3000;
+					const int index = rand() % 2 != 0 ? -1 - back : positions - back; //Every element has the same count
+					if (layout == 0)
+						snprintf(line, sizeof(line), " %d", index);
+					else if (layout == 1)
+						snprintf(line, sizeof(line), " %d/%d", index, index);
+					else if (layout == 2)
+						snprintf(line, sizeof(line), " %d//%d", index, index);
+					else
+						snprintf(line, sizeof(line), " %d/%d/%d", index, index, index);
+					obj += line;
+				}
+				obj += i % 11 == 0 ? " \r\n" : "\n";
+			}
+		}
+		return obj;
+	}
+
+	//ObjParser has to give what tinyobj::LoadObj gives, to the bit, parsed serially and in parallel chunks
+	static void CheckObjParser(const std::string& assets)
+	{
+		JobSystem jobs(3); //Files are only split into chunks when there's more than one thread
+		tinyobj::MaterialFileReader materialReader(assets + "/");
+		const auto cube = CreateDirectoryFileSystem(assets)->Open("picocube.obj");
+		const std::string files[2] = { cube ? std::string(cube->Data(), cube->Size()) : std::string(), GeneratedObj() };
+		const char* labels[2] = { "picocube.obj", "generated obj" };
+		for (int i = 0; i != 2; ++i)
+		{
+			const std::string& obj = files[i];
+			std::vector<tinyobj::shape_t> expected, serial, parallel;
+			std::vector<tinyobj::material_t> expectedMaterials, serialMaterials, parallelMaterials;
+			std::istringstream stream(obj);
+			Stopwatch tinyobjTime;
+			const auto expectedError = tinyobj::LoadObj(expected, expectedMaterials, stream, materialReader);
+			const double tinyobjNs = tinyobjTime.Nanoseconds();
+			Stopwatch serialTime;
+			const auto serialError = ObjParser::Parse(obj.data(), obj.size(), serial, serialMaterials, materialReader, nullptr);
+			const double serialNs = serialTime.Nanoseconds();
+			Stopwatch parallelTime;
+			const auto parallelError = ObjParser::Parse(obj.data(), obj.size(), parallel, parallelMaterials, materialReader, &jobs);
+			const double parallelNs = parallelTime.Nanoseconds();
+
+			printf("     %s, %zu bytes in %zu shapes: tinyobj %.2f ms, serial %.2f ms, %zu threads %.2f ms\n",
+				labels[i], obj.size(), expected.size(), tinyobjNs * 1e-6, serialNs * 1e-6, jobs.ThreadCount(), parallelNs * 1e-6);
+			Report(i == 0 ? "ObjParser matches tinyobj on picocube.obj" : "ObjParser matches tinyobj on a generated obj parsed in chunks",
+				!obj.empty() && serialError == expectedError && parallelError == expectedError && SameShapes(serial, expected) && SameShapes(parallel, expected)
+				&& serialMaterials.size() == expectedMaterials.size() && parallelMaterials.size() == expectedMaterials.size() && (i == 0 || obj.size() >= ObjParser::s_parallelSize));
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	//The lookup table inflater against the original picoPNG on pico.png, then on truncated and bit flipped copies of it
+	//where both have to fail or give the same pixels. Except for error 70, image data too short for its scanlines,
+	//which the original didn't check and read past the end of instead.
+	static void CheckPngInflate(const std::string& assets)
+	{
+		const auto file = CreateDirectoryFileSystem(assets)->Open("pico.png");
+		const std::vector<unsigned char> png = file ? std::vector<unsigned char>(file->Data(), file->Data() + file->Size()) : std::vector<unsigned char>();
+		std::vector<unsigned char> expected, decoded;
+		unsigned long expectedWidth = 0, expectedHeight = 0, width = 0, height = 0;
+		const int rounds = 100;
+		Stopwatch originalTime;
+		int originalError = 0;
+		for (int round = 0; round != rounds; ++round)
+			originalError |= OriginalPicoPng::pico::decodePNG(expected, expectedWidth, expectedHeight, png.empty() ? nullptr : &png[0], png.size());
+		const double originalNs = originalTime.Nanoseconds() / rounds;
+		Stopwatch tableTime;
+		int error = 0;
+		for (int round = 0; round != rounds; ++round)
+			error |= pico::decodePNG(decoded, width, height, png.empty() ? nullptr : &png[0], png.size());
+		const double tableNs = tableTime.Nanoseconds() / rounds;
+		printf("     pico.png %lux%lu: original %.2f ms, lookup tables %.2f ms\n", width, height, originalNs * 1e-6, tableNs * 1e-6);
+		Report("pico.png decodes to the same pixels as with the original picoPNG",
+			!png.empty() && originalError == 0 && error == 0 && decoded == expected && width == expectedWidth && height == expectedHeight);
+
+		int variants = 0, failed = 0, tooShort = 0, mismatches = 0;
+		const auto compare = [&](const std::vector<unsigned char>& variant)
+		{
+			std::vector<unsigned char> originalPixels, pixels;
+			unsigned long originalW = 0, originalH = 0, w = 0, h = 0;
+			const int original = OriginalPicoPng::pico::decodePNG(originalPixels, originalW, originalH, variant.empty() ? nullptr : &variant[0], variant.size());
+			const int current = pico::decodePNG(pixels, w, h, variant.empty() ? nullptr : &variant[0], variant.size());
+			++variants;
+			failed += current != 0 ? 1 : 0;
+			tooShort += current == 70 ? 1 : 0;
+			if (current != 70 && ((original == 0) != (current == 0) || (current == 0 && (pixels != originalPixels || w != originalW || h != originalH))))
+				++mismatches;
+		};
+		for (size_t i = 0; i != 128 && !png.empty(); ++i)
+		{
+			compare(std::vector<unsigned char>(png.begin(), png.begin() + png.size() * i / 128));
+			auto flipped = png;
+			flipped[(png.size() * i / 128 + i * 7) % png.size()] ^= static_cast<unsigned char>(1 << (i % 8));
+			compare(flipped);
+		}
+		printf("     %d truncated or bit flipped copies, %d rejected, %d of them with error 70\n", variants, failed, tooShort);
+		Report("damaged copies of pico.png fail or decode as with the original picoPNG", variants != 0 && mismatches == 0);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	static void AppendBigEndian(std::vector<unsigned char>& out, const uint32_t value)
+	{
+		for (int shift = 24; shift >= 0; shift -= 8)
+			out.push_back(static_cast<unsigned char>(value >> shift));
+	}
+
+	static void AppendChunk(std::vector<unsigned char>& png, const char* type, const std::vector<unsigned char>& data)
+	{
+		AppendBigEndian(png, static_cast<uint32_t>(data.size()));
+		const size_t start = png.size();
+		png.insert(png.end(), type, type + 4);
+		png.insert(png.end(), data.begin(), data.end());
+		uint32_t crc = 0xffffffff;
+		for (size_t i = start; i != png.size(); ++i)
+		{
+			crc ^= png[i];
+			for (int bit = 0; bit != 8; ++bit)
+				crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+		}
+		AppendBigEndian(png, crc ^ 0xffffffff);
+	}
+
+	//A PNG of random filtered lines, each with a random filter type, in stored deflate blocks since only the
+	//unfiltering is of interest. Adam7 images get the lines of every pass.
+	static std::vector<unsigned char> RandomPng(const uint32_t width, const uint32_t height, const unsigned char colourType, const unsigned char bitDepth, const bool adam7)
+	{
+		const unsigned long channels[7] = { 1, 0, 3, 1, 2, 0, 4 };
+		const unsigned long bpp = channels[colourType] * bitDepth;
+		const uint32_t passX[7] = { 0, 4, 0, 2, 0, 1, 0 }, passY[7] = { 0, 0, 4, 0, 2, 0, 1 }, stepX[7] = { 8, 8, 4, 4, 2, 2, 1 }, stepY[7] = { 8, 8, 8, 4, 4, 2, 2 };
+		std::vector<unsigned char> scanlines;
+		for (int pass = 0; pass != (adam7 ? 7 : 1); ++pass)
+		{
+			const uint32_t passWidth = adam7 ? (width + stepX[pass] - 1 - passX[pass]) / stepX[pass] : width;
+			const uint32_t passHeight = adam7 ? (height + stepY[pass] - 1 - passY[pass]) / stepY[pass] : height;
+			for (uint32_t y = 0; y != passHeight && passWidth != 0; ++y)
+			{
+				scanlines.push_back(static_cast<unsigned char>(rand() % 5));
+				for (size_t i = 0; i != (passWidth * bpp + 7) / 8; ++i)
+					scanlines.push_back(static_cast<unsigned char>(rand()));
+			}
+		}
+
+		std::vector<unsigned char> zlib;
+		zlib.push_back(0x78);
+		zlib.push_back(0x01);
+		for (size_t start = 0; start == 0 || start < scanlines.size(); start += 65535)
+		{
+			const size_t length = std::min<size_t>(65535, scanlines.size() - start);
+			zlib.push_back(start + length == scanlines.size() ? 1 : 0);
+			const unsigned char lengths[4] = { static_cast<unsigned char>(length), static_cast<unsigned char>(length >> 8), static_cast<unsigned char>(~length), static_cast<unsigned char>(~length >> 8) };
+			zlib.insert(zlib.end(), lengths, lengths + 4);
+			zlib.insert(zlib.end(), scanlines.begin() + start, scanlines.begin() + start + length);
+		}
+		uint32_t a = 1, b = 0;
+		for (const unsigned char byte : scanlines)
+		{
+			a = (a + byte) % 65521;
+			b = (b + a) % 65521;
+		}
+		AppendBigEndian(zlib, (b << 16) | a);
+
+		const unsigned char signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+		std::vector<unsigned char> png(signature, signature + 8), header;
+		AppendBigEndian(header, width);
+		AppendBigEndian(header, height);
+		const unsigned char rest[5] = { bitDepth, colourType, 0, 0, static_cast<unsigned char>(adam7 ? 1 : 0) };
+		header.insert(header.end(), rest, rest + 5);
+		AppendChunk(png, "IHDR", header);
+		AppendChunk(png, "IDAT", zlib);
+		AppendChunk(png, "IEND", std::vector<unsigned char>());
+		return png;
+	}
+
+	//Every way decodePNG can be called, with the SIMD build and with the scalar one
+	static bool SameDecodes(const std::vector<unsigned char>& png)
+	{
+		std::vector<unsigned char> simdPixels, scalarPixels;
+		unsigned long simdWidth = 0, simdHeight = 0, scalarWidth = 0, scalarHeight = 0;
+		for (int convert = 0; convert != 2; ++convert)
+		{
+			const int simdError = pico::decodePNG(simdPixels, simdWidth, simdHeight, &png[0], png.size(), convert != 0);
+			const int scalarError = ScalarPicoPng::pico::decodePNG(scalarPixels, scalarWidth, scalarHeight, &png[0], png.size(), convert != 0);
+			if (simdError != 0 || scalarError != 0 || simdPixels != scalarPixels || simdWidth != scalarWidth || simdHeight != scalarHeight)
+				return false;
+		}
+		const pico::PixelFormat formats[3] = { pico::PixelRGBA8888, pico::PixelRGB888, pico::PixelRGB565 };
+		pico::DecodeBuffers simdBuffers, scalarBuffers;
+		for (const auto format : formats)
+		{
+			const int simdError = pico::decodePNG(simdPixels, simdWidth, simdHeight, &png[0], png.size(), format, true, simdBuffers);
+			const int scalarError = ScalarPicoPng::pico::decodePNG(scalarPixels, scalarWidth, scalarHeight, &png[0], png.size(), format, true, scalarBuffers);
+			if (simdError != 0 || scalarError != 0 || simdPixels != scalarPixels)
+				return false;
+		}
+		return true;
+	}
+
+	//The SIMD unfiltering against the scalar code on random lines of every filter type for 3 and 4 byte pixels, and
+	//the pixel sizes that only get the vector Up filter, then on pico.png
+	static void CheckPngUnfilter(const std::string& assets)
+	{
+		srand(4);
+		const unsigned char colourTypes[4] = { 2, 6, 4, 0 }; //RGB and RGBA take every vector filter, grey with alpha and grey only Up
+		const uint32_t widths[5] = { 1, 2, 5, 17, 100 };
+		int images = 0, mismatches = 0;
+		for (const unsigned char colourType : colourTypes)
+		{
+			for (unsigned char bitDepth = 8; bitDepth <= 16; bitDepth += 8)
+			{
+				for (const uint32_t width : widths)
+				{
+					for (int adam7 = 0; adam7 != 2; ++adam7)
+					{
+						++images;
+						mismatches += SameDecodes(RandomPng(width, 23, colourType, bitDepth, adam7 != 0)) ? 0 : 1;
+					}
+				}
+			}
+		}
+		Report("SIMD unfiltering matches the scalar code on random lines", images != 0 && mismatches == 0);
+
+		const auto file = CreateDirectoryFileSystem(assets)->Open("pico.png");
+		const std::vector<unsigned char> png = file ? std::vector<unsigned char>(file->Data(), file->Data() + file->Size()) : std::vector<unsigned char>();
+		Report("pico.png decodes the same with SIMD unfiltering", !png.empty() && SameDecodes(png));
+
+		std::vector<unsigned char> pixels;
+		unsigned long width = 0, height = 0;
+		pico::DecodeBuffers buffers;
+		const int rounds = 100;
+		Stopwatch simdTime;
+		for (int round = 0; round != rounds && !png.empty(); ++round)
+			pico::decodePNG(pixels, width, height, &png[0], png.size(), pico::PixelRGBA8888, true, buffers);
+		const double simdNs = simdTime.Nanoseconds() / rounds;
+		Stopwatch scalarTime;
+		for (int round = 0; round != rounds && !png.empty(); ++round)
+			ScalarPicoPng::pico::decodePNG(pixels, width, height, &png[0], png.size(), pico::PixelRGBA8888, true, buffers);
+#ifdef SELFCHECKS_SIMD_PNG
+		const char* simd = "SIMD";
+#else
+		const char* simd = "scalar too, PICO_NO_SIMD is set";
+#endif
+		printf("     %d random images; pico.png %s %.2f ms, scalar %.2f ms\n", images, simd, simdNs * 1e-6, scalarTime.Nanoseconds() / rounds * 1e-6);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	static size_t CountFiles(const std::string& directory)
+	{
+		std::vector<std::string> files;
+		ListFiles(directory, "", files);
+		return files.size();
+	}
+
+	static void RemoveDirectory(const std::string& directory)
+	{
+		std::vector<std::string> files;
+		ListFiles(directory, "", files);
+		for (const auto& file : files)
+			std::remove((directory + "/" + file).c_str());
+		rmdir(directory.c_str());
+	}
+
+	//pico.png decoded cold and then found in a reopened cache, a damaged blob decoded again, and the least recently
+	//used blobs removed past the cap. Works in a directory of its own below the working directory.
+	static void CheckTextureDiskCache(const std::string& assets)
+	{
+		const std::string directory("SelfChecks.textures");
+		RemoveDirectory(directory);
+		mkdir(directory.c_str(), 0755);
+
+		const auto file = CreateDirectoryFileSystem(assets)->Open("pico.png");
+		const char* data = file ? file->Data() : nullptr;
+		const size_t size = file ? file->Size() : 0;
+		const auto format = pico::PixelRGBA8888;
+		const auto key = TextureDiskCache::Key(data, size, format, true);
+		std::vector<unsigned char> decoded;
+		unsigned long width = 0, height = 0;
+		pico::DecodeBuffers buffers;
+		const int rounds = 50;
+		Stopwatch coldTime;
+		int error = 0;
+		for (int round = 0; round != rounds; ++round)
+			error |= pico::decodePNG(decoded, width, height, reinterpret_cast<const unsigned char*>(data), size, format, true, buffers);
+		const double coldNs = coldTime.Nanoseconds() / rounds;
+		{
+			TextureDiskCache cache(directory, 1 << 20);
+			cache.Store(key, width, height, format, true, decoded);
+		}
+
+		{
+			TextureDiskCache cache(directory, 1 << 20);
+			bool found = true, same = true;
+			Stopwatch warmTime;
+			for (int round = 0; round != rounds; ++round)
+			{
+				MappedFile blob;
+				unsigned long blobWidth = 0, blobHeight = 0;
+				found = found && cache.Find(key, format, true, blob, blobWidth, blobHeight);
+				same = same && found && blobWidth == width && blobHeight == height && std::memcmp(TextureDiskCache::Pixels(blob), &decoded[0], decoded.size()) == 0;
+			}
+			printf("     pico.png: cold decode %.2f ms, warm from the disk cache %.3f ms\n", coldNs * 1e-6, warmTime.Nanoseconds() / rounds * 1e-6);
+			Report("a reopened disk cache finds pico.png with the pixels it was stored with", file && error == 0 && found && same);
+
+			{
+				std::vector<std::string> files;
+				ListFiles(directory, "", files);
+				for (const auto& name : files)
+				{
+					if (name.find(".ptex") == std::string::npos)
+						continue;
+					std::ofstream truncate((directory + "/" + name).c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+					truncate.write(reinterpret_cast<const char*>(&decoded[0]), 100);
+				}
+			}
+			MappedFile damaged;
+			unsigned long damagedWidth = 0, damagedHeight = 0;
+			Report("a damaged blob isn't used and is removed", !cache.Find(key, format, true, damaged, damagedWidth, damagedHeight) && CountFiles(directory) == 1); //Only the index
+		}
+
+		//Five textures where three fit, the first one used again before the fourth is stored
+		srand(5);
+		std::vector<std::vector<unsigned char>> textures(5, std::vector<unsigned char>(64 * 64 * 4));
+		std::vector<uint64_t> keys;
+		for (auto& pixels : textures)
+		{
+			for (auto& byte : pixels)
+				byte = static_cast<unsigned char>(rand());
+			keys.push_back(TextureDiskCache::Key(reinterpret_cast<const char*>(&pixels[0]), pixels.size(), format, true));
+		}
+		const uint64_t blobSize = sizeof(TextureBlobFormat::Header) + textures[0].size();
+		{
+			TextureDiskCache capped(directory, 3 * blobSize);
+			for (size_t i = 0; i != textures.size(); ++i)
+			{
+				capped.Store(keys[i], 64, 64, format, true, textures[i]);
+				if (i == 2)
+				{
+					MappedFile blob;
+					unsigned long w = 0, h = 0;
+					capped.Find(keys[0], format, true, blob, w, h);
+				}
+			}
+		}
+		TextureDiskCache reopened(directory, 3 * blobSize);
+		const bool kept[5] = { true, false, false, true, true };
+		bool evicted = true;
+		for (size_t i = 0; i != textures.size(); ++i)
+		{
+			MappedFile blob;
+			unsigned long w = 0, h = 0;
+			evicted = evicted && reopened.Find(keys[i], format, true, blob, w, h) == kept[i];
+		}
+		Report("past the cap the least recently used blobs are removed", evicted && CountFiles(directory) == 4); //The three kept and the index
+
+		RemoveDirectory(directory);
+	}
+}
+
+//SelfChecks [asset directory], the directory defaults to the Pi example's. Returns the number of failed checks.
+int main(int argc, char* argv[])
+{
+	const std::string assets = argc > 1 ? argv[1] : "../PicoPiExample";
+	JobSystem jobs(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+	try
+	{
+		SelfChecks::CheckMatrices();
+		SelfChecks::CheckJobs(jobs);
+		SelfChecks::CheckParallelUpdates();
+		SelfChecks::CheckQuantisation();
+		SelfChecks::CheckFileSystems(assets, jobs);
+		SelfChecks::CheckObjParser(assets);
+		SelfChecks::CheckPngInflate(assets);
+		SelfChecks::CheckPngUnfilter(assets);
+		SelfChecks::CheckTextureDiskCache(assets);
+	}
+	catch (EngineException& e)
+	{
+		printf("FAIL %s\n", reinterpret_cast<std::runtime_error&>(e).what());
+		++SelfChecks::s_failures;
+	}
+	return SelfChecks::s_failures;
+}
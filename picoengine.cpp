@@ -9,11 +9,54 @@
 #include "tiny_obj_loader.h"
 
 #include <cmath>
+#include <cfloat>
+#include <algorithm>
 #include <istream>
 #include <fstream>
 #include <unordered_map>
 #include <deque>
 #include <sstream>
+#include <iomanip>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cstddef>
+#include <climits>
+#include <limits>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef PICO_NO_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PICO_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM) || defined(_M_ARM64)
+#define PICO_SIMD_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+#ifdef _MSC_VER
+#define PICO_THREAD_LOCAL __declspec(thread)
+#else
+#define PICO_THREAD_LOCAL __thread
+#endif
+
+#if defined(PICO_PI) || defined(PICO_ANDROID)
+#define PICO_MMAP
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef PICO_WINDOWS
+#include <io.h>
+#endif
 
 #ifdef PICO_ANDROID
 #include "../android_native_app_glue.h"
@@ -56,33 +99,6 @@ namespace CogitareComputing
 
 		EngineException::~EngineException() throw() /*Throw specificier is for Pi compatibility*/
 		{}
-
-
-#ifdef PICO_ANDROID
-		template <class T>
-		void LoadAssetFile(SystemSpecificData& sData, std::vector<T>& buffer, const std::string& filename) //designed for loading files from hard disk in an std::vector
-		{
-			AAssetManager* assetManager = sData.m_androidWrapper->AndroidApp()->activity->assetManager;
-			AAsset* assetFile = AAssetManager_open(assetManager, filename.c_str(), AASSET_MODE_BUFFER);
-			if (!assetFile)
-			{
-				throw EngineException("Failed to open:" + filename);
-			}
-
-			uint8_t* data = (uint8_t*)AAsset_getBuffer(assetFile);
-			int32_t size = AAsset_getLength(assetFile);
-			if (data == NULL)
-			{
-				AAsset_close(assetFile);
-				throw EngineException("Failed to load:" + filename);
-			}
-
-			buffer.reserve(size);
-			buffer.assign(data, data + size);
-
-			AAsset_close(assetFile);
-		}
-#endif
 	}
 
 	namespace Pico
@@ -118,46 +134,289 @@ namespace CogitareComputing
 		}
 
 	}
+#if defined(PICO_SIMD_SSE2) || defined(PICO_SIMD_NEON)
+	namespace SimdTools
+	{
+		//The few operations the matrix kernels need, so the kernels themselves are written once for SSE2 and NEON.
+		//Loads and stores are unaligned since heap allocated Mat4s are not guaranteed to be 16 byte aligned.
+#ifdef PICO_SIMD_SSE2
+		typedef __m128 Float4;
+
+		inline Float4 Load(const float* p) { return _mm_loadu_ps(p); }
+		inline void Store(float* p, const Float4 v) { _mm_storeu_ps(p, v); }
+		inline Float4 Splat(const float f) { return _mm_set1_ps(f); }
+		inline Float4 Add(const Float4 a, const Float4 b) { return _mm_add_ps(a, b); }
+		inline Float4 Sub(const Float4 a, const Float4 b) { return _mm_sub_ps(a, b); }
+		inline Float4 Mul(const Float4 a, const Float4 b) { return _mm_mul_ps(a, b); }
+		inline Float4 MulAdd(const Float4 acc, const Float4 a, const float b) { return _mm_add_ps(acc, _mm_mul_ps(a, _mm_set1_ps(b))); }
+		inline Float4 SwapPairs(const Float4 v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)); }//[1 0 3 2]
+		inline Float4 SwapHalves(const Float4 v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)); }//[2 3 0 1]
+		inline float First(const Float4 v) { return _mm_cvtss_f32(v); }
+		inline void Transpose(Float4& r0, Float4& r1, Float4& r2, Float4& r3) { _MM_TRANSPOSE4_PS(r0, r1, r2, r3); }
+#else
+		typedef float32x4_t Float4;
+
+		inline Float4 Load(const float* p) { return vld1q_f32(p); }
+		inline void Store(float* p, const Float4 v) { vst1q_f32(p, v); }
+		inline Float4 Splat(const float f) { return vdupq_n_f32(f); }
+		inline Float4 Add(const Float4 a, const Float4 b) { return vaddq_f32(a, b); }
+		inline Float4 Sub(const Float4 a, const Float4 b) { return vsubq_f32(a, b); }
+		inline Float4 Mul(const Float4 a, const Float4 b) { return vmulq_f32(a, b); }
+		inline Float4 MulAdd(const Float4 acc, const Float4 a, const float b) { return vmlaq_n_f32(acc, a, b); }
+		inline Float4 SwapPairs(const Float4 v) { return vrev64q_f32(v); }//[1 0 3 2]
+		inline Float4 SwapHalves(const Float4 v) { return vextq_f32(v, v, 2); }//[2 3 0 1]
+		inline float First(const Float4 v) { return vgetq_lane_f32(v, 0); }
+		inline void Transpose(Float4& r0, Float4& r1, Float4& r2, Float4& r3)
+		{
+			const float32x4x2_t t01 = vtrnq_f32(r0, r1);
+			const float32x4x2_t t23 = vtrnq_f32(r2, r3);
+			r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+			r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+			r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+			r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+		}
+#endif
+	}
+#endif
+
 	namespace MatrixTools
 	{
-		template <int N>
-		void MatrixMul(const float(&lhs)[N][N], const float(&rhs)[N][N], float(&out)[N][N])
+		//out may be the same matrix as lhs or rhs
+		inline void MatrixMul(const Pico::Mat4& lhs, const Pico::Mat4& rhs, Pico::Mat4& out)
 		{
+#if defined(PICO_SIMD_SSE2) || defined(PICO_SIMD_NEON)
+			using namespace SimdTools;
+			const Float4 r0 = Load(rhs.M[0]);
+			const Float4 r1 = Load(rhs.M[1]);
+			const Float4 r2 = Load(rhs.M[2]);
+			const Float4 r3 = Load(rhs.M[3]);
+			for (unsigned int i = 0; i != 4; ++i)
+			{
+				Float4 row = Mul(r0, Splat(lhs.M[i][0]));
+				row = MulAdd(row, r1, lhs.M[i][1]);
+				row = MulAdd(row, r2, lhs.M[i][2]);
+				row = MulAdd(row, r3, lhs.M[i][3]);
+				Store(out.M[i], row);
+			}
+#else
+			Pico::Mat4 res;
 			for (unsigned int i = 0; i != 4; ++i)
 			{
 				for (unsigned int j = 0; j != 4; ++j)
 				{
-					out[i][j] = lhs[i][0] * rhs[0][j] +
-						lhs[i][1] * rhs[1][j] +
-						lhs[i][2] * rhs[2][j] +
-						lhs[i][3] * rhs[3][j];
+					res.M[i][j] = lhs.M[i][0] * rhs.M[0][j] +
+						lhs.M[i][1] * rhs.M[1][j] +
+						lhs.M[i][2] * rhs.M[2][j] +
+						lhs.M[i][3] * rhs.M[3][j];
 				}
 			}
+			out = res;
+#endif
+		}
+
+		inline void Transform(const Pico::Mat4& lhs, const Pico::Vec4& rhs, Pico::Vec4& out)
+		{
+#if defined(PICO_SIMD_SSE2) || defined(PICO_SIMD_NEON)
+			using namespace SimdTools;
+			Float4 c0 = Load(lhs.M[0]);
+			Float4 c1 = Load(lhs.M[1]);
+			Float4 c2 = Load(lhs.M[2]);
+			Float4 c3 = Load(lhs.M[3]);
+			Transpose(c0, c1, c2, c3);
+			Float4 res = Mul(c0, Splat(rhs.X));
+			res = MulAdd(res, c1, rhs.Y);
+			res = MulAdd(res, c2, rhs.Z);
+			res = MulAdd(res, c3, rhs.W);
+			Store(&out.X, res);
+#else
+			const Pico::Vec4 v = rhs;
+			out.X = lhs.M[0][0] * v.X + lhs.M[0][1] * v.Y + lhs.M[0][2] * v.Z + lhs.M[0][3] * v.W;
+			out.Y = lhs.M[1][0] * v.X + lhs.M[1][1] * v.Y + lhs.M[1][2] * v.Z + lhs.M[1][3] * v.W;
+			out.Z = lhs.M[2][0] * v.X + lhs.M[2][1] * v.Y + lhs.M[2][2] * v.Z + lhs.M[2][3] * v.W;
+			out.W = lhs.M[3][0] * v.X + lhs.M[3][1] * v.Y + lhs.M[3][2] * v.Z + lhs.M[3][3] * v.W;
+#endif
+		}
+
+		inline void Transpose(const Pico::Mat4& m, Pico::Mat4& out)
+		{
+#if defined(PICO_SIMD_SSE2) || defined(PICO_SIMD_NEON)
+			using namespace SimdTools;
+			Float4 r0 = Load(m.M[0]);
+			Float4 r1 = Load(m.M[1]);
+			Float4 r2 = Load(m.M[2]);
+			Float4 r3 = Load(m.M[3]);
+			SimdTools::Transpose(r0, r1, r2, r3);
+			Store(out.M[0], r0);
+			Store(out.M[1], r1);
+			Store(out.M[2], r2);
+			Store(out.M[3], r3);
+#else
+			Pico::Mat4 res;
+			for (unsigned int i = 0; i != 4; ++i)
+			{
+				for (unsigned int j = 0; j != 4; ++j)
+					res.M[i][j] = m.M[j][i];
+			}
+			out = res;
+#endif
 		}
 
-		template <int N>
-		void UpdateRotationMatrix(const Pico::Vec3& rot, float(&rotationMatrix)[N][N])
+		inline bool Inverse(const Pico::Mat4& m, Pico::Mat4& out)
 		{
-			float m_xrot[4][4];
-			float m_yrot[4][4];
-			float m_zrot[4][4];
+#if defined(PICO_SIMD_SSE2) || defined(PICO_SIMD_NEON)
+			//Cramer's rule on the transposed matrix, after Intel's "Streaming SIMD Extensions - Inverse of 4x4 Matrix".
+			//It only needs the pair and half swaps, which are single instructions on both SSE2 and NEON.
+			using namespace SimdTools;
+			Float4 row0 = Load(m.M[0]);
+			Float4 row1 = Load(m.M[1]);
+			Float4 row2 = Load(m.M[2]);
+			Float4 row3 = Load(m.M[3]);
+			SimdTools::Transpose(row0, row1, row2, row3);
+			row1 = SwapHalves(row1);
+			row3 = SwapHalves(row3);
+
+			Float4 tmp = SwapPairs(Mul(row2, row3));
+			Float4 minor0 = Mul(row1, tmp);
+			Float4 minor1 = Mul(row0, tmp);
+			tmp = SwapHalves(tmp);
+			minor0 = Sub(Mul(row1, tmp), minor0);
+			minor1 = SwapHalves(Sub(Mul(row0, tmp), minor1));
+
+			tmp = SwapPairs(Mul(row1, row2));
+			minor0 = Add(Mul(row3, tmp), minor0);
+			Float4 minor3 = Mul(row0, tmp);
+			tmp = SwapHalves(tmp);
+			minor0 = Sub(minor0, Mul(row3, tmp));
+			minor3 = SwapHalves(Sub(Mul(row0, tmp), minor3));
+
+			tmp = SwapPairs(Mul(SwapHalves(row1), row3));
+			row2 = SwapHalves(row2);
+			minor0 = Add(Mul(row2, tmp), minor0);
+			Float4 minor2 = Mul(row0, tmp);
+			tmp = SwapHalves(tmp);
+			minor0 = Sub(minor0, Mul(row2, tmp));
+			minor2 = SwapHalves(Sub(Mul(row0, tmp), minor2));
+
+			tmp = SwapPairs(Mul(row0, row1));
+			minor2 = Add(Mul(row3, tmp), minor2);
+			minor3 = Sub(Mul(row2, tmp), minor3);
+			tmp = SwapHalves(tmp);
+			minor2 = Sub(Mul(row3, tmp), minor2);
+			minor3 = Sub(minor3, Mul(row2, tmp));
+
+			tmp = SwapPairs(Mul(row0, row3));
+			minor1 = Sub(minor1, Mul(row2, tmp));
+			minor2 = Add(Mul(row1, tmp), minor2);
+			tmp = SwapHalves(tmp);
+			minor1 = Add(Mul(row2, tmp), minor1);
+			minor2 = Sub(minor2, Mul(row1, tmp));
+
+			tmp = SwapPairs(Mul(row0, row2));
+			minor1 = Add(Mul(row3, tmp), minor1);
+			minor3 = Sub(minor3, Mul(row1, tmp));
+			tmp = SwapHalves(tmp);
+			minor1 = Sub(minor1, Mul(row3, tmp));
+			minor3 = Add(Mul(row1, tmp), minor3);
+
+			Float4 det = Mul(row0, minor0);
+			det = Add(SwapHalves(det), det);
+			det = Add(SwapPairs(det), det);
+			const float determinant = First(det);
+			if (determinant == 0.0f)
+				return false;
+
+			const Float4 invDet = Splat(1.0f / determinant);
+			Store(out.M[0], Mul(invDet, minor0));
+			Store(out.M[1], Mul(invDet, minor1));
+			Store(out.M[2], Mul(invDet, minor2));
+			Store(out.M[3], Mul(invDet, minor3));
+			return true;
+#else
+			const float* a = &m.M[0][0];
+			float inv[16];
+			inv[0] = a[5] * a[10] * a[15] - a[5] * a[11] * a[14] - a[9] * a[6] * a[15] + a[9] * a[7] * a[14] + a[13] * a[6] * a[11] - a[13] * a[7] * a[10];
+			inv[4] = -a[4] * a[10] * a[15] + a[4] * a[11] * a[14] + a[8] * a[6] * a[15] - a[8] * a[7] * a[14] - a[12] * a[6] * a[11] + a[12] * a[7] * a[10];
+			inv[8] = a[4] * a[9] * a[15] - a[4] * a[11] * a[13] - a[8] * a[5] * a[15] + a[8] * a[7] * a[13] + a[12] * a[5] * a[11] - a[12] * a[7] * a[9];
+			inv[12] = -a[4] * a[9] * a[14] + a[4] * a[10] * a[13] + a[8] * a[5] * a[14] - a[8] * a[6] * a[13] - a[12] * a[5] * a[10] + a[12] * a[6] * a[9];
+			inv[1] = -a[1] * a[10] * a[15] + a[1] * a[11] * a[14] + a[9] * a[2] * a[15] - a[9] * a[3] * a[14] - a[13] * a[2] * a[11] + a[13] * a[3] * a[10];
+			inv[5] = a[0] * a[10] * a[15] - a[0] * a[11] * a[14] - a[8] * a[2] * a[15] + a[8] * a[3] * a[14] + a[12] * a[2] * a[11] - a[12] * a[3] * a[10];
+			inv[9] = -a[0] * a[9] * a[15] + a[0] * a[11] * a[13] + a[8] * a[1] * a[15] - a[8] * a[3] * a[13] - a[12] * a[1] * a[11] + a[12] * a[3] * a[9];
+			inv[13] = a[0] * a[9] * a[14] - a[0] * a[10] * a[13] - a[8] * a[1] * a[14] + a[8] * a[2] * a[13] + a[12] * a[1] * a[10] - a[12] * a[2] * a[9];
+			inv[2] = a[1] * a[6] * a[15] - a[1] * a[7] * a[14] - a[5] * a[2] * a[15] + a[5] * a[3] * a[14] + a[13] * a[2] * a[7] - a[13] * a[3] * a[6];
+			inv[6] = -a[0] * a[6] * a[15] + a[0] * a[7] * a[14] + a[4] * a[2] * a[15] - a[4] * a[3] * a[14] - a[12] * a[2] * a[7] + a[12] * a[3] * a[6];
+			inv[10] = a[0] * a[5] * a[15] - a[0] * a[7] * a[13] - a[4] * a[1] * a[15] + a[4] * a[3] * a[13] + a[12] * a[1] * a[7] - a[12] * a[3] * a[5];
+			inv[14] = -a[0] * a[5] * a[14] + a[0] * a[6] * a[13] + a[4] * a[1] * a[14] - a[4] * a[2] * a[13] - a[12] * a[1] * a[6] + a[12] * a[2] * a[5];
+			inv[3] = -a[1] * a[6] * a[11] + a[1] * a[7] * a[10] + a[5] * a[2] * a[11] - a[5] * a[3] * a[10] - a[9] * a[2] * a[7] + a[9] * a[3] * a[6];
+			inv[7] = a[0] * a[6] * a[11] - a[0] * a[7] * a[10] - a[4] * a[2] * a[11] + a[4] * a[3] * a[10] + a[8] * a[2] * a[7] - a[8] * a[3] * a[6];
+			inv[11] = -a[0] * a[5] * a[11] + a[0] * a[7] * a[9] + a[4] * a[1] * a[11] - a[4] * a[3] * a[9] - a[8] * a[1] * a[7] + a[8] * a[3] * a[5];
+			inv[15] = a[0] * a[5] * a[10] - a[0] * a[6] * a[9] - a[4] * a[1] * a[10] + a[4] * a[2] * a[9] + a[8] * a[1] * a[6] - a[8] * a[2] * a[5];
+
+			const float determinant = a[0] * inv[0] + a[1] * inv[4] + a[2] * inv[8] + a[3] * inv[12];
+			if (determinant == 0.0f)
+				return false;
 
-			m_xrot[0][0] = 1.0f; m_xrot[0][1] = 0.0f;		 m_xrot[0][2] = 0.0f;	        m_xrot[0][3] = 0.0f;
-			m_xrot[1][0] = 0.0f; m_xrot[1][1] = cosf(rot.X); m_xrot[1][2] = -sinf(rot.X);   m_xrot[1][3] = 0.0f;
-			m_xrot[2][0] = 0.0f; m_xrot[2][1] = sinf(rot.X); m_xrot[2][2] = cosf(rot.X);    m_xrot[2][3] = 0.0f;
-			m_xrot[3][0] = 0.0f; m_xrot[3][1] = 0.0f;		 m_xrot[3][2] = 0.0f;		    m_xrot[3][3] = 1.0f;
+			const float invDet = 1.0f / determinant;
+			for (unsigned int i = 0; i != 16; ++i)
+				out.M[i / 4][i % 4] = inv[i] * invDet;
+			return true;
+#endif
+		}
 
-			m_yrot[0][0] = cosf(rot.Y); m_yrot[0][1] = 0.0f; m_yrot[0][2] = -sinf(rot.Y); m_yrot[0][3] = 0.0f;
-			m_yrot[1][0] = 0.0f;		m_yrot[1][1] = 1.0f; m_yrot[1][2] = 0.0f;		  m_yrot[1][3] = 0.0f;
-			m_yrot[2][0] = sinf(rot.Y); m_yrot[2][1] = 0.0f; m_yrot[2][2] = cosf(rot.Y);  m_yrot[2][3] = 0.0f;
-			m_yrot[3][0] = 0.0f;		m_yrot[3][1] = 0.0f; m_yrot[3][2] = 0.0f;		  m_yrot[3][3] = 1.0f;
+		inline void SetIdentity(Pico::Mat4& m)
+		{
+			m.M[0][0] = 1.0f; m.M[0][1] = 0.0f; m.M[0][2] = 0.0f; m.M[0][3] = 0.0f;
+			m.M[1][0] = 0.0f; m.M[1][1] = 1.0f; m.M[1][2] = 0.0f; m.M[1][3] = 0.0f;
+			m.M[2][0] = 0.0f; m.M[2][1] = 0.0f; m.M[2][2] = 1.0f; m.M[2][3] = 0.0f;
+			m.M[3][0] = 0.0f; m.M[3][1] = 0.0f; m.M[3][2] = 0.0f; m.M[3][3] = 1.0f;
+		}
 
-			m_zrot[0][0] = cosf(rot.Z); m_zrot[0][1] = -sinf(rot.Z); m_zrot[0][2] = 0.0f; m_zrot[0][3] = 0.0f;
-			m_zrot[1][0] = sinf(rot.Z); m_zrot[1][1] = cosf(rot.Z);  m_zrot[1][2] = 0.0f; m_zrot[1][3] = 0.0f;
-			m_zrot[2][0] = 0.0f;	    m_zrot[2][1] = 0.0f;	     m_zrot[2][2] = 1.0f; m_zrot[2][3] = 0.0f;
-			m_zrot[3][0] = 0.0f;	    m_zrot[3][1] = 0.0f;	     m_zrot[3][2] = 0.0f; m_zrot[3][3] = 1.0f;
+		//Translation * rotation * scale, without the two full matrix multiplications.
+		//Relies on rotation being a pure rotation matrix (last row and column zero apart from M[3][3]).
+		inline void ComposeTRS(const Pico::Vec4& translation, const Pico::Mat4& rotation, const Pico::Vec4& scale, Pico::Mat4& out)
+		{
+#if defined(PICO_SIMD_SSE2) || defined(PICO_SIMD_NEON)
+			using namespace SimdTools;
+			const Float4 s = Load(&scale.X);
+			Store(out.M[0], Mul(Load(rotation.M[0]), s));
+			Store(out.M[1], Mul(Load(rotation.M[1]), s));
+			Store(out.M[2], Mul(Load(rotation.M[2]), s));
+			Store(out.M[3], Load(rotation.M[3]));
+#else
+			const float* s = &scale.X;
+			for (unsigned int i = 0; i != 4; ++i)
+			{
+				for (unsigned int j = 0; j != 3; ++j)
+					out.M[i][j] = rotation.M[i][j] * s[j];
+				out.M[i][3] = rotation.M[i][3];
+			}
+#endif
+			out.M[0][3] = translation.X;
+			out.M[1][3] = translation.Y;
+			out.M[2][3] = translation.Z;
+		}
 
-			float temp[4][4];
+		void UpdateRotationMatrix(const Pico::Vec3& rot, Pico::Mat4& rotationMatrix)
+		{
+			Pico::Mat4 m_xrot;
+			Pico::Mat4 m_yrot;
+			Pico::Mat4 m_zrot;
+
+			m_xrot.M[0][0] = 1.0f; m_xrot.M[0][1] = 0.0f;		 m_xrot.M[0][2] = 0.0f;	        m_xrot.M[0][3] = 0.0f;
+			m_xrot.M[1][0] = 0.0f; m_xrot.M[1][1] = cosf(rot.X); m_xrot.M[1][2] = -sinf(rot.X);   m_xrot.M[1][3] = 0.0f;
+			m_xrot.M[2][0] = 0.0f; m_xrot.M[2][1] = sinf(rot.X); m_xrot.M[2][2] = cosf(rot.X);    m_xrot.M[2][3] = 0.0f;
+			m_xrot.M[3][0] = 0.0f; m_xrot.M[3][1] = 0.0f;		 m_xrot.M[3][2] = 0.0f;		    m_xrot.M[3][3] = 1.0f;
+
+			m_yrot.M[0][0] = cosf(rot.Y); m_yrot.M[0][1] = 0.0f; m_yrot.M[0][2] = -sinf(rot.Y); m_yrot.M[0][3] = 0.0f;
+			m_yrot.M[1][0] = 0.0f;		m_yrot.M[1][1] = 1.0f; m_yrot.M[1][2] = 0.0f;		  m_yrot.M[1][3] = 0.0f;
+			m_yrot.M[2][0] = sinf(rot.Y); m_yrot.M[2][1] = 0.0f; m_yrot.M[2][2] = cosf(rot.Y);  m_yrot.M[2][3] = 0.0f;
+			m_yrot.M[3][0] = 0.0f;		m_yrot.M[3][1] = 0.0f; m_yrot.M[3][2] = 0.0f;		  m_yrot.M[3][3] = 1.0f;
+
+			m_zrot.M[0][0] = cosf(rot.Z); m_zrot.M[0][1] = -sinf(rot.Z); m_zrot.M[0][2] = 0.0f; m_zrot.M[0][3] = 0.0f;
+			m_zrot.M[1][0] = sinf(rot.Z); m_zrot.M[1][1] = cosf(rot.Z);  m_zrot.M[1][2] = 0.0f; m_zrot.M[1][3] = 0.0f;
+			m_zrot.M[2][0] = 0.0f;	    m_zrot.M[2][1] = 0.0f;	     m_zrot.M[2][2] = 1.0f; m_zrot.M[2][3] = 0.0f;
+			m_zrot.M[3][0] = 0.0f;	    m_zrot.M[3][1] = 0.0f;	     m_zrot.M[3][2] = 0.0f; m_zrot.M[3][3] = 1.0f;
+
+			Pico::Mat4 temp;
 			MatrixMul(m_yrot, m_xrot, temp);
 			MatrixMul(m_zrot, temp, rotationMatrix);
 		}
@@ -165,6 +424,400 @@ namespace CogitareComputing
 
 	}
 
+	namespace Pico
+	{
+		Mat4 Mat4::Identity()
+		{
+			Mat4 m;
+			MatrixTools::SetIdentity(m);
+			return m;
+		}
+
+		Mat4 operator*(const Mat4& lhs, const Mat4& rhs)
+		{
+			Mat4 res;
+			MatrixTools::MatrixMul(lhs, rhs, res);
+			return res;
+		}
+
+		Vec4 operator*(const Mat4& lhs, const Vec4& rhs)
+		{
+			Vec4 res;
+			MatrixTools::Transform(lhs, rhs, res);
+			return res;
+		}
+
+		Mat4 Transpose(const Mat4& m)
+		{
+			Mat4 res;
+			MatrixTools::Transpose(m, res);
+			return res;
+		}
+
+		bool Inverse(const Mat4& m, Mat4& inverse)
+		{
+			return MatrixTools::Inverse(m, inverse);
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	//Bounding spheres are kept in a Vec4, centre in X, Y, Z and radius in W. A negative radius is an empty sphere.
+	namespace BoundsTools
+	{
+		inline Pico::Vec4 EmptySphere()
+		{
+			return Pico::Vec4(0.0f, 0.0f, 0.0f, -1.0f);
+		}
+
+		//Centre of the bounding box and the distance to the farthest point, a lot tighter than the box diagonal for most meshes
+		Pico::Vec4 SphereFromPoints(const float* points, const size_t count, const size_t stride)
+		{
+			float minP[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+			float maxP[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			for (size_t i = 0; i != count; ++i)
+			{
+				for (unsigned int j = 0; j != 3; ++j)
+				{
+					minP[j] = std::min(minP[j], points[i * stride + j]);
+					maxP[j] = std::max(maxP[j], points[i * stride + j]);
+				}
+			}
+			if (minP[0] > maxP[0])
+				return EmptySphere();
+
+			Pico::Vec4 sphere((minP[0] + maxP[0]) * 0.5f, (minP[1] + maxP[1]) * 0.5f, (minP[2] + maxP[2]) * 0.5f, 0.0f);
+			float radiusSq = 0.0f;
+			for (size_t i = 0; i != count; ++i)
+			{
+				const float* point = points + i * stride;
+				const float dx = point[0] - sphere.X;
+				const float dy = point[1] - sphere.Y;
+				const float dz = point[2] - sphere.Z;
+				radiusSq = std::max(radiusSq, dx * dx + dy * dy + dz * dz);
+			}
+			sphere.W = sqrtf(radiusSq);
+			return sphere;
+		}
+
+		//The radius grows with the largest axis scale of the matrix, so this stays conservative for non uniform scaling
+		Pico::Vec4 TransformSphere(const Pico::Mat4& m, const Pico::Vec4& sphere)
+		{
+			if (sphere.W < 0.0f)
+				return sphere;
+
+			Pico::Vec4 centre;
+			MatrixTools::Transform(m, Pico::Vec4(sphere.X, sphere.Y, sphere.Z, 1.0f), centre);
+			float scaleSq = 0.0f;
+			for (unsigned int col = 0; col != 3; ++col)
+				scaleSq = std::max(scaleSq, m.M[0][col] * m.M[0][col] + m.M[1][col] * m.M[1][col] + m.M[2][col] * m.M[2][col]);
+			centre.W = sphere.W * sqrtf(scaleSq);
+			return centre;
+		}
+
+		Pico::Vec4 MergeSpheres(const Pico::Vec4& a, const Pico::Vec4& b)
+		{
+			if (b.W < 0.0f)
+				return a;
+			if (a.W < 0.0f)
+				return b;
+
+			const float dx = b.X - a.X;
+			const float dy = b.Y - a.Y;
+			const float dz = b.Z - a.Z;
+			const float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+			if (distance + b.W <= a.W)
+				return a;
+			if (distance + a.W <= b.W)
+				return b;
+
+			const float radius = (distance + a.W + b.W) * 0.5f;
+			const float t = (radius - a.W) / distance;
+			return Pico::Vec4(a.X + dx * t, a.Y + dy * t, a.Z + dz * t, radius);
+		}
+
+		//The six clip planes of a projection (or view projection) matrix, normalised and pointing inwards
+		void ExtractFrustum(const Pico::Mat4& m, Pico::Vec4 planes[6])
+		{
+			for (unsigned int axis = 0; axis != 3; ++axis)
+			{
+				for (unsigned int side = 0; side != 2; ++side)
+				{
+					const float sign = side == 0 ? 1.0f : -1.0f;
+					Pico::Vec4& plane = planes[axis * 2 + side];
+					plane.X = m.M[3][0] + sign * m.M[axis][0];
+					plane.Y = m.M[3][1] + sign * m.M[axis][1];
+					plane.Z = m.M[3][2] + sign * m.M[axis][2];
+					plane.W = m.M[3][3] + sign * m.M[axis][3];
+
+					const float length = sqrtf(plane.X * plane.X + plane.Y * plane.Y + plane.Z * plane.Z);
+					if (length > 0.0f)
+					{
+						plane.X /= length;
+						plane.Y /= length;
+						plane.Z /= length;
+						plane.W /= length;
+					}
+				}
+			}
+		}
+
+		bool OutsideFrustum(const Pico::Vec4 planes[6], const Pico::Vec4& sphere)
+		{
+			if (sphere.W < 0.0f)
+				return true;
+
+			for (unsigned int i = 0; i != 6; ++i)
+			{
+				const Pico::Vec4& plane = planes[i];
+				if (plane.X * sphere.X + plane.Y * sphere.Y + plane.Z * sphere.Z + plane.W < -sphere.W)
+					return true;
+			}
+			return false;
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	//Orders the triangles of an indexed list for the post transform vertex cache, after Tom Forsyth's "Linear-Speed
+	//Vertex Cache Optimisation". Indices are 16 bit, as in the cooked meshes.
+	namespace IndexOrderTools
+	{
+		const size_t s_fifoSize = 16; //What ACMR is measured against, about what VideoCore IV and Mali hold
+		const size_t s_scoringCacheSize = 32; //Modelled by the optimiser, a larger LRU than the hardware does well on FIFOs too
+
+		//Vertices a FIFO cache of cacheSize has to transform for the list. Divided by the triangles it's the average
+		//cache miss ratio (ACMR): 3 at worst, and around 0.6 for a good order of a regular grid.
+		size_t CacheMisses(const GLushort* indices, const size_t count, const size_t cacheSize)
+		{
+			std::vector<int> fifo(cacheSize, -1);
+			size_t next = 0, misses = 0;
+			for (size_t i = 0; i != count; ++i)
+			{
+				if (std::find(fifo.begin(), fifo.end(), indices[i]) != fifo.end())
+					continue;
+
+				fifo[next] = indices[i];
+				next = (next + 1) % cacheSize;
+				++misses;
+			}
+			return misses;
+		}
+
+		float VertexScore(const int cachePosition, const unsigned int remainingTriangles)
+		{
+			if (remainingTriangles == 0)
+				return -1.0f;
+
+			float score = 0.0f;
+			if (cachePosition >= 0)
+			{
+				//The triangle just drawn gets a fixed score so its vertices aren't favoured for the very next one
+				if (cachePosition < 3)
+					score = 0.75f;
+				else
+					score = powf(1.0f - (cachePosition - 3) / static_cast<float>(s_scoringCacheSize - 3), 1.5f);
+			}
+			//Vertices with few triangles left are finished first, so they leave the cache for good
+			return score + 2.0f / sqrtf(static_cast<float>(remainingTriangles));
+		}
+
+		//Reorders the triangles in place, vertexCount is one past the largest index
+		void OptimizeTriangleOrder(GLushort* indices, const size_t count, const size_t vertexCount)
+		{
+			const size_t triangleCount = count / 3;
+			if (triangleCount < 2)
+				return;
+
+			//Triangles of each vertex, the ones still to draw are kept in front
+			std::vector<unsigned int> remaining(vertexCount, 0), firstTriangle(vertexCount + 1, 0);
+			for (size_t i = 0; i != triangleCount * 3; ++i)
+				++remaining[indices[i]];
+			for (size_t v = 0; v != vertexCount; ++v)
+				firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+			std::vector<unsigned int> vertexTriangles(triangleCount * 3);
+			std::vector<unsigned int> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+			for (size_t i = 0; i != triangleCount * 3; ++i)
+				vertexTriangles[filled[indices[i]]++] = static_cast<unsigned int>(i / 3);
+
+			std::vector<int> cachePosition(vertexCount, -1);
+			std::vector<float> vertexScore(vertexCount);
+			for (size_t v = 0; v != vertexCount; ++v)
+				vertexScore[v] = VertexScore(-1, remaining[v]);
+
+			std::vector<float> triangleScore(triangleCount);
+			std::vector<bool> drawn(triangleCount, false);
+			for (size_t t = 0; t != triangleCount; ++t)
+				triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+			std::vector<GLushort> ordered;
+			ordered.reserve(triangleCount * 3);
+			std::vector<int> cache, nextCache;
+			cache.reserve(s_scoringCacheSize + 3);
+			nextCache.reserve(s_scoringCacheSize + 3);
+			int best = static_cast<int>(std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin());
+			size_t scan = 0;
+			while (ordered.size() != triangleCount * 3)
+			{
+				//Once the cache has nothing left to offer, carry on with the first triangle not drawn yet. Searching
+				//for the best one each time would be quadratic.
+				if (best < 0)
+				{
+					while (drawn[scan])
+						++scan;
+					best = static_cast<int>(scan);
+				}
+
+				const GLushort* triangle = indices + best * 3;
+				drawn[best] = true;
+				nextCache.assign(triangle, triangle + 3);
+				for (int i = 0; i != 3; ++i)
+				{
+					const GLushort v = triangle[i];
+					ordered.push_back(v);
+					--remaining[v];
+					auto* first = &vertexTriangles[firstTriangle[v]];
+					std::swap(*std::find(first, first + remaining[v] + 1, static_cast<unsigned int>(best)), first[remaining[v]]);
+				}
+				for (const int v : cache)
+				{
+					if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+						nextCache.push_back(v);
+				}
+				for (size_t i = s_scoringCacheSize; i < nextCache.size(); ++i)
+				{
+					cachePosition[nextCache[i]] = -1;
+					vertexScore[nextCache[i]] = VertexScore(-1, remaining[nextCache[i]]);
+				}
+				nextCache.resize(std::min(nextCache.size(), s_scoringCacheSize));
+				cache.swap(nextCache);
+
+				for (size_t i = 0; i != cache.size(); ++i)
+				{
+					cachePosition[cache[i]] = static_cast<int>(i);
+					vertexScore[cache[i]] = VertexScore(static_cast<int>(i), remaining[cache[i]]);
+				}
+
+				//Only triangles of cached vertices changed score, the best next one is among them
+				best = -1;
+				float bestScore = -1.0f;
+				for (const int v : cache)
+				{
+					for (unsigned int i = firstTriangle[v]; i != firstTriangle[v] + remaining[v]; ++i)
+					{
+						const unsigned int t = vertexTriangles[i];
+						const float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+						triangleScore[t] = score;
+						if (score > bestScore)
+						{
+							bestScore = score;
+							best = static_cast<int>(t);
+						}
+					}
+				}
+			}
+			std::copy(ordered.begin(), ordered.end(), indices);
+		}
+
+		//Sorts the runs between cache restarts of an optimised order so outward facing ones are drawn first, after
+		//Sander, Nehab and Barczak's "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw". A run starts
+		//where a triangle misses the cache with all three vertices, so moving runs around costs few extra misses.
+		//Kept only when the miss ratio grows by at most maxAcmrGrowth, returns whether it was.
+		bool ReduceOverdraw(GLushort* indices, const size_t count, const float* positions, const size_t stride, const float maxAcmrGrowth)
+		{
+			const size_t triangleCount = count / 3;
+			std::vector<size_t> runStarts;
+			std::vector<int> fifo(s_fifoSize, -1);
+			size_t next = 0;
+			for (size_t t = 0; t != triangleCount; ++t)
+			{
+				int misses = 0;
+				for (size_t i = t * 3; i != t * 3 + 3; ++i)
+				{
+					if (std::find(fifo.begin(), fifo.end(), indices[i]) != fifo.end())
+						continue;
+					fifo[next] = indices[i];
+					next = (next + 1) % s_fifoSize;
+					++misses;
+				}
+				if (misses == 3)
+					runStarts.push_back(t);
+			}
+			if (runStarts.size() < 2)
+				return false;
+			runStarts.push_back(triangleCount);
+
+			//Area weighted centroid and normal of each run, facing away from the centroid of all of them sorts first
+			struct Run
+			{
+				size_t m_first;
+				size_t m_end;
+				float m_centroid[3];
+				float m_normal[3];
+				float m_area;
+				float m_key;
+			};
+			std::vector<Run> runs(runStarts.size() - 1);
+			float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+			float meshArea = 0.0f;
+			for (size_t r = 0; r != runs.size(); ++r)
+			{
+				Run& run = runs[r];
+				run.m_first = runStarts[r];
+				run.m_end = runStarts[r + 1];
+				std::fill(run.m_centroid, run.m_centroid + 3, 0.0f);
+				std::fill(run.m_normal, run.m_normal + 3, 0.0f);
+				run.m_area = 0.0f;
+				for (size_t t = run.m_first; t != run.m_end; ++t)
+				{
+					const float* a = positions + indices[t * 3] * stride;
+					const float* b = positions + indices[t * 3 + 1] * stride;
+					const float* c = positions + indices[t * 3 + 2] * stride;
+					const float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+					const float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+					const float normal[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+					const float area = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+					for (int i = 0; i != 3; ++i)
+					{
+						run.m_centroid[i] += (a[i] + b[i] + c[i]) * area / 3.0f;
+						run.m_normal[i] += normal[i];
+					}
+					run.m_area += area;
+				}
+				for (int i = 0; i != 3; ++i)
+					meshCentroid[i] += run.m_centroid[i];
+				meshArea += run.m_area;
+			}
+			if (meshArea <= 0.0f)
+				return false;
+
+			for (auto& run : runs)
+			{
+				run.m_key = 0.0f;
+				if (run.m_area > 0.0f)
+				{
+					for (int i = 0; i != 3; ++i)
+						run.m_key += (run.m_centroid[i] / run.m_area - meshCentroid[i] / meshArea) * run.m_normal[i];
+					run.m_key /= run.m_area;
+				}
+			}
+			std::stable_sort(runs.begin(), runs.end(), [](const Run& a, const Run& b) { return a.m_key > b.m_key; });
+
+			std::vector<GLushort> sorted;
+			sorted.reserve(triangleCount * 3);
+			for (const auto& run : runs)
+				sorted.insert(sorted.end(), indices + run.m_first * 3, indices + run.m_end * 3);
+
+			const size_t before = CacheMisses(indices, triangleCount * 3, s_fifoSize);
+			const size_t after = CacheMisses(&sorted[0], sorted.size(), s_fifoSize);
+			if (after > before * maxAcmrGrowth)
+				return false;
+
+			std::copy(sorted.begin(), sorted.end(), indices);
+			return true;
+		}
+	}
+
 	//-------------------------------------------------------------------------------------------------
 
 	namespace ShaderTools
@@ -421,6 +1074,18 @@ namespace CogitareComputing
 			}
 
 
+			//The context is current on one thread at a time, the engine moves it over to its render thread and back
+			void MakeCurrent()
+			{
+				if (eglMakeCurrent(m_display, m_surface, m_surface, m_context) == EGL_FALSE)
+					throw EngineException("Unable to eglMakeCurrent");
+			}
+
+			void ReleaseCurrent()
+			{
+				eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			}
+
 			~EGLSupport()
 			{
 				DestroyEGL();
@@ -867,6 +1532,18 @@ namespace CogitareComputing
 				eglSwapBuffers(m_display, m_surface);
 			}
 
+			//The context is current on one thread at a time, the engine moves it over to its render thread and back
+			void MakeCurrent()
+			{
+				if (eglMakeCurrent(m_display, m_surface, m_surface, m_context) == EGL_FALSE)
+					throw EngineException("Unable to eglMakeCurrent");
+			}
+
+			void ReleaseCurrent()
+			{
+				eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			}
+
 			~EGLSupport()
 			{
 				DestroyEGL();
@@ -1100,6 +1777,18 @@ namespace CogitareComputing
 				eglSwapBuffers(m_display, m_surface);
 			}
 
+			//The context is current on one thread at a time, the engine moves it over to its render thread and back
+			void MakeCurrent()
+			{
+				if (eglMakeCurrent(m_display, m_surface, m_surface, m_context) == EGL_FALSE)
+					throw EngineException("Unable to eglMakeCurrent");
+			}
+
+			void ReleaseCurrent()
+			{
+				eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			}
+
 			~EGLSupport()
 			{
 				DestroyEGL();
@@ -1340,6 +2029,18 @@ namespace CogitareComputing
 				eglSwapBuffers(m_display, m_surface);
 			}
 
+			//The context is current on one thread at a time, the engine moves it over to its render thread and back
+			void MakeCurrent()
+			{
+				if (eglMakeCurrent(m_display, m_surface, m_surface, m_context) == EGL_FALSE)
+					throw EngineException("Unable to eglMakeCurrent");
+			}
+
+			void ReleaseCurrent()
+			{
+				eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			}
+
 			~EGLSupport()
 			{
 				DestroyEGL();
@@ -1409,30 +2110,489 @@ namespace CogitareComputing
 	//-------------------------------------------------------------------------------------------------
 	namespace Pico
 	{
-		IMesh::IMesh()
-			:m_meshId(s_meshIdCnt++)
+		struct JobItem;
+
+		struct JobCounter::State
 		{
-		}
+			State()
+				:m_pending(0)
+			{}
 
-		IMesh::~IMesh()
+			std::atomic<size_t> m_pending;
+			std::mutex m_mutex;
+			std::vector<JobItem*> m_continuations; //Started when m_pending reaches zero
+			std::exception_ptr m_error;
+		};
+
+		struct JobItem
+		{
+			JobSystem::Job m_job;
+			std::shared_ptr<JobCounter::State> m_counter;
+		};
+
+		JobCounter::JobCounter()
+			:m_state(std::make_shared<State>())
 		{
 		}
 
-		size_t IMesh::Id() const
+		bool JobCounter::IsDone() const
 		{
-			return m_meshId;
+			return m_state->m_pending.load() == 0;
 		}
 
-		size_t IMesh::s_meshIdCnt = 0;
+		//Chase-Lev deque, in the formulation for C11 atomics by Le, Pop, Cohen and Zappa Nardelli. Only the owning
+		//thread pushes and pops at the bottom, any thread may steal from the top. The indices are unsigned and only
+		//ever compared through their difference, so wrapping around is harmless. Fixed capacity, Push fails when full.
+		class WorkStealingDeque
+		{
+		public:
+			WorkStealingDeque()
+				:m_top(0)
+				, m_bottom(0)
+			{
+				for (auto& item : m_items)
+					item.store(nullptr, std::memory_order_relaxed);
+			}
 
-		//-------------------------------------------------------------------------------------------------
+			bool Push(JobItem* item)
+			{
+				const size_t bottom = m_bottom.load(std::memory_order_relaxed);
+				const size_t top = m_top.load(std::memory_order_acquire);
+				if (bottom - top >= s_capacity)
+					return false;
 
-		struct IGameObject::RenderDetails
-		{
-			RenderDetails(const RenderDetails&) = delete;
+				m_items[bottom & (s_capacity - 1)].store(item, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_release);
+				m_bottom.store(bottom + 1, std::memory_order_relaxed);
+				return true;
+			}
 
-			GLuint m_program;
-			GLuint m_positionLoc;
+			JobItem* Pop()
+			{
+				const size_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+				m_bottom.store(bottom, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				size_t top = m_top.load(std::memory_order_relaxed);
+				if (static_cast<std::ptrdiff_t>(bottom - top) < 0)
+				{
+					m_bottom.store(bottom + 1, std::memory_order_relaxed);
+					return nullptr;
+				}
+
+				JobItem* item = m_items[bottom & (s_capacity - 1)].load(std::memory_order_relaxed);
+				if (top == bottom)
+				{
+					//The last one, the thieves may be after it as well
+					if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+						item = nullptr;
+					m_bottom.store(bottom + 1, std::memory_order_relaxed);
+				}
+				return item;
+			}
+
+			JobItem* Steal()
+			{
+				size_t top = m_top.load(std::memory_order_acquire);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				const size_t bottom = m_bottom.load(std::memory_order_acquire);
+				if (static_cast<std::ptrdiff_t>(bottom - top) <= 0)
+					return nullptr;
+
+				JobItem* item = m_items[top & (s_capacity - 1)].load(std::memory_order_relaxed);
+				if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+					return nullptr; //Lost to another thief or the owner
+				return item;
+			}
+
+			//Only meaningful on the owning thread
+			bool IsEmpty() const
+			{
+				return static_cast<std::ptrdiff_t>(m_bottom.load(std::memory_order_relaxed) - m_top.load(std::memory_order_relaxed)) <= 0;
+			}
+
+		private:
+			static const size_t s_capacity = 4096; //Power of two
+
+			std::atomic<size_t> m_top;
+			char m_padding[64]; //Thieves hammer m_top, keep it off the owner's cache line
+			std::atomic<size_t> m_bottom;
+			std::atomic<JobItem*> m_items[s_capacity];
+		};
+
+		struct JobSystem::Impl
+		{
+			explicit Impl(const size_t workerCount)
+				:m_owner(std::this_thread::get_id())
+				, m_queued(0)
+				, m_sleepers(0)
+				, m_waiters(0)
+				, m_injectedCount(0)
+				, m_quit(false)
+			{
+				for (size_t i = 0; i != workerCount + 1; ++i)
+					m_deques.push_back(std::unique_ptr<WorkStealingDeque>(new WorkStealingDeque()));
+
+				for (size_t i = 0; i != workerCount; ++i)
+					m_threads.push_back(std::thread([this, i]() { WorkerLoop(i + 1); }));
+			}
+
+			~Impl()
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_quit = true;
+				}
+				m_wake.notify_all();
+				for (auto& thread : m_threads)
+					thread.join();
+
+				//Jobs nobody waited for
+				for (auto& deque : m_deques)
+				{
+					while (JobItem* item = deque->Steal())
+						delete item;
+				}
+				for (auto item : m_injected)
+					delete item;
+			}
+
+			//A worker only ever belongs to one job system, the creating thread is told by its id so it can own slot 0
+			//of several job systems at once
+			size_t Slot() const
+			{
+				if (s_jobSystem == this)
+					return s_jobSlot;
+				return std::this_thread::get_id() == m_owner ? 0 : s_noSlot;
+			}
+
+			void Schedule(JobItem* item)
+			{
+				++m_queued; //Before the push, so a thief never sees the job without the count
+				const auto slot = Slot();
+				if (slot == s_noSlot || !m_deques[slot]->Push(item))
+				{
+					std::lock_guard<std::mutex> lock(m_injectMutex);
+					m_injected.push_back(item);
+					++m_injectedCount;
+				}
+
+				if (m_sleepers.load() != 0)
+				{
+					//Taking the lock orders this against a worker that is about to wait
+					{
+						std::lock_guard<std::mutex> lock(m_mutex);
+					}
+					m_wake.notify_one();
+				}
+			}
+
+			JobItem* TakeJob(const size_t slot)
+			{
+				JobItem* item = slot != s_noSlot ? m_deques[slot]->Pop() : nullptr;
+				if (item == nullptr && m_injectedCount.load() != 0)
+				{
+					std::lock_guard<std::mutex> lock(m_injectMutex);
+					if (!m_injected.empty())
+					{
+						item = m_injected.front();
+						m_injected.pop_front();
+						--m_injectedCount;
+					}
+				}
+
+				const auto dequeCount = m_deques.size();
+				for (size_t i = 1; item == nullptr && i <= dequeCount; ++i)
+				{
+					const auto victim = (slot == s_noSlot ? 0 : slot) + i;
+					if (victim % dequeCount != slot)
+						item = m_deques[victim % dequeCount]->Steal();
+				}
+
+				if (item != nullptr)
+					--m_queued;
+				return item;
+			}
+
+			void Execute(JobItem* item)
+			{
+				try
+				{
+					item->m_job();
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(item->m_counter->m_mutex);
+					if (!item->m_counter->m_error)
+						item->m_counter->m_error = std::current_exception();
+				}
+				Finish(*item->m_counter);
+				delete item;
+			}
+
+			//The last job takes the counter's lock to reach zero, and hands out the continuations before releasing it.
+			//RunAfter checks the count under the same lock, so a counter reused once it's done can't have a new
+			//continuation started by the previous round's last job.
+			void Finish(JobCounter::State& counter)
+			{
+				size_t pending = counter.m_pending.load();
+				while (pending > 1)
+				{
+					if (counter.m_pending.compare_exchange_weak(pending, pending - 1))
+						return;
+				}
+
+				std::vector<JobItem*> continuations;
+				{
+					std::lock_guard<std::mutex> lock(counter.m_mutex);
+					if (--counter.m_pending != 0)
+						return;
+					continuations.swap(counter.m_continuations);
+				}
+				for (auto item : continuations)
+					Schedule(item);
+
+				if (m_waiters.load() != 0)
+				{
+					{
+						std::lock_guard<std::mutex> lock(m_mutex);
+					}
+					m_wake.notify_all();
+				}
+			}
+
+			//Helps with the jobs while there are any, and sleeps like an idle worker once there haven't been for a while
+			void Wait(JobCounter::State& counter)
+			{
+				const auto slot = Slot();
+				unsigned int idleRounds = 0;
+				while (counter.m_pending.load() != 0)
+				{
+					JobItem* item = TakeJob(slot);
+					if (item != nullptr)
+					{
+						Execute(item);
+						idleRounds = 0;
+						continue;
+					}
+
+					if (++idleRounds < s_idleRoundsBeforeSleep)
+					{
+						std::this_thread::yield();
+						continue;
+					}
+
+					std::unique_lock<std::mutex> lock(m_mutex);
+					++m_waiters;
+					++m_sleepers;
+					m_wake.wait(lock, [this, &counter]() { return m_quit || m_queued.load() != 0 || counter.m_pending.load() == 0; });
+					--m_sleepers;
+					--m_waiters;
+					idleRounds = 0;
+				}
+
+				std::exception_ptr error;
+				{
+					std::lock_guard<std::mutex> lock(counter.m_mutex); //Also waits for the last job to hand out the continuations
+					error.swap(counter.m_error);
+				}
+				if (error)
+					std::rethrow_exception(error);
+			}
+
+			//Lazy binary splitting. Half of the range is handed out only while this thread's deque is empty, which is
+			//when other threads may be out of work. Once everyone is busy the rest runs in grain sized pieces with no
+			//scheduling overhead at all, so the grain adapts to the load instead of being guessed up front.
+			void SplitRange(size_t begin, size_t end, const size_t grain, const RangeJob& job, JobCounter& counter)
+			{
+				const auto slot = Slot();
+				while (end - begin > grain)
+				{
+					if (slot != s_noSlot && !m_deques[slot]->IsEmpty())
+					{
+						job(begin, begin + grain);
+						begin += grain;
+						continue;
+					}
+
+					const auto middle = begin + (end - begin) / 2;
+					const auto last = end;
+					JobItem* item = new JobItem;
+					item->m_job = [this, middle, last, grain, &job, counter]() mutable { SplitRange(middle, last, grain, job, counter); };
+					item->m_counter = counter.m_state;
+					++counter.m_state->m_pending;
+					Schedule(item);
+					end = middle;
+				}
+				job(begin, end);
+			}
+
+			void WorkerLoop(const size_t slot)
+			{
+				s_jobSystem = this;
+				s_jobSlot = slot;
+
+				unsigned int idleRounds = 0;
+				for (;;)
+				{
+					JobItem* item = TakeJob(slot);
+					if (item != nullptr)
+					{
+						Execute(item);
+						idleRounds = 0;
+						continue;
+					}
+
+					if (++idleRounds < s_idleRoundsBeforeSleep)
+					{
+						std::this_thread::yield();
+						continue;
+					}
+
+					std::unique_lock<std::mutex> lock(m_mutex);
+					++m_sleepers;
+					m_wake.wait(lock, [this]() { return m_quit || m_queued.load() != 0; });
+					--m_sleepers;
+					if (m_quit)
+						return;
+					idleRounds = 0;
+				}
+			}
+
+			static const size_t s_noSlot = ~static_cast<size_t>(0);
+			static const unsigned int s_idleRoundsBeforeSleep = 64;
+			static PICO_THREAD_LOCAL Impl* s_jobSystem; //The job system the current worker thread belongs to
+			static PICO_THREAD_LOCAL size_t s_jobSlot;
+
+			const std::thread::id m_owner; //The creating thread
+			std::vector<std::unique_ptr<WorkStealingDeque>> m_deques; //Slot 0 belongs to the creating thread
+			std::vector<std::thread> m_threads;
+			std::atomic<size_t> m_queued; //Jobs sitting in a deque or the injection queue
+			std::atomic<size_t> m_sleepers; //Idle workers and blocked waits, woken by new jobs
+			std::atomic<size_t> m_waiters; //Blocked waits, also woken by counters reaching zero
+			std::mutex m_mutex;
+			std::condition_variable m_wake;
+
+			//Jobs from threads without a deque, or from a full one
+			std::mutex m_injectMutex;
+			std::deque<JobItem*> m_injected;
+			std::atomic<size_t> m_injectedCount;
+			bool m_quit;
+		};
+
+		const size_t JobSystem::Impl::s_noSlot;
+		PICO_THREAD_LOCAL JobSystem::Impl* JobSystem::Impl::s_jobSystem = nullptr;
+		PICO_THREAD_LOCAL size_t JobSystem::Impl::s_jobSlot = 0;
+
+		JobSystem::JobSystem(const size_t workerCount)
+			:m_impl(new Impl(workerCount))
+		{
+		}
+
+		JobSystem::~JobSystem()
+		{
+		}
+
+		void JobSystem::Run(const Job& job, JobCounter& counter)
+		{
+			JobItem* item = new JobItem;
+			item->m_job = job;
+			item->m_counter = counter.m_state;
+			++counter.m_state->m_pending;
+			m_impl->Schedule(item);
+		}
+
+		void JobSystem::RunAfter(const JobCounter& dependency, const Job& job, JobCounter& counter)
+		{
+			JobItem* item = new JobItem;
+			item->m_job = job;
+			item->m_counter = counter.m_state;
+			++counter.m_state->m_pending;
+			{
+				std::lock_guard<std::mutex> lock(dependency.m_state->m_mutex);
+				if (dependency.m_state->m_pending.load() != 0)
+				{
+					dependency.m_state->m_continuations.push_back(item);
+					return;
+				}
+			}
+			m_impl->Schedule(item);
+		}
+
+		void JobSystem::Wait(const JobCounter& counter)
+		{
+			m_impl->Wait(*counter.m_state);
+		}
+
+		void JobSystem::ParallelFor(const size_t count, const RangeJob& job, const size_t minGrain)
+		{
+			if (count == 0)
+				return;
+
+			JobCounter counter;
+			try
+			{
+				m_impl->SplitRange(0, count, std::max(minGrain, static_cast<size_t>(1)), job, counter);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(counter.m_state->m_mutex);
+				if (!counter.m_state->m_error)
+					counter.m_state->m_error = std::current_exception();
+			}
+			m_impl->Wait(*counter.m_state);
+		}
+
+		bool JobSystem::RunPendingJob()
+		{
+			JobItem* item = m_impl->TakeJob(m_impl->Slot());
+			if (item == nullptr)
+				return false;
+
+			m_impl->Execute(item);
+			return true;
+		}
+
+		size_t JobSystem::ThreadCount() const
+		{
+			return m_impl->m_threads.size() + 1;
+		}
+
+		//-------------------------------------------------------------------------------------------------
+
+		IMesh::IMesh()
+			:m_meshId(s_meshIdCnt++)
+		{
+		}
+
+		IMesh::~IMesh()
+		{
+		}
+
+		size_t IMesh::Id() const
+		{
+			return m_meshId;
+		}
+
+		bool IMesh::IsResident() const
+		{
+			return true;
+		}
+
+		bool IMesh::HasFailed() const
+		{
+			return false;
+		}
+
+		size_t IMesh::s_meshIdCnt = 0;
+
+		//-------------------------------------------------------------------------------------------------
+
+		struct IGameObject::RenderDetails
+		{
+			RenderDetails(const RenderDetails&) = delete;
+
+			GLuint m_program;
+			GLuint m_positionLoc;
 			GLuint m_texCoordLoc;
 			GLuint m_samplerLoc;
 			GLuint m_mvpLoc;
@@ -1440,8 +2600,8 @@ namespace CogitareComputing
 			GLuint m_useLightingLocation;
 			GLuint m_alphaLocation;
 
-			float m_viewMatrix[4][4];
-			float m_perspectiveMatrix[4][4];
+			Mat4 m_viewMatrix;
+			Mat4 m_perspectiveMatrix;
 
 			RenderDetails()
 				:m_program(0)
@@ -1462,342 +2622,3751 @@ namespace CogitareComputing
 		};
 
 		//-------------------------------------------------------------------------------------------------
-#ifdef PICO_ANDROID
-		template<typename CharType, typename TraitsType = std::char_traits<CharType> >
-		class VectorStream : public std::basic_streambuf<CharType, TraitsType>
+
+		//Everything that changes the render path of an object. Objects are bucketed on these so each bucket
+		//runs a loop specialised at compile time. Alpha is the highest bit so translucent buckets come last in a pass.
+		enum RenderFlags
 		{
-		public:
-			VectorStream(std::vector<CharType> &vec)
-			{
-				std::basic_streambuf<CharType, TraitsType>::setg(vec.data(), vec.data(), vec.data() + vec.size());
-			}
+			RenderFlag_SkipView = 1,
+			RenderFlag_Lit = 2,
+			RenderFlag_ClientMemory = 4,
+			RenderFlag_Alpha = 8,
+			RenderFlag_Count = 16
 		};
 
+		class Mesh;
 
-		class PicoMaterialReader : public tinyobj::MaterialReader
+		//The world matrices of the objects to draw this frame, gathered into contiguous arrays so that every
+		//mvp matrix is computed in one tight loop before any GL call is made.
+		class TransformBatch
 		{
 		public:
-			typedef std::function<void(std::vector<char>&, const std::string&)> FileReaderFn;
+			struct Bucket
+			{
+				unsigned int m_flags;
+				size_t m_begin;
+				size_t m_end;
+			};
 
-			PicoMaterialReader(FileReaderFn fileReader)
-				:m_fileReaderFn(fileReader)
+			void Clear()
 			{
+				m_objects.clear();
+				m_meshes.clear();
+				m_models.clear();
+				m_alphas.clear();
+				m_buckets.clear();
 			}
 
-			std::string operator()(const std::string &matId,
-				std::vector<tinyobj::material_t> &materials,
-				std::map<std::string, int> &matMap) override
+			//Objects added after this belong to a bucket with the given flags
+			void BeginBucket(const unsigned int flags)
 			{
-				std::vector<char> buffer;
-				m_fileReaderFn(buffer, matId);
-				VectorStream<char> vectorBuffer(buffer);
-				std::istream matIStream(&vectorBuffer);
+				const Bucket bucket = { flags, Count(), Count() };
+				m_buckets.push_back(bucket);
+			}
 
-				std::string err = LoadMtl(matMap, materials, matIStream);
-				if (!matIStream)
+			//Meshes with quantised positions pass their dequantisation, it's folded into the model matrix
+			void Add(IGameObject* gob, const Mesh* mesh, const Mat4& world, const Mat4* dequantisation, const float alpha)
+			{
+				m_objects.push_back(gob);
+				m_meshes.push_back(mesh);
+				m_models.push_back(world);
+				if (dequantisation != nullptr)
+					MatrixTools::MatrixMul(world, *dequantisation, m_models.back());
+				m_alphas.push_back(alpha);
+				m_buckets.back().m_end = Count();
+			}
+
+			size_t Count() const
+			{
+				return m_objects.size();
+			}
+
+			void Prepare()
+			{
+				m_mvps.resize(Count());
+			}
+
+			void Compute(const size_t begin, const size_t end, const Mat4& viewProjection, const Mat4& projection)
+			{
+				for (const auto& bucket : m_buckets)
 				{
-					std::stringstream ss;
-					ss << "WARN: Material file [ " << matId << " ] not found. Created a default material.";
-					err += ss.str();
+					const auto bucketBegin = std::max(begin, bucket.m_begin);
+					const auto bucketEnd = std::min(end, bucket.m_end);
+					if (bucketBegin < bucketEnd)
+						ComputeRange(bucketBegin, bucketEnd, (bucket.m_flags & RenderFlag_SkipView) != 0 ? projection : viewProjection);
 				}
-				return err;
 			}
+
+			const std::vector<Bucket>& Buckets() const { return m_buckets; }
+			IGameObject* Object(const size_t i) const { return m_objects[i]; }
+			const Mesh* MeshAt(const size_t i) const { return m_meshes[i]; }
+			const Mat4& Model(const size_t i) const { return m_models[i]; }
+			const Mat4& Mvp(const size_t i) const { return m_mvps[i]; }
+			float Alpha(const size_t i) const { return m_alphas[i]; }
+
 		private:
-			FileReaderFn m_fileReaderFn;
+			void ComputeRange(const size_t begin, const size_t end, const Mat4& viewProjection)
+			{
+				for (size_t i = begin; i != end; ++i)
+					MatrixTools::MatrixMul(viewProjection, m_models[i], m_mvps[i]);
+			}
+
+			std::vector<IGameObject*> m_objects;
+			std::vector<const Mesh*> m_meshes;
+			std::vector<Mat4> m_models;
+			std::vector<Mat4> m_mvps;
+			std::vector<float> m_alphas;
+			std::vector<Bucket> m_buckets;
 		};
-#endif
+
 		//-------------------------------------------------------------------------------------------------
 
-		class Mesh : public IMesh
+		//Everything the render thread needs to draw a frame, copied out of the game state so the next frame
+		//can be updated while this one is drawn
+		struct FramePacket
+		{
+			TransformBatch m_transforms;
+			float m_light[3];
+			Vec4 m_clearColour;
+			size_t m_width;
+			size_t m_height;
+			double m_elapsedTime;
+			double m_frameStart;
+			double m_uploadBudget;
+			std::vector<GameObjectPtr> m_retired; //Objects removed since the previous packet, kept alive until the frames that may still draw them are done
+		};
+
+		//Owns the GL context while it runs. Frame packets go round in a ring, the game thread fills a free one
+		//and submits it, the render thread draws, swaps and hands it back. With every packet in flight the
+		//game thread waits, which is what keeps it at most the number of packets minus one frames ahead.
+		class RenderThread
 		{
 		public:
-			Mesh(SystemSpecificData data)
-				:m_systemData(data)
-			{
-			}
+			typedef std::function<void()> Task;
+			typedef std::function<void(FramePacket&)> RenderFn;
+
+			RenderThread()
+				:m_running(false)
+				, m_stopping(false)
+				, m_exited(false)
+				, m_acquired(0)
+			{}
 
-			template <int N>
-			void Render(const IGameObject::RenderDetails& renderDetails
-				, const float(&rotationMatrix)[N][N]
-				, const float(&scaleMatrix)[N][N]
-				, const float(&translationMatrix)[N][N]
-				, const bool lighting
-				, const bool skipViewMatrix
-				, const float alpha) const
+			~RenderThread()
 			{
-				float matrix[4][4];
-				float model[4][4];
-				float temp[4][4];
-				MatrixTools::MatrixMul(rotationMatrix, scaleMatrix, temp);
-				MatrixTools::MatrixMul(translationMatrix, temp, model);
-				glUniformMatrix4fv(renderDetails.m_modelLoc, 1, GL_FALSE, static_cast<const GLfloat*>(&model[0][0]));
-				if (skipViewMatrix)
+				try
 				{
-					MatrixTools::MatrixMul(renderDetails.m_perspectiveMatrix, model, matrix);
+					Stop();
 				}
-				else
+				catch (...)
 				{
-					MatrixTools::MatrixMul(renderDetails.m_viewMatrix, model, temp);
-					MatrixTools::MatrixMul(renderDetails.m_perspectiveMatrix, temp, matrix);
 				}
+			}
 
-				glUniformMatrix4fv(renderDetails.m_mvpLoc, 1, GL_FALSE, static_cast<const GLfloat*>(&matrix[0][0]));
-				glUniform1i(renderDetails.m_useLightingLocation, lighting);
-				glUniform1f(renderDetails.m_alphaLocation, alpha);
-				glEnableVertexAttribArray(renderDetails.m_positionLoc);
-				glEnableVertexAttribArray(renderDetails.m_texCoordLoc);
-				glUniform1i(renderDetails.m_samplerLoc, 0);
-				const MaterialId2TextureIdMap::const_iterator& endIter = std::end(m_materialId2TextureId);
+			//attach and detach run on the render thread, before the first and after the last packet
+			void Start(const size_t packetCount, const Task& attach, const RenderFn& render, const Task& detach)
+			{
+				m_packets.clear();
+				m_packets.resize(std::max(packetCount, static_cast<size_t>(2)));
+				m_free.clear();
+				m_ready.clear();
+				for (size_t i = 0; i != m_packets.size(); ++i)
+					m_free.push_back(i);
+
+				m_render = render;
+				m_error = std::exception_ptr();
+				m_stopping = false;
+				m_exited = false;
+				m_thread = std::thread([this, attach, detach]() { Loop(attach, detach); });
+				m_running = true;
+			}
 
-				int lastestMaterialId = -1;
-#ifdef USE_ARRAY_BUFFERS
-				const auto shapeCount = m_vertexDataBuffer.size();
-#else
-				const auto shapeCount = m_vertexData.size();
-#endif
-				for (size_t shapeNo = 0; shapeNo != shapeCount; ++shapeNo)
-				{
-#ifdef USE_ARRAY_BUFFERS
-					glBindBuffer(GL_ARRAY_BUFFER, m_vertexDataBuffer[shapeNo]);
-					glVertexAttribPointer(renderDetails.m_positionLoc, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), nullptr);
-					glBindBuffer(GL_ARRAY_BUFFER, m_textureCoordDataBuffer[shapeNo]);
-					glVertexAttribPointer(renderDetails.m_texCoordLoc, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), nullptr);
-					const auto& indexData = m_indexDataBuffers[shapeNo];
-#else
-					glVertexAttribPointer(renderDetails.m_positionLoc, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), &m_vertexData[shapeNo][0]);
-					glVertexAttribPointer(renderDetails.m_texCoordLoc, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), &m_textureCoordData[shapeNo][0]);
-					const auto& indexData = m_indexData[shapeNo];
-#endif
+			//Draws whatever has been submitted and joins the thread, errors from the render thread are rethrown here
+			void Stop()
+			{
+				if (!m_running)
+					return;
+
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_stopping = true;
+				}
+				m_changed.notify_all();
+				m_thread.join();
+				m_running = false;
+				m_packets.clear();
+
+				auto error = m_error;
+				m_error = std::exception_ptr();
+				if (error)
+					std::rethrow_exception(error);
+			}
+
+			bool IsRunning() const
+			{
+				return m_running;
+			}
+
+			//Blocks until a packet isn't in flight any more
+			FramePacket& Acquire()
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_changed.wait(lock, [this]() { return !m_free.empty() || m_exited; });
+				ThrowIfExited();
+
+				m_acquired = m_free.front();
+				m_free.pop_front();
+				return m_packets[m_acquired];
+			}
+
+			void Submit()
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_ready.push_back(m_acquired);
+				}
+				m_changed.notify_all();
+			}
+
+			//Runs the task where the GL context is current and waits for it, exceptions are passed on to the caller.
+			//Queued ahead of the frames that haven't been drawn yet.
+			void Invoke(const Task& task)
+			{
+				if (!m_running || std::this_thread::get_id() == m_thread.get_id())
+				{
+					task();
+					return;
+				}
+
+				PendingTask pending(task);
+				{
+					std::unique_lock<std::mutex> lock(m_mutex);
+					ThrowIfExited();
+					m_tasks.push_back(&pending);
+					m_changed.notify_all();
+					m_changed.wait(lock, [&pending]() { return pending.m_done; });
+				}
+				if (pending.m_error)
+					std::rethrow_exception(pending.m_error);
+			}
+
+		private:
+			struct PendingTask
+			{
+				PendingTask(const Task& task)
+					:m_task(task)
+					, m_done(false)
+				{}
+
+				const Task& m_task;
+				bool m_done;
+				std::exception_ptr m_error;
+			};
 
+			void ThrowIfExited()
+			{
+				if (!m_exited)
+					return;
+				if (m_error)
+					std::rethrow_exception(m_error);
+				throw EngineException("The render thread has stopped");
+			}
 
-					for (const auto& iData : indexData)
+			void Loop(const Task& attach, const Task& detach)
+			{
+				try
+				{
+					attach();
+					for (;;)
 					{
-						const auto materialId = iData.first;
-						const auto& indices = iData.second;
-						if (lastestMaterialId != materialId)
+						std::unique_lock<std::mutex> lock(m_mutex);
+						m_changed.wait(lock, [this]() { return m_stopping || !m_ready.empty() || !m_tasks.empty(); });
+
+						if (!m_tasks.empty())
 						{
-							lastestMaterialId = materialId;
-							glActiveTexture(GL_TEXTURE0);
-							const auto& textureIter = m_materialId2TextureId.find(materialId);
-							if (textureIter != endIter)
-								glBindTexture(GL_TEXTURE_2D, textureIter->second);
+							PendingTask* task = m_tasks.front();
+							m_tasks.pop_front();
+							lock.unlock();
+							try
+							{
+								task->m_task();
+							}
+							catch (...)
+							{
+								task->m_error = std::current_exception();
+							}
+							lock.lock();
+							task->m_done = true;
+							lock.unlock();
+							m_changed.notify_all();
+							continue;
 						}
 
-#ifdef USE_ARRAY_BUFFERS
-						glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices.second);
-						glDrawElements(GL_TRIANGLES, indices.first, GL_UNSIGNED_SHORT, nullptr);
-#else
-						glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_SHORT, &indices[0]);
-#endif
+						if (m_ready.empty())
+							break; //Stopping and nothing left to draw
+
+						const auto index = m_ready.front();
+						m_ready.pop_front();
+						lock.unlock();
+
+						m_render(m_packets[index]);
+						m_packets[index].m_retired.clear();
+
+						lock.lock();
+						m_free.push_back(index);
+						lock.unlock();
+						m_changed.notify_all();
 					}
 				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_error = std::current_exception();
+				}
 
-#ifdef USE_ARRAY_BUFFERS
-				glBindBuffer(GL_ARRAY_BUFFER, 0);
-				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-#endif
+				try
+				{
+					detach();
+				}
+				catch (...)
+				{
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					for (auto task : m_tasks)
+					{
+						task->m_error = m_error ? m_error : std::make_exception_ptr(EngineException("The render thread has stopped"));
+						task->m_done = true;
+					}
+					m_tasks.clear();
+					m_exited = true;
+				}
+				m_changed.notify_all();
 			}
 
+			std::thread m_thread;
+			std::mutex m_mutex;
+			std::condition_variable m_changed; //Shared by both sides, anything that one of them may wait for
+			bool m_running;
+			bool m_stopping;
+			bool m_exited;
+			std::exception_ptr m_error;
+
+			RenderFn m_render;
+			std::vector<FramePacket> m_packets;
+			std::deque<size_t> m_free;
+			std::deque<size_t> m_ready;
+			size_t m_acquired;
+			std::deque<PendingTask*> m_tasks;
+		};
+
+		//-------------------------------------------------------------------------------------------------
+
+		//Updated by whichever thread presents the frames
+		class FrameStatsTracker
+		{
+		public:
+			FrameStatsTracker()
+				:m_lastPresent(-1.0)
+			{}
+
+			void Reset()
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stats = FrameStats();
+				m_lastPresent = -1.0;
+			}
 
-			bool Load(const std::string& meshName)
+			void Presented(const double frameStart, const double now)
+			{
+				const double weight = 0.05; //Moving average, settles in about a second at 60 fps
+
+				std::lock_guard<std::mutex> lock(m_mutex);
+				const double latency = now - frameStart;
+				m_stats.m_latency = m_stats.m_frames == 0 ? latency : m_stats.m_latency + (latency - m_stats.m_latency) * weight;
+				if (m_lastPresent >= 0.0)
+				{
+					const double frameTime = now - m_lastPresent;
+					m_stats.m_frameTime = m_stats.m_frames == 1 ? frameTime : m_stats.m_frameTime + (frameTime - m_stats.m_frameTime) * weight;
+				}
+				m_lastPresent = now;
+				++m_stats.m_frames;
+			}
+
+			FrameStats Stats() const
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				return m_stats;
+			}
+
+		private:
+			mutable std::mutex m_mutex;
+			FrameStats m_stats;
+			double m_lastPresent;
+		};
+
+		//-------------------------------------------------------------------------------------------------
+
+		template<typename CharType, typename TraitsType = std::char_traits<CharType> >
+		class VectorStream : public std::basic_streambuf<CharType, TraitsType>
+		{
+		public:
+			VectorStream(std::vector<CharType> &vec)
+			{
+				std::basic_streambuf<CharType, TraitsType>::setg(vec.data(), vec.data(), vec.data() + vec.size());
+			}
+		};
+
+
+		class PicoMaterialReader : public tinyobj::MaterialReader
+		{
+		public:
+			typedef std::function<void(std::vector<char>&, const std::string&)> FileReaderFn;
+
+			PicoMaterialReader(FileReaderFn fileReader)
+				:m_fileReaderFn(fileReader)
+			{
+			}
+
+			std::string operator()(const std::string &matId,
+				std::vector<tinyobj::material_t> &materials,
+				std::map<std::string, int> &matMap) override
 			{
-				std::vector<tinyobj::shape_t> shapes;
-				std::vector<tinyobj::material_t> materials;
-#ifdef PICO_ANDROID
 				std::vector<char> buffer;
-				LoadFile<char>(buffer, meshName);
+				m_fileReaderFn(buffer, matId);
 				VectorStream<char> vectorBuffer(buffer);
-				std::istream objIStream(&vectorBuffer);
-				PicoMaterialReader::FileReaderFn fn([this](std::vector<char>& buffer, const std::string& filename) { LoadFile<char>(buffer, filename); });
-				PicoMaterialReader materialReader(fn);
-				std::string err = tinyobj::LoadObj(shapes, materials, objIStream, materialReader);
+				std::istream matIStream(&vectorBuffer);
+
+				std::string err = LoadMtl(matMap, materials, matIStream);
+				if (!matIStream)
+				{
+					std::stringstream ss;
+					ss << "WARN: Material file [ " << matId << " ] not found. Created a default material.";
+					err += ss.str();
+				}
+				return err;
+			}
+		private:
+			FileReaderFn m_fileReaderFn;
+		};
+		//-------------------------------------------------------------------------------------------------
+
+		//A whole file in memory, mapped where the platform can and read into a buffer otherwise
+		class MappedFile
+		{
+		public:
+			MappedFile()
+				:m_data(nullptr)
+				, m_size(0)
+				, m_mapped(false)
+#ifdef PICO_ANDROID
+				, m_asset(nullptr)
+#endif
+			{
+			}
+
+			~MappedFile()
+			{
+				Close();
+			}
+
+			bool Open(const std::string& filename)
+			{
+				Close();
+#ifdef PICO_MMAP
+				const int fd = ::open(filename.c_str(), O_RDONLY);
+				if (fd < 0)
+					return false;
+
+				struct stat info;
+				const bool ok = fstat(fd, &info) == 0;
+				if (ok && info.st_size > 0)
+				{
+					void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+					if (data != MAP_FAILED)
+					{
+						m_data = static_cast<const char*>(data);
+						m_size = static_cast<size_t>(info.st_size);
+						m_mapped = true;
+					}
+				}
+				::close(fd); //The mapping stays valid
+				return ok && (m_mapped || info.st_size == 0);
 #else
-				std::string err = tinyobj::LoadObj(shapes, materials, meshName.c_str());
+				std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+				if (!file)
+					return false;
+
+				//One allocation of the file's size and a single read
+				const std::streamoff size = file.tellg();
+				if (size > 0)
+				{
+					m_buffer.resize(static_cast<size_t>(size));
+					if (!file.seekg(0, std::ios::beg).read(&m_buffer[0], size))
+					{
+						Close();
+						return false;
+					}
+				}
+				m_data = m_buffer.empty() ? nullptr : &m_buffer[0];
+				m_size = m_buffer.size();
+				return true;
 #endif
-				if (!err.empty())
-					throw EngineException(("Failed to load objfile:" + err).c_str());
+			}
 
-#ifdef USE_ARRAY_BUFFERS
-				//These are local when using array buffers
-				FloatSeries m_vertexData;
-				FloatSeries m_textureCoordData;
-				MaterialId2IndexDataMap m_indexData;
+#ifdef PICO_ANDROID
+			//An asset in the apk, which the asset manager maps when it's stored uncompressed
+			bool OpenAsset(SystemSpecificData& sData, const std::string& filename)
+			{
+				Close();
+				AAssetManager* assetManager = sData.m_androidWrapper->AndroidApp()->activity->assetManager;
+				m_asset = AAssetManager_open(assetManager, filename.c_str(), AASSET_MODE_BUFFER);
+				if (m_asset == nullptr)
+					return false;
+
+				m_data = static_cast<const char*>(AAsset_getBuffer(m_asset));
+				m_size = static_cast<size_t>(AAsset_getLength(m_asset));
+				if (m_data == nullptr)
+				{
+					Close();
+					return false;
+				}
+				return true;
+			}
 #endif
-				m_vertexData.clear();
-				m_textureCoordData.clear();
 
-				MateralId2TextureNameMap textureNames;
-				int i = 0;
-				for (const auto& material : materials)
-					textureNames[i++] = material.diffuse_texname;
+			void Close()
+			{
+#ifdef PICO_MMAP
+				if (m_mapped)
+					munmap(const_cast<char*>(m_data), m_size);
+#endif
+#ifdef PICO_ANDROID
+				if (m_asset != nullptr)
+					AAsset_close(m_asset);
+				m_asset = nullptr;
+#endif
+				std::vector<char>().swap(m_buffer);
+				m_data = nullptr;
+				m_size = 0;
+				m_mapped = false;
+			}
+
+			const char* Data() const
+			{
+				return m_data;
+			}
+
+			size_t Size() const
+			{
+				return m_size;
+			}
+
+		private:
+			MappedFile(const MappedFile&) = delete;
+
+			const char* m_data;
+			size_t m_size;
+			bool m_mapped;
+			std::vector<char> m_buffer; //Without mmap
+#ifdef PICO_ANDROID
+			AAsset* m_asset; //Owns the data of an asset
+#endif
+		};
+
+		//Same separators everywhere with "." and ".." resolved, so the different ways of naming a file meet
+		static std::string CanonicalPath(const std::string& path)
+		{
+			const bool absolute = !path.empty() && (path[0] == '/' || path[0] == '\\');
+			std::vector<std::string> parts;
+			std::string part;
+			for (size_t i = 0; i <= path.size(); ++i)
+			{
+				if (i != path.size() && path[i] != '/' && path[i] != '\\')
+				{
+					part += path[i];
+					continue;
+				}
+
+				if (part == "..")
+				{
+					if (!parts.empty() && parts.back() != "..")
+						parts.pop_back();
+					else if (!absolute) //Nothing above the root
+						parts.push_back(part);
+				}
+				else if (!part.empty() && part != ".")
+					parts.push_back(part);
+				part.clear();
+			}
+
+			std::string canonical = absolute ? "/" : "";
+			for (size_t i = 0; i != parts.size(); ++i)
+				canonical += (i == 0 ? "" : "/") + parts[i];
+			return canonical;
+		}
+
+		//FNV-1a, continuing from hash to cover data spread over several calls
+		static uint64_t Fnv1a(const char* data, const size_t size, uint64_t hash = 14695981039346656037ULL)
+		{
+			for (size_t i = 0; i != size; ++i)
+			{
+				hash ^= static_cast<unsigned char>(data[i]);
+				hash *= 1099511628211ULL;
+			}
+			return hash;
+		}
+
+		//The LZ4 block format, readable by LZ4_decompress_safe. Greedy matching with a single hash probe, which trades
+		//some ratio for a simple compressor; decompression speed doesn't depend on it.
+		namespace Lz4
+		{
+			const size_t s_minMatch = 4;
+			const size_t s_lastLiterals = 5; //The block always ends with at least this many literals
+			const size_t s_matchLimit = 12; //and no match starts closer than this to its end
+			const size_t s_hashBits = 12;
+
+			static uint32_t Read32(const unsigned char* data)
+			{
+				uint32_t value;
+				std::memcpy(&value, data, sizeof(value));
+				return value;
+			}
+
+			//Writes a length nibble's extension bytes
+			static bool WriteLength(size_t length, unsigned char*& out, const unsigned char* end)
+			{
+				for (; length >= 255; length -= 255)
+				{
+					if (out == end)
+						return false;
+					*out++ = 255;
+				}
+				if (out == end)
+					return false;
+				*out++ = static_cast<unsigned char>(length);
+				return true;
+			}
+
+			//A literal run followed by a match, or only the literals at the end when matchLength is 0
+			static bool WriteSequence(const unsigned char* literals, const size_t literalLength, const size_t offset, const size_t matchLength,
+				unsigned char*& out, const unsigned char* end)
+			{
+				if (out == end)
+					return false;
+				unsigned char& token = *out++;
+				token = static_cast<unsigned char>(std::min<size_t>(literalLength, 15) << 4);
+				if (literalLength >= 15 && !WriteLength(literalLength - 15, out, end))
+					return false;
+				if (static_cast<size_t>(end - out) < literalLength)
+					return false;
+				std::memcpy(out, literals, literalLength);
+				out += literalLength;
+
+				if (matchLength == 0)
+					return true;
+				if (end - out < 2)
+					return false;
+				*out++ = static_cast<unsigned char>(offset);
+				*out++ = static_cast<unsigned char>(offset >> 8);
+				const auto length = matchLength - s_minMatch;
+				token |= static_cast<unsigned char>(std::min<size_t>(length, 15));
+				return length < 15 || WriteLength(length - 15, out, end);
+			}
+
+			//The compressed size, 0 when it doesn't fit in capacity. Blocks are at most 64 KiB, so offsets always fit.
+			static size_t Compress(const char* source, const size_t size, char* destination, const size_t capacity)
+			{
+				const auto* in = reinterpret_cast<const unsigned char*>(source);
+				const auto* inEnd = in + size;
+				auto* out = reinterpret_cast<unsigned char*>(destination);
+				const auto* outEnd = out + capacity;
+				const unsigned char* anchor = in;
+
+				if (size > s_matchLimit)
+				{
+					std::vector<uint32_t> table(size_t(1) << s_hashBits, UINT32_MAX); //Last position of each hashed 4 bytes
+					const unsigned char* ip = in;
+					while (ip + s_matchLimit <= inEnd)
+					{
+						const auto sequence = Read32(ip);
+						const auto hash = (sequence * 2654435761U) >> (32 - s_hashBits);
+						const auto candidate = table[hash];
+						const auto position = static_cast<uint32_t>(ip - in);
+						table[hash] = position;
+						if (candidate == UINT32_MAX || position - candidate > 65535 || Read32(in + candidate) != sequence)
+						{
+							++ip;
+							continue;
+						}
+
+						const unsigned char* match = in + candidate;
+						size_t length = s_minMatch;
+						while (ip + length < inEnd - s_lastLiterals && ip[length] == match[length])
+							++length;
+
+						if (!WriteSequence(anchor, static_cast<size_t>(ip - anchor), static_cast<size_t>(ip - match), length, out, outEnd))
+							return 0;
+						ip += length;
+						anchor = ip;
+					}
+				}
+
+				if (!WriteSequence(anchor, static_cast<size_t>(inEnd - anchor), 0, 0, out, outEnd))
+					return 0;
+				return static_cast<size_t>(out - reinterpret_cast<unsigned char*>(destination));
+			}
+
+			//Bounds checked against both buffers, false unless the block decodes to exactly size bytes
+			static bool Decompress(const char* source, const size_t sourceSize, char* destination, const size_t size)
+			{
+				const auto* in = reinterpret_cast<const unsigned char*>(source);
+				const auto* inEnd = in + sourceSize;
+				auto* out = reinterpret_cast<unsigned char*>(destination);
+				auto* const outStart = out;
+				const auto* outEnd = out + size;
+
+				while (in != inEnd)
+				{
+					const unsigned token = *in++;
+					size_t literalLength = token >> 4;
+					if (literalLength == 15)
+					{
+						unsigned char extra;
+						do
+						{
+							if (in == inEnd)
+								return false;
+							extra = *in++;
+							literalLength += extra;
+						} while (extra == 255);
+					}
+					if (static_cast<size_t>(inEnd - in) < literalLength || static_cast<size_t>(outEnd - out) < literalLength)
+						return false;
+					std::memcpy(out, in, literalLength);
+					in += literalLength;
+					out += literalLength;
+					if (in == inEnd) //The last sequence has no match
+						break;
+
+					if (inEnd - in < 2)
+						return false;
+					const size_t offset = in[0] | (static_cast<size_t>(in[1]) << 8);
+					in += 2;
+					if (offset == 0 || offset > static_cast<size_t>(out - outStart))
+						return false;
+
+					size_t matchLength = token & 15;
+					if (matchLength == 15)
+					{
+						unsigned char extra;
+						do
+						{
+							if (in == inEnd)
+								return false;
+							extra = *in++;
+							matchLength += extra;
+						} while (extra == 255);
+					}
+					matchLength += s_minMatch;
+					if (static_cast<size_t>(outEnd - out) < matchLength)
+						return false;
+
+					const unsigned char* match = out - offset;
+					if (offset >= matchLength)
+					{
+						std::memcpy(out, match, matchLength);
+						out += matchLength;
+					}
+					else
+					{
+						for (size_t i = 0; i != matchLength; ++i) //Overlapping, repeats the last offset bytes
+							*out++ = *match++;
+					}
+				}
+				return out == outEnd;
+			}
+		}
+
+		//The .pak layout: a header, an open addressing hash table of entries keyed by canonical path, the names and
+		//then the files, each starting on a 4 KiB boundary so it's page aligned in the mapping.
+		//A compressed pack has its own magic and the same layout, but its entries are 8 byte aligned and each holds a
+		//ChunkHeader, the stored size of every chunk and the chunks. A chunk is an LZ4 block of up to s_chunkSize bytes
+		//of the file, or the bytes themselves when they didn't compress. The chunks are independent, so a large file is
+		//decompressed in parallel.
+		namespace PakFormat
+		{
+			const uint32_t s_version = 1;
+			const uint64_t s_alignment = 4096;
+			const uint64_t s_compressedAlignment = 8;
+			const char s_magic[4] = { 'P', 'P', 'A', 'K' };
+			const char s_compressedMagic[4] = { 'P', 'L', 'Z', '4' };
+			const uint32_t s_chunkSize = 65536;
+			const uint32_t s_storedChunk = 0x80000000U; //Set in a chunk's stored size when it isn't compressed
+
+			struct ChunkHeader
+			{
+				uint64_t m_size; //Of the file
+				uint32_t m_chunkCount;
+				uint32_t m_padding;
+			};
+
+			struct Header
+			{
+				char m_magic[4]; //"PPAK"
+				uint32_t m_version;
+				uint32_t m_entryCount;
+				uint32_t m_bucketCount; //A power of two larger than the entry count, so every probe ends at an empty bucket
+				uint64_t m_bucketOffset;
+				uint64_t m_fileSize;
+			};
+
+			struct Entry //A bucket, empty when the name is
+			{
+				uint64_t m_hash;
+				uint64_t m_dataOffset;
+				uint64_t m_size;
+				uint32_t m_nameOffset;
+				uint32_t m_nameLength;
+			};
+
+			static uint64_t Hash(const std::string& path)
+			{
+				return Fnv1a(path.data(), path.size());
+			}
+
+			static uint64_t AlignUp(const uint64_t offset, const uint64_t alignment = s_alignment)
+			{
+				return (offset + alignment - 1) & ~(alignment - 1);
+			}
+
+			static bool Within(const uint64_t offset, const uint64_t size, const uint64_t limit)
+			{
+				return offset <= limit && size <= limit - offset;
+			}
+		}
+
+		//A mounted .pak, files are handed out as pointers into the mapping without copying
+		class AssetPack
+		{
+		public:
+			AssetPack()
+				:m_buckets(nullptr)
+				, m_bucketMask(0)
+				, m_compressed(false)
+			{
+			}
+
+			bool Open(const std::string& packName)
+			{
+				if (!m_file.Open(packName) || !Validate())
+				{
+					m_file.Close();
+					return false;
+				}
+
+				PakFormat::Header header;
+				std::memcpy(&header, m_file.Data(), sizeof(header));
+				m_buckets = reinterpret_cast<const PakFormat::Entry*>(m_file.Data() + header.m_bucketOffset);
+				m_bucketMask = header.m_bucketCount - 1;
+				m_compressed = std::memcmp(header.m_magic, PakFormat::s_compressedMagic, sizeof(PakFormat::s_compressedMagic)) == 0;
+				return true;
+			}
+
+			//Find then hands out the stored chunks, see PakFormat
+			bool IsCompressed() const
+			{
+				return m_compressed;
+			}
+
+			bool Find(const std::string& name, const char*& data, size_t& size) const
+			{
+				if (m_buckets == nullptr)
+					return false;
+
+				const auto path = CanonicalPath(name);
+				const auto hash = PakFormat::Hash(path);
+				for (auto i = static_cast<uint32_t>(hash) & m_bucketMask;; i = (i + 1) & m_bucketMask)
+				{
+					const auto& entry = m_buckets[i];
+					if (entry.m_nameLength == 0)
+						return false;
+
+					if (entry.m_hash == hash && entry.m_nameLength == path.size() && std::memcmp(m_file.Data() + entry.m_nameOffset, path.data(), path.size()) == 0)
+					{
+						data = m_file.Data() + entry.m_dataOffset;
+						size = static_cast<size_t>(entry.m_size);
+						return true;
+					}
+				}
+			}
+
+		private:
+			AssetPack(const AssetPack&) = delete;
+
+			bool Validate() const
+			{
+				const auto size = m_file.Size();
+				if (size < sizeof(PakFormat::Header))
+					return false;
+
+				PakFormat::Header header;
+				std::memcpy(&header, m_file.Data(), sizeof(header));
+				const bool knownMagic = std::memcmp(header.m_magic, PakFormat::s_magic, sizeof(PakFormat::s_magic)) == 0
+					|| std::memcmp(header.m_magic, PakFormat::s_compressedMagic, sizeof(PakFormat::s_compressedMagic)) == 0;
+				if (!knownMagic || header.m_version != PakFormat::s_version || header.m_fileSize != size
+					|| header.m_bucketCount <= header.m_entryCount || (header.m_bucketCount & (header.m_bucketCount - 1)) != 0 || header.m_bucketOffset % 8 != 0
+					|| !PakFormat::Within(header.m_bucketOffset, static_cast<uint64_t>(header.m_bucketCount) * sizeof(PakFormat::Entry), size))
+					return false;
+
+				const auto* buckets = reinterpret_cast<const PakFormat::Entry*>(m_file.Data() + header.m_bucketOffset);
+				uint32_t entries = 0;
+				for (uint32_t i = 0; i != header.m_bucketCount; ++i)
+				{
+					const auto& entry = buckets[i];
+					if (entry.m_nameLength == 0)
+						continue;
+
+					if (!PakFormat::Within(entry.m_nameOffset, entry.m_nameLength, size) || !PakFormat::Within(entry.m_dataOffset, entry.m_size, size))
+						return false;
+					++entries;
+				}
+				return entries == header.m_entryCount;
+			}
+
+			MappedFile m_file;
+			const PakFormat::Entry* m_buckets;
+			uint32_t m_bucketMask;
+			bool m_compressed;
+		};
+
+		//A span of memory something else owns, kept alive by holding on to the owner
+		class SpanFile : public IFile
+		{
+		public:
+			SpanFile(const std::shared_ptr<const void>& owner, const char* data, const size_t size)
+				:m_owner(owner)
+				, m_data(data)
+				, m_size(size)
+			{
+			}
+
+			const char* Data() const override
+			{
+				return m_data;
+			}
+
+			size_t Size() const override
+			{
+				return m_size;
+			}
+
+		private:
+			std::shared_ptr<const void> m_owner;
+			const char* m_data;
+			size_t m_size;
+		};
+
+		//A loose file, mapped where there's mmap
+		class LooseFile : public IFile
+		{
+		public:
+			MappedFile m_file;
+
+			const char* Data() const override
+			{
+				return m_file.Data();
+			}
+
+			size_t Size() const override
+			{
+				return m_file.Size();
+			}
+		};
+
+		class DirectoryFileSystem : public IFileSystem
+		{
+		public:
+			DirectoryFileSystem(const std::string& directory)
+				:m_directory(directory)
+			{
+			}
+
+			FilePtr Open(const std::string& name) override
+			{
+				auto file = std::make_shared<LooseFile>();
+				if (!file->m_file.Open(Path(name)))
+					return nullptr;
+				return file;
+			}
+
+			bool Exists(const std::string& name) override
+			{
+				struct stat info;
+				return stat(Path(name).c_str(), &info) == 0 && (info.st_mode & S_IFMT) == S_IFREG;
+			}
+
+			bool ModifiedTime(const std::string& name, long long& seconds) override
+			{
+				struct stat info;
+				if (stat(Path(name).c_str(), &info) != 0)
+					return false;
+				seconds = static_cast<long long>(info.st_mtime);
+				return true;
+			}
+
+		private:
+			std::string Path(const std::string& name) const
+			{
+				return m_directory.empty() ? name : m_directory + "/" + name;
+			}
+
+			const std::string m_directory;
+		};
+
+#ifdef PICO_ANDROID
+		//The assets in the apk, which have no time stamps
+		class ApkFileSystem : public IFileSystem
+		{
+		public:
+			ApkFileSystem(SystemSpecificData sData)
+				:m_systemData(sData)
+			{
+			}
+
+			FilePtr Open(const std::string& name) override
+			{
+				auto file = std::make_shared<LooseFile>();
+				if (!file->m_file.OpenAsset(m_systemData, name))
+					return nullptr;
+				return file;
+			}
+
+		private:
+			SystemSpecificData m_systemData;
+		};
+#endif
+
+		//A file of a compressed pack, decompressed into its own buffer
+		class DecompressedFile : public IFile
+		{
+		public:
+			DecompressedFile()
+				:m_storedSize(0)
+			{
+			}
+
+			std::vector<char> m_data;
+			size_t m_storedSize;
+
+			const char* Data() const override
+			{
+				return m_data.data();
+			}
+
+			size_t Size() const override
+			{
+				return m_data.size();
+			}
+
+			size_t StoredSize() const override
+			{
+				return m_storedSize;
+			}
+		};
+
+		class PackFileSystem : public IFileSystem
+		{
+		public:
+			PackFileSystem(const std::shared_ptr<AssetPack>& pack, JobSystem* jobs)
+				:m_pack(pack)
+				, m_jobs(jobs)
+			{
+			}
+
+			FilePtr Open(const std::string& name) override
+			{
+				const char* data = nullptr;
+				size_t size = 0;
+				if (!m_pack->Find(name, data, size))
+					return nullptr;
+				if (!m_pack->IsCompressed())
+					return std::make_shared<SpanFile>(m_pack, data, size); //The pack stays mapped while the file is used
+
+				auto file = std::make_shared<DecompressedFile>();
+				if (!Decompress(data, size, *file))
+					throw EngineException(("Corrupt file in pack:" + name).c_str());
+				return file;
+			}
+
+			bool Exists(const std::string& name) override
+			{
+				const char* data = nullptr;
+				size_t size = 0;
+				return m_pack->Find(name, data, size);
+			}
+
+		private:
+			static const uint32_t s_inlineChunks = 4; //Files up to this many chunks aren't worth handing to other threads
+
+			//Straight from the mapping into the file's buffer, a chunk per job for larger files
+			bool Decompress(const char* data, const size_t size, DecompressedFile& file) const
+			{
+				PakFormat::ChunkHeader header;
+				if (size < sizeof(header))
+					return false;
+				std::memcpy(&header, data, sizeof(header));
+
+				//The size is only allocated once it's no more than the chunks hold, and every chunk takes a size in the
+				//table and at least a byte of the file, so a damaged header can't ask for more than the file can expand to
+				const uint64_t tableSize = static_cast<uint64_t>(header.m_chunkCount) * sizeof(uint32_t);
+				if (header.m_size > std::numeric_limits<size_t>::max() || header.m_size > static_cast<uint64_t>(header.m_chunkCount) * PakFormat::s_chunkSize
+					|| header.m_chunkCount != header.m_size / PakFormat::s_chunkSize + (header.m_size % PakFormat::s_chunkSize != 0 ? 1 : 0)
+					|| !PakFormat::Within(sizeof(header), tableSize, size))
+					return false;
+
+				std::vector<uint32_t> storedSizes(header.m_chunkCount);
+				if (header.m_chunkCount != 0)
+					std::memcpy(&storedSizes[0], data + sizeof(header), static_cast<size_t>(tableSize));
+				std::vector<uint64_t> offsets(header.m_chunkCount + 1, sizeof(header) + tableSize);
+				for (uint32_t i = 0; i != header.m_chunkCount; ++i)
+				{
+					const uint32_t storedSize = storedSizes[i] & ~PakFormat::s_storedChunk;
+					if (storedSize == 0)
+						return false;
+					offsets[i + 1] = offsets[i] + storedSize;
+				}
+				if (offsets.back() > size)
+					return false;
+
+				file.m_data.resize(static_cast<size_t>(header.m_size));
+				file.m_storedSize = size;
+				std::atomic<bool> intact(true);
+				const auto decompressChunks = [&](const size_t begin, const size_t end)
+				{
+					for (auto i = begin; i != end; ++i)
+					{
+						const auto chunkSize = static_cast<size_t>(std::min<uint64_t>(PakFormat::s_chunkSize, header.m_size - i * static_cast<uint64_t>(PakFormat::s_chunkSize)));
+						const auto storedSize = static_cast<size_t>(offsets[i + 1] - offsets[i]);
+						const char* in = data + offsets[i];
+						char* out = &file.m_data[i * PakFormat::s_chunkSize];
+						if ((storedSizes[i] & PakFormat::s_storedChunk) != 0)
+						{
+							if (storedSize == chunkSize)
+								std::memcpy(out, in, chunkSize);
+							else
+								intact = false;
+						}
+						else if (!Lz4::Decompress(in, storedSize, out, chunkSize))
+							intact = false;
+					}
+				};
+
+				if (m_jobs == nullptr || header.m_chunkCount <= s_inlineChunks)
+					decompressChunks(0, header.m_chunkCount);
+				else
+					m_jobs->ParallelFor(header.m_chunkCount, decompressChunks);
+				return intact;
+			}
+
+			std::shared_ptr<AssetPack> m_pack;
+			JobSystem* m_jobs; //Decompresses large files of a compressed pack, nullptr does it all on the opening thread
+		};
+
+		//Files by canonical path, pointing into storage when it's given and into the caller's buffers otherwise.
+		//Never changed after construction, so it's read without locking.
+		class MemoryFileSystem : public IFileSystem
+		{
+		public:
+			MemoryFileSystem(const std::vector<MemoryFile>& files, const std::shared_ptr<std::vector<char>>& storage)
+				:m_storage(storage)
+			{
+				for (const auto& file : files)
+					m_files[CanonicalPath(file.m_name)] = std::make_pair(file.m_data, file.m_size);
+			}
+
+			FilePtr Open(const std::string& name) override
+			{
+				const auto iter = m_files.find(CanonicalPath(name));
+				if (iter == std::end(m_files))
+					return nullptr;
+				return std::make_shared<SpanFile>(m_storage, iter->second.first, iter->second.second);
+			}
+
+			bool Exists(const std::string& name) override
+			{
+				return m_files.find(CanonicalPath(name)) != std::end(m_files);
+			}
+
+		private:
+			std::unordered_map<std::string, std::pair<const char*, size_t>> m_files;
+			std::shared_ptr<std::vector<char>> m_storage;
+		};
+
+		const size_t s_memoryFileAlignment = 16; //Enough for the tables of a cooked mesh
+
+		FileSystemPtr CreateDirectoryFileSystem(const std::string& directory)
+		{
+			return std::make_shared<DirectoryFileSystem>(directory);
+		}
+
+		FileSystemPtr CreatePackFileSystem(const std::string& packName, JobSystem* jobs)
+		{
+			auto pack = std::make_shared<AssetPack>();
+			if (!pack->Open(packName))
+				throw EngineException(("Failed to mount pack:" + packName).c_str());
+			return std::make_shared<PackFileSystem>(pack, jobs);
+		}
+
+		FileSystemPtr CreateMemoryFileSystem(const std::vector<MemoryFile>& files)
+		{
+			return std::make_shared<MemoryFileSystem>(files, nullptr);
+		}
+
+		FileSystemPtr CreateMemoryFileSystem(const FileSystemPtr& source, const std::vector<std::string>& names)
+		{
+			std::vector<FilePtr> sourceFiles;
+			size_t total = 0;
+			for (const auto& name : names)
+			{
+				auto file = source->Open(name);
+				if (!file)
+					throw EngineException(("Failed to load into memory:" + name).c_str());
+				total += static_cast<size_t>(PakFormat::AlignUp(file->Size(), s_memoryFileAlignment));
+				sourceFiles.push_back(file);
+			}
+
+			//One block for all of them, each aligned for a cooked mesh read in place
+			auto storage = std::make_shared<std::vector<char>>(total + s_memoryFileAlignment);
+			const auto base = static_cast<size_t>(PakFormat::AlignUp(reinterpret_cast<uintptr_t>(storage->data()), s_memoryFileAlignment) - reinterpret_cast<uintptr_t>(storage->data()));
+			std::vector<MemoryFile> files;
+			size_t offset = base;
+			for (size_t i = 0; i != names.size(); ++i)
+			{
+				const auto size = sourceFiles[i]->Size();
+				if (size != 0)
+					std::memcpy(&(*storage)[offset], sourceFiles[i]->Data(), size);
+				files.push_back(MemoryFile(names[i], storage->data() + offset, size));
+				offset += static_cast<size_t>(PakFormat::AlignUp(size, s_memoryFileAlignment));
+			}
+			return std::make_shared<MemoryFileSystem>(files, storage);
+		}
+
+		//The mounted file systems in search order, the highest priority first and the last mounted first among equal
+		//ones. Also counts what each of them serves.
+		class FileSystems
+		{
+		public:
+			FileSystems()
+			{
+			}
+
+			void Mount(const FileSystemPtr& fileSystem, const int priority)
+			{
+				auto mount = std::make_shared<MountedFileSystem>(fileSystem, priority);
+				std::lock_guard<std::mutex> lock(m_mutex);
+				const auto position = std::find_if(m_mounts.begin(), m_mounts.end(), [priority](const std::shared_ptr<MountedFileSystem>& mounted)
+				{
+					return mounted->m_priority <= priority;
+				});
+				m_mounts.insert(position, mount);
+			}
+
+			bool Unmount(const FileSystemPtr& fileSystem)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				const auto iter = std::find_if(m_mounts.begin(), m_mounts.end(), [&fileSystem](const std::shared_ptr<MountedFileSystem>& mounted)
+				{
+					return mounted->m_fileSystem == fileSystem;
+				});
+				if (iter == m_mounts.end())
+					return false;
+				m_mounts.erase(iter);
+				return true;
+			}
+
+			//nullptr when none of them has the file
+			FilePtr Open(const std::string& name) const
+			{
+				for (const auto& mount : Mounts())
+				{
+					TimeRetriever timer;
+					auto file = mount->m_fileSystem->Open(name);
+					const auto seconds = timer.ElapsedTimeInSeconds();
+
+					std::lock_guard<std::mutex> lock(m_mutex);
+					auto& stats = mount->m_stats;
+					stats.m_seconds += seconds;
+					if (!file)
+					{
+						++stats.m_misses;
+						continue;
+					}
+					++stats.m_opens;
+					stats.m_bytes += file->Size();
+					stats.m_storedBytes += file->StoredSize();
+					return file;
+				}
+				return nullptr;
+			}
+
+			//The one Open would read the file from
+			FileSystemPtr Find(const std::string& name) const
+			{
+				for (const auto& mount : Mounts())
+				{
+					if (mount->m_fileSystem->Exists(name))
+						return mount->m_fileSystem;
+				}
+				return nullptr;
+			}
+
+			FileSystemStats Stats(const FileSystemPtr& fileSystem) const
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				for (const auto& mount : m_mounts)
+				{
+					if (mount->m_fileSystem == fileSystem)
+						return mount->m_stats;
+				}
+				return FileSystemStats();
+			}
+
+		private:
+			FileSystems(const FileSystems&) = delete;
+
+			struct MountedFileSystem
+			{
+				MountedFileSystem(const FileSystemPtr& fileSystem, const int priority)
+					:m_fileSystem(fileSystem)
+					, m_priority(priority)
+				{}
+
+				FileSystemPtr m_fileSystem;
+				int m_priority;
+				FileSystemStats m_stats; //Guarded by the mutex of FileSystems
+			};
+
+			//A copy, so the files are opened without holding the lock
+			std::vector<std::shared_ptr<MountedFileSystem>> Mounts() const
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				return m_mounts;
+			}
+
+			mutable std::mutex m_mutex;
+			std::vector<std::shared_ptr<MountedFileSystem>> m_mounts;
+		};
+
+#if defined(PICO_PI) || defined(PICO_WINDOWS)
+		//Regular files below directory, as paths relative to it
+		static void ListFiles(const std::string& directory, const std::string& prefix, std::vector<std::string>& files)
+		{
+#ifdef PICO_WINDOWS
+			_finddata_t info;
+			const auto handle = _findfirst((directory + "/*").c_str(), &info);
+			if (handle == -1)
+				return;
+
+			do
+			{
+				const std::string name(info.name);
+				if (name == "." || name == "..")
+					continue;
+
+				if ((info.attrib & _A_SUBDIR) != 0)
+					ListFiles(directory + "/" + name, prefix + name + "/", files);
+				else
+					files.push_back(prefix + name);
+			} while (_findnext(handle, &info) == 0);
+			_findclose(handle);
+#else
+			DIR* dir = opendir(directory.c_str());
+			if (dir == nullptr)
+				return;
+
+			while (dirent* entry = readdir(dir))
+			{
+				const std::string name(entry->d_name);
+				if (name == "." || name == "..")
+					continue;
+
+				struct stat info;
+				if (stat((directory + "/" + name).c_str(), &info) != 0)
+					continue;
+
+				if (S_ISDIR(info.st_mode))
+					ListFiles(directory + "/" + name, prefix + name + "/", files);
+				else if (S_ISREG(info.st_mode))
+					files.push_back(prefix + name);
+			}
+			closedir(dir);
+#endif
+		}
+
+		//A file of a compressed pack as it's stored, see PakFormat
+		static void CompressPackFile(const char* data, const size_t size, std::vector<char>& stored)
+		{
+			PakFormat::ChunkHeader header;
+			header.m_size = size;
+			header.m_chunkCount = static_cast<uint32_t>((size + PakFormat::s_chunkSize - 1) / PakFormat::s_chunkSize);
+			header.m_padding = 0;
+
+			const size_t tableSize = header.m_chunkCount * sizeof(uint32_t);
+			stored.assign(sizeof(header) + tableSize, 0);
+			std::memcpy(&stored[0], &header, sizeof(header));
+			std::vector<char> chunk(PakFormat::s_chunkSize);
+			for (uint32_t i = 0; i != header.m_chunkCount; ++i)
+			{
+				const char* in = data + static_cast<size_t>(i) * PakFormat::s_chunkSize;
+				const auto chunkSize = std::min<size_t>(PakFormat::s_chunkSize, size - static_cast<size_t>(i) * PakFormat::s_chunkSize);
+				auto storedSize = static_cast<uint32_t>(Lz4::Compress(in, chunkSize, &chunk[0], chunkSize - 1));
+				if (storedSize == 0) //Doesn't get smaller
+				{
+					storedSize = static_cast<uint32_t>(chunkSize) | PakFormat::s_storedChunk;
+					stored.insert(stored.end(), in, in + chunkSize);
+				}
+				else
+					stored.insert(stored.end(), chunk.begin(), chunk.begin() + storedSize);
+				std::memcpy(&stored[sizeof(header) + i * sizeof(uint32_t)], &storedSize, sizeof(storedSize));
+			}
+		}
+
+		void BuildAssetPack(const std::string& directory, const std::string& packName, const bool compress)
+		{
+			std::vector<std::string> files;
+			ListFiles(directory, "", files);
+			std::sort(std::begin(files), std::end(files));
+
+			std::vector<std::shared_ptr<MappedFile>> contents;
+			for (const auto& file : files)
+			{
+				auto content = std::make_shared<MappedFile>();
+				if (!content->Open(directory + "/" + file))
+					throw EngineException(("Failed to read file for pack:" + file).c_str());
+				contents.push_back(content);
+			}
+
+			//What goes into the pack for each file, the file itself unless it's compressed
+			std::vector<std::vector<char>> compressed(compress ? files.size() : 0);
+			std::vector<const char*> storedData;
+			std::vector<uint64_t> storedSizes;
+			for (size_t i = 0; i != files.size(); ++i)
+			{
+				if (compress)
+				{
+					CompressPackFile(contents[i]->Data(), contents[i]->Size(), compressed[i]);
+					contents[i]->Close();
+				}
+				storedData.push_back(compress ? compressed[i].data() : contents[i]->Data());
+				storedSizes.push_back(compress ? compressed[i].size() : contents[i]->Size());
+			}
+			const auto alignment = compress ? PakFormat::s_compressedAlignment : PakFormat::s_alignment;
+
+			PakFormat::Header header;
+			std::memcpy(header.m_magic, compress ? PakFormat::s_compressedMagic : PakFormat::s_magic, sizeof(PakFormat::s_magic));
+			header.m_version = PakFormat::s_version;
+			header.m_entryCount = static_cast<uint32_t>(files.size());
+			header.m_bucketCount = 1;
+			while (header.m_bucketCount <= header.m_entryCount * 2)
+				header.m_bucketCount *= 2;
+			header.m_bucketOffset = sizeof(PakFormat::Header);
+
+			std::vector<std::string> paths;
+			size_t namesSize = 0;
+			for (const auto& file : files)
+			{
+				paths.push_back(CanonicalPath(file));
+				namesSize += paths.back().size();
+			}
+
+			std::vector<PakFormat::Entry> buckets(header.m_bucketCount);
+			std::memset(&buckets[0], 0, buckets.size() * sizeof(PakFormat::Entry));
+			const uint64_t namesOffset = header.m_bucketOffset + buckets.size() * sizeof(PakFormat::Entry);
+			std::string names;
+			std::vector<uint64_t> dataOffsets;
+			uint64_t offset = PakFormat::AlignUp(namesOffset + namesSize, alignment);
+			for (size_t i = 0; i != files.size(); ++i)
+			{
+				const auto& path = paths[i];
+				const auto hash = PakFormat::Hash(path);
+				auto bucket = static_cast<uint32_t>(hash) & (header.m_bucketCount - 1);
+				while (buckets[bucket].m_nameLength != 0)
+					bucket = (bucket + 1) & (header.m_bucketCount - 1);
+
+				auto& entry = buckets[bucket];
+				entry.m_hash = hash;
+				entry.m_dataOffset = offset;
+				entry.m_size = storedSizes[i];
+				entry.m_nameOffset = static_cast<uint32_t>(namesOffset + names.size());
+				entry.m_nameLength = static_cast<uint32_t>(path.size());
+				names += path;
+
+				dataOffsets.push_back(offset);
+				offset = PakFormat::AlignUp(offset + entry.m_size, alignment);
+			}
+			header.m_fileSize = offset;
+
+			std::ofstream pack(packName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			pack.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			pack.write(reinterpret_cast<const char*>(&buckets[0]), buckets.size() * sizeof(PakFormat::Entry));
+			pack.write(names.data(), names.size());
+
+			const std::vector<char> padding(static_cast<size_t>(PakFormat::s_alignment), 0);
+			uint64_t written = namesOffset + names.size();
+			for (size_t i = 0; i != files.size(); ++i)
+			{
+				pack.write(&padding[0], static_cast<std::streamsize>(dataOffsets[i] - written));
+				if (storedSizes[i] != 0)
+					pack.write(storedData[i], static_cast<std::streamsize>(storedSizes[i]));
+				written = dataOffsets[i] + storedSizes[i];
+			}
+			pack.write(&padding[0], static_cast<std::streamsize>(header.m_fileSize - written));
+
+			if (!pack)
+				throw EngineException(("Failed to write pack:" + packName).c_str());
+		}
+
+		void BuildEmbeddedAssets(const std::string& directory, const std::string& sourceName, const std::string& functionName)
+		{
+			std::vector<std::string> files;
+			ListFiles(directory, "", files);
+			std::sort(std::begin(files), std::end(files));
+
+			std::ofstream source(sourceName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			source << "//Generated by Pico::BuildEmbeddedAssets from " << directory << ", rebuild it rather than editing\n";
+			source << "#include \"picoengine.h\"\n\nnamespace\n{\n";
+
+			static const char s_hex[] = "0123456789abcdef";
+			std::vector<size_t> sizes;
+			for (size_t i = 0; i != files.size(); ++i)
+			{
+				MappedFile content;
+				if (!content.Open(directory + "/" + files[i]))
+					throw EngineException(("Failed to read file to embed:" + files[i]).c_str());
+
+				//Aligned so a cooked mesh can be read in place. Empty files still get a byte, arrays can't be empty.
+				source << "\t//" << CanonicalPath(files[i]) << "\n\tPICO_ALIGN16 const unsigned char s_asset" << i << "[] =\n\t{";
+				std::string line;
+				for (size_t j = 0; j != std::max<size_t>(content.Size(), 1); ++j)
+				{
+					const auto byte = j < content.Size() ? static_cast<unsigned char>(content.Data()[j]) : 0;
+					line += j % 32 == 0 ? "\n\t\t0x" : "0x";
+					line += s_hex[byte >> 4];
+					line += s_hex[byte & 15];
+					line += ',';
+				}
+				source << line << "\n\t};\n\n";
+				sizes.push_back(content.Size());
+			}
+
+			source << "}\n\n//Serves the files straight from the arrays above, see Pico::BuildEmbeddedAssets\n";
+			source << "CogitareComputing::Pico::FileSystemPtr " << functionName << "()\n{\n";
+			source << "\tstd::vector<CogitareComputing::Pico::MemoryFile> files;\n";
+			for (size_t i = 0; i != files.size(); ++i)
+			{
+				std::string name;
+				for (const auto c : CanonicalPath(files[i]))
+				{
+					if (c == '"' || c == '\\')
+						name += '\\';
+					name += c;
+				}
+				source << "\tfiles.push_back(CogitareComputing::Pico::MemoryFile(\"" << name << "\", reinterpret_cast<const char*>(s_asset" << i << "), " << sizes[i] << "));\n";
+			}
+			source << "\treturn CogitareComputing::Pico::CreateMemoryFileSystem(files);\n}\n";
+
+			if (!source)
+				throw EngineException(("Failed to write embedded assets:" + sourceName).c_str());
+		}
+#endif
+
+		//How a texture is filtered and wrapped, part of the cache key since the same file may be wanted both ways
+		struct TextureSampling
+		{
+			TextureSampling()
+				:m_minFilter(GL_NEAREST)
+				, m_magFilter(GL_NEAREST)
+				, m_wrapS(GL_REPEAT)
+				, m_wrapT(GL_REPEAT)
+			{}
+
+			GLint m_minFilter;
+			GLint m_magFilter;
+			GLint m_wrapS;
+			GLint m_wrapT;
+		};
+
+		//The Quite OK Image format https://qoiformat.org , a byte oriented RGBA stream that decodes far faster than PNG
+		namespace QoiFormat
+		{
+			const char s_magic[4] = { 'q', 'o', 'i', 'f' };
+			const size_t s_headerSize = 14; //Magic, big endian width and height, channels and colour space
+			const unsigned char s_end[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+			const uint32_t s_maxPixels = 400000000; //The spec's limit, keeps width * height * 4 in 32 bits
+
+			enum Op
+			{
+				Index = 0x00,
+				Diff = 0x40,
+				Luma = 0x80,
+				Run = 0xc0,
+				Rgb = 0xfe,
+				Rgba = 0xff,
+				Mask = 0xc0
+			};
+
+			inline size_t HashIndex(const unsigned char* pixel)
+			{
+				return (pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64;
+			}
+
+			inline uint32_t ReadBigEndian(const unsigned char* p)
+			{
+				return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+			}
+
+			inline void WriteBigEndian(std::vector<char>& out, const uint32_t value)
+			{
+				for (int shift = 24; shift >= 0; shift -= 8)
+					out.push_back(static_cast<char>(value >> shift));
+			}
+
+			inline bool Matches(const char* data, const size_t size)
+			{
+				return size >= sizeof(s_magic) && std::memcmp(data, s_magic, sizeof(s_magic)) == 0;
+			}
+
+			//Pixels go straight to their row in image, bottom-up when flipped. False for anything that isn't a whole image.
+			static bool Decode(const char* data, const size_t size, unsigned long& width, unsigned long& height, std::vector<unsigned char>& image, const bool flipped)
+			{
+				const auto* in = reinterpret_cast<const unsigned char*>(data);
+				if (size < s_headerSize + sizeof(s_end) || !Matches(data, size))
+					return false;
+
+				const uint32_t w = ReadBigEndian(in + 4);
+				const uint32_t h = ReadBigEndian(in + 8);
+				if (w == 0 || h == 0 || h >= s_maxPixels / w || in[12] < 3 || in[12] > 4 || in[13] > 1)
+					return false;
+
+				width = w;
+				height = h;
+				image.resize(static_cast<size_t>(w) * h * 4);
+				unsigned char index[64 * 4] = { 0 };
+				unsigned char pixel[4] = { 0, 0, 0, 255 };
+				const size_t end = size - sizeof(s_end);
+				size_t pos = s_headerSize;
+				uint32_t run = 0;
+				for (uint32_t y = 0; y != h; ++y)
+				{
+					unsigned char* row = &image[static_cast<size_t>(flipped ? h - 1 - y : y) * w * 4];
+					for (uint32_t x = 0; x != w; ++x)
+					{
+						if (run > 0)
+							--run;
+						else
+						{
+							if (pos >= end)
+								return false;
+
+							const unsigned char op = in[pos++];
+							if (op == Rgb || op == Rgba)
+							{
+								const size_t channels = op == Rgb ? 3 : 4;
+								if (end - pos < channels)
+									return false;
+								std::memcpy(pixel, in + pos, channels);
+								pos += channels;
+							}
+							else
+							{
+								switch (op & Mask)
+								{
+								case Index:
+									std::memcpy(pixel, &index[op * 4], 4);
+									break;
+								case Diff:
+									pixel[0] += ((op >> 4) & 3) - 2;
+									pixel[1] += ((op >> 2) & 3) - 2;
+									pixel[2] += (op & 3) - 2;
+									break;
+								case Luma:
+								{
+									if (pos >= end)
+										return false;
+									const int green = (op & 0x3f) - 32;
+									const unsigned char redBlue = in[pos++];
+									pixel[0] += green - 8 + (redBlue >> 4);
+									pixel[1] += green;
+									pixel[2] += green - 8 + (redBlue & 0x0f);
+									break;
+								}
+								default:
+									run = op & 0x3f;
+									break;
+								}
+							}
+							std::memcpy(&index[HashIndex(pixel) * 4], pixel, 4);
+						}
+						std::memcpy(row + x * 4, pixel, 4);
+					}
+				}
+				return true;
+			}
+
+			//rgba is top-down, as it comes from decodePNG
+			static void Encode(const unsigned char* rgba, const uint32_t width, const uint32_t height, std::vector<char>& out)
+			{
+				out.assign(s_magic, s_magic + sizeof(s_magic));
+				WriteBigEndian(out, width);
+				WriteBigEndian(out, height);
+				out.push_back(4); //Channels
+				out.push_back(0); //sRGB with linear alpha
+
+				unsigned char index[64 * 4] = { 0 };
+				unsigned char previous[4] = { 0, 0, 0, 255 };
+				const size_t pixels = static_cast<size_t>(width) * height;
+				int run = 0;
+				for (size_t i = 0; i != pixels; ++i)
+				{
+					const unsigned char* pixel = rgba + i * 4;
+					if (std::memcmp(pixel, previous, 4) == 0)
+					{
+						if (++run == 62 || i + 1 == pixels)
+						{
+							out.push_back(static_cast<char>(Run | (run - 1)));
+							run = 0;
+						}
+						continue;
+					}
+
+					if (run > 0)
+					{
+						out.push_back(static_cast<char>(Run | (run - 1)));
+						run = 0;
+					}
+
+					const size_t hash = HashIndex(pixel);
+					if (std::memcmp(&index[hash * 4], pixel, 4) == 0)
+						out.push_back(static_cast<char>(Index | hash));
+					else
+					{
+						std::memcpy(&index[hash * 4], pixel, 4);
+						const int red = static_cast<signed char>(pixel[0] - previous[0]);
+						const int green = static_cast<signed char>(pixel[1] - previous[1]);
+						const int blue = static_cast<signed char>(pixel[2] - previous[2]);
+						if (pixel[3] != previous[3])
+						{
+							out.push_back(static_cast<char>(Rgba));
+							out.insert(std::end(out), pixel, pixel + 4);
+						}
+						else if (red >= -2 && red <= 1 && green >= -2 && green <= 1 && blue >= -2 && blue <= 1)
+							out.push_back(static_cast<char>(Diff | ((red + 2) << 4) | ((green + 2) << 2) | (blue + 2)));
+						else if (green >= -32 && green <= 31 && red - green >= -8 && red - green <= 7 && blue - green >= -8 && blue - green <= 7)
+						{
+							out.push_back(static_cast<char>(Luma | (green + 32)));
+							out.push_back(static_cast<char>(((red - green + 8) << 4) | (blue - green + 8)));
+						}
+						else
+						{
+							out.push_back(static_cast<char>(Rgb));
+							out.insert(std::end(out), pixel, pixel + 3);
+						}
+					}
+					std::memcpy(previous, pixel, 4);
+				}
+				out.insert(std::end(out), s_end, s_end + sizeof(s_end));
+			}
+		}
+
+		//Uncompressed RGBA, the header and then the rows top-down. Loading is a copy per row.
+		namespace RawTextureFormat
+		{
+			const uint32_t s_version = 1;
+			const char s_magic[4] = { 'P', 'R', 'A', 'W' };
+
+			struct Header
+			{
+				char m_magic[4]; //"PRAW"
+				uint32_t m_version;
+				uint32_t m_width;
+				uint32_t m_height;
+			};
+
+			inline bool Matches(const char* data, const size_t size)
+			{
+				return size >= sizeof(s_magic) && std::memcmp(data, s_magic, sizeof(s_magic)) == 0;
+			}
+
+			//Bottom-up when flipped. False for anything that isn't a whole image.
+			static bool Decode(const char* data, const size_t size, unsigned long& width, unsigned long& height, std::vector<unsigned char>& image, const bool flipped)
+			{
+				Header header;
+				if (size < sizeof(header) || !Matches(data, size))
+					return false;
+
+				std::memcpy(&header, data, sizeof(header));
+				const uint64_t rowSize = static_cast<uint64_t>(header.m_width) * 4;
+				if (header.m_version != s_version || size - sizeof(header) != rowSize * header.m_height)
+					return false;
+
+				width = header.m_width;
+				height = header.m_height;
+				image.resize(static_cast<size_t>(rowSize * height));
+				for (uint32_t y = 0; y != header.m_height; ++y)
+					std::memcpy(&image[static_cast<size_t>((flipped ? height - 1 - y : y) * rowSize)], data + sizeof(header) + y * rowSize, static_cast<size_t>(rowSize));
+				return true;
+			}
+
+			static void Encode(const unsigned char* rgba, const uint32_t width, const uint32_t height, std::vector<char>& out)
+			{
+				Header header;
+				std::memcpy(header.m_magic, s_magic, sizeof(header.m_magic));
+				header.m_version = s_version;
+				header.m_width = width;
+				header.m_height = height;
+				out.assign(reinterpret_cast<const char*>(&header), reinterpret_cast<const char*>(&header) + sizeof(header));
+				out.insert(std::end(out), reinterpret_cast<const char*>(rgba), reinterpret_cast<const char*>(rgba) + static_cast<size_t>(width) * height * 4);
+			}
+		}
+
+		//A decoded texture kept on disk: the header, then the pixels as they're uploaded
+		namespace TextureBlobFormat
+		{
+			const uint32_t s_version = 1;
+			const char s_magic[4] = { 'P', 'T', 'E', 'X' };
+
+			struct Header
+			{
+				char m_magic[4]; //"PTEX"
+				uint32_t m_version;
+				uint64_t m_key; //The TextureDiskCache key it was stored under
+				uint32_t m_width;
+				uint32_t m_height;
+				uint32_t m_format; //pico::PixelFormat
+				uint32_t m_flipped; //Rows bottom-up
+				uint64_t m_pixelSize;
+			};
+
+			inline uint64_t BytesPerPixel(const pico::PixelFormat format)
+			{
+				return format == pico::PixelRGBA8888 ? 4 : format == pico::PixelRGB888 ? 3 : 2;
+			}
+		}
+
+		//Decoded textures kept in a directory between runs, so a texture only goes through the PNG decoder the first
+		//time it's seen. Blobs are named by a hash of the source file's contents and the decode settings, and an index
+		//file keeps their sizes and order of use so the least recently used are removed once the total passes the cap.
+		//Failing to write a blob or the index only costs the decode next time.
+		class TextureDiskCache
+		{
+		public:
+			TextureDiskCache(const std::string& directory, const uint64_t maxBytes)
+				:m_directory(directory.empty() || directory[directory.size() - 1] == '/' || directory[directory.size() - 1] == '\\' ? directory : directory + "/")
+				, m_maxBytes(maxBytes)
+				, m_totalBytes(0)
+				, m_clock(0)
+				, m_indexChanged(false)
+				, m_unsavedStores(0)
+			{
+				LoadIndex();
+			}
+
+			~TextureDiskCache()
+			{
+				if (m_indexChanged)
+					SaveIndex();
+			}
+
+			static uint64_t Key(const char* data, const size_t size, const pico::PixelFormat format, const bool flipped)
+			{
+				const uint32_t settings[2] = { static_cast<uint32_t>(format), flipped ? 1u : 0u };
+				return Fnv1a(reinterpret_cast<const char*>(settings), sizeof(settings), Fnv1a(data, size));
+			}
+
+			//Maps the blob stored under key, false if there is none or it doesn't match the key and decode settings
+			bool Find(const uint64_t key, const pico::PixelFormat format, const bool flipped, MappedFile& blob, unsigned long& width, unsigned long& height)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				auto iter = m_entries.find(key);
+				if (iter == std::end(m_entries))
+					return false;
+
+				TextureBlobFormat::Header header;
+				if (!blob.Open(BlobName(key)) || !Validate(blob, key, format, flipped, header))
+				{
+					blob.Close();
+					Remove(iter);
+					return false;
+				}
+
+				iter->second.m_lastUse = ++m_clock;
+				m_indexChanged = true;
+				width = header.m_width;
+				height = header.m_height;
+				return true;
+			}
+
+			static const unsigned char* Pixels(const MappedFile& blob)
+			{
+				return reinterpret_cast<const unsigned char*>(blob.Data() + sizeof(TextureBlobFormat::Header));
+			}
+
+			void Store(const uint64_t key, const unsigned long width, const unsigned long height, const pico::PixelFormat format, const bool flipped,
+				const std::vector<unsigned char>& pixels)
+			{
+				if (sizeof(TextureBlobFormat::Header) + pixels.size() > m_maxBytes)
+					return;
+
+				TextureBlobFormat::Header header;
+				std::memset(&header, 0, sizeof(header));
+				std::memcpy(header.m_magic, TextureBlobFormat::s_magic, sizeof(header.m_magic));
+				header.m_version = TextureBlobFormat::s_version;
+				header.m_key = key;
+				header.m_width = static_cast<uint32_t>(width);
+				header.m_height = static_cast<uint32_t>(height);
+				header.m_format = static_cast<uint32_t>(format);
+				header.m_flipped = flipped ? 1 : 0;
+				header.m_pixelSize = pixels.size();
+
+				//Written outside the lock under a name of its own, then renamed into place. Two textures with the same
+				//contents can be stored at once, and the first one's blob may already be mapped.
+				std::stringstream tempName;
+				tempName << BlobName(key) << '.' << std::this_thread::get_id() << ".tmp";
+				{
+					std::ofstream file(tempName.str().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+					file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+					if (!pixels.empty())
+						file.write(reinterpret_cast<const char*>(&pixels[0]), pixels.size());
+					if (!file)
+					{
+						file.close();
+						std::remove(tempName.str().c_str());
+						return;
+					}
+				}
+
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (m_entries.find(key) != std::end(m_entries))
+				{
+					std::remove(tempName.str().c_str());
+					return;
+				}
+
+				std::remove(BlobName(key).c_str()); //Left by a run whose index wasn't saved, rename doesn't replace on Windows
+				if (std::rename(tempName.str().c_str(), BlobName(key).c_str()) != 0)
+				{
+					std::remove(tempName.str().c_str());
+					return;
+				}
+
+				auto& entry = m_entries[key];
+				entry.m_size = sizeof(header) + pixels.size();
+				entry.m_lastUse = ++m_clock;
+				m_totalBytes += entry.m_size;
+
+				while (m_totalBytes > m_maxBytes)
+				{
+					const auto oldest = std::min_element(std::begin(m_entries), std::end(m_entries), [](const std::pair<const uint64_t, Entry>& a, const std::pair<const uint64_t, Entry>& b)
+					{
+						return a.second.m_lastUse < b.second.m_lastUse;
+					});
+					Remove(oldest);
+				}
+
+				//Blobs missing from the index are never removed, so it's saved every few stores rather than only on destruction
+				m_indexChanged = true;
+				if (++m_unsavedStores >= s_storesPerSave)
+					SaveIndex();
+			}
+
+		private:
+			TextureDiskCache(const TextureDiskCache&) = delete;
+
+			static const unsigned s_storesPerSave = 16;
+
+			struct Entry
+			{
+				Entry()
+					:m_size(0)
+					, m_lastUse(0)
+				{}
+
+				uint64_t m_size;
+				uint64_t m_lastUse; //Larger is more recent
+			};
+
+			typedef std::unordered_map<uint64_t, Entry> Entries;
+
+			std::string BlobName(const uint64_t key) const
+			{
+				std::stringstream name;
+				name << m_directory << std::hex << std::setw(16) << std::setfill('0') << key << ".ptex";
+				return name.str();
+			}
+
+			std::string IndexName() const
+			{
+				return m_directory + "textures.index";
+			}
+
+			//The pixel size has to be what the dimensions need in the format, and the settings the ones the key was made from
+			static bool Validate(const MappedFile& blob, const uint64_t key, const pico::PixelFormat format, const bool flipped, TextureBlobFormat::Header& header)
+			{
+				if (blob.Size() < sizeof(header))
+					return false;
+
+				std::memcpy(&header, blob.Data(), sizeof(header));
+				if (std::memcmp(header.m_magic, TextureBlobFormat::s_magic, sizeof(header.m_magic)) != 0 || header.m_version != TextureBlobFormat::s_version
+					|| header.m_key != key || header.m_format != static_cast<uint32_t>(format) || header.m_flipped != (flipped ? 1u : 0u))
+					return false;
+
+				const uint64_t pixels = static_cast<uint64_t>(header.m_width) * header.m_height;
+				return pixels <= std::numeric_limits<uint64_t>::max() / TextureBlobFormat::BytesPerPixel(format) && pixels * TextureBlobFormat::BytesPerPixel(format) == header.m_pixelSize
+					&& header.m_pixelSize == blob.Size() - sizeof(header);
+			}
+
+			void Remove(const Entries::iterator iter)
+			{
+				std::remove(BlobName(iter->first).c_str());
+				m_totalBytes -= iter->second.m_size;
+				m_entries.erase(iter);
+				m_indexChanged = true;
+			}
+
+			//A line per blob: key, size and last use
+			void LoadIndex()
+			{
+				std::ifstream index(IndexName().c_str());
+				std::string line;
+				while (std::getline(index, line))
+				{
+					std::istringstream fields(line);
+					uint64_t key = 0;
+					Entry entry;
+					if (!(fields >> std::hex >> key >> std::dec >> entry.m_size >> entry.m_lastUse))
+						continue;
+
+					m_totalBytes += entry.m_size;
+					m_clock = std::max(m_clock, entry.m_lastUse);
+					m_entries[key] = entry;
+				}
+			}
+
+			void SaveIndex()
+			{
+				{
+					std::ofstream index((IndexName() + ".tmp").c_str(), std::ios::out | std::ios::trunc);
+					for (const auto& entry : m_entries)
+						index << std::hex << entry.first << std::dec << ' ' << entry.second.m_size << ' ' << entry.second.m_lastUse << '\n';
+					if (!index)
+						return;
+				}
+				std::remove(IndexName().c_str()); //rename doesn't replace on Windows
+				std::rename((IndexName() + ".tmp").c_str(), IndexName().c_str());
+				m_indexChanged = false;
+				m_unsavedStores = 0;
+			}
+
+			const std::string m_directory;
+			const uint64_t m_maxBytes;
+			std::mutex m_mutex;
+			Entries m_entries;
+			uint64_t m_totalBytes;
+			uint64_t m_clock; //Last use of the most recently used blob
+			bool m_indexChanged; //Since the last save, saved on destruction
+			unsigned m_unsavedStores; //Since the last save
+		};
+
+		class TextureCache;
+
+		//One texture file shared by every mesh referencing it. Whoever reads it first decodes it, the GL texture is
+		//made by the first upload and deleted through the cache once the last mesh lets go of it.
+		class CachedTexture
+		{
+		public:
+			typedef std::function<void(unsigned long& width, unsigned long& height, std::vector<unsigned char>& image, MappedFile& blob)> DecodeFn; //Fills image, or maps a disk cache blob
+
+			CachedTexture(const std::shared_ptr<TextureCache>& cache, const std::string& key, const TextureSampling& sampling)
+				:m_cache(cache)
+				, m_key(key)
+				, m_sampling(sampling)
+				, m_decoded(false)
+				, m_width(0)
+				, m_height(0)
+				, m_textureId(0)
+			{
+			}
+
+			~CachedTexture();
+
+			//Any thread, meshes sharing the texture wait for the one decoding it. decode runs under the texture's lock,
+			//so it mustn't wait on the job system.
+			void Decode(const DecodeFn& decode)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (m_decoded)
+					return;
+
+				decode(m_width, m_height, m_image, m_blob);
+				m_decoded = true;
+			}
+
+			bool IsDecoded()
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				return m_decoded;
+			}
+
+			//Has to run where the GL context is current
+			GLuint Upload()
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (m_textureId != 0)
+					return m_textureId;
+
+				glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+				glGenTextures(1, &m_textureId);
+				glBindTexture(GL_TEXTURE_2D, m_textureId);
+				const unsigned char* pixels = m_blob.Data() != nullptr ? TextureDiskCache::Pixels(m_blob) : m_image.empty() ? nullptr : &m_image[0];
+				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, m_sampling.m_minFilter);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, m_sampling.m_magFilter);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, m_sampling.m_wrapS);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, m_sampling.m_wrapT);
+
+				std::vector<unsigned char>().swap(m_image);
+				m_blob.Close();
+				return m_textureId;
+			}
+
+		private:
+			CachedTexture(const CachedTexture&) = delete;
+
+			std::shared_ptr<TextureCache> m_cache;
+			const std::string m_key;
+			const TextureSampling m_sampling;
+			std::mutex m_mutex;
+			bool m_decoded;
+			unsigned long m_width;
+			unsigned long m_height;
+			std::vector<unsigned char> m_image; //Until uploaded
+			MappedFile m_blob; //Instead of m_image when the disk cache had it
+			GLuint m_textureId;
+		};
+
+		//Engine wide registry of the textures in use, keyed by canonical path and sampling. It only holds weak
+		//references, the meshes own the textures. A texture may be released on any thread, so the GL delete is
+		//queued for DeleteReleased on the thread with the context. So are the buffers of released meshes.
+		class TextureCache : public std::enable_shared_from_this<TextureCache>
+		{
+		public:
+			explicit TextureCache(const size_t maxDecodeBuffers)
+				:m_maxDecodeBuffers(maxDecodeBuffers)
+			{
+			}
+
+			std::shared_ptr<CachedTexture> Acquire(const std::string& path, const TextureSampling& sampling)
+			{
+				const auto key = Key(path, sampling);
+
+				std::lock_guard<std::mutex> lock(m_mutex);
+				auto& entry = m_textures[key];
+				auto texture = entry.lock();
+				if (texture)
+				{
+					++m_stats.m_hits;
+					return texture;
+				}
+
+				++m_stats.m_misses;
+				texture = std::make_shared<CachedTexture>(shared_from_this(), key, sampling);
+				entry = texture;
+				return texture;
+			}
+
+			void Released(const std::string& key, const GLuint textureId)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				auto iter = m_textures.find(key);
+				if (iter != std::end(m_textures) && iter->second.expired()) //Not if the file was loaded again in the meantime
+					m_textures.erase(iter);
+				if (textureId != 0)
+					m_releasedIds.push_back(textureId);
+			}
+
+			void ReleasedBuffers(const GLuint vertexBuffer, const GLuint indexBuffer)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (vertexBuffer != 0)
+					m_releasedBufferIds.push_back(vertexBuffer);
+				if (indexBuffer != 0)
+					m_releasedBufferIds.push_back(indexBuffer);
+			}
+
+			//Has to run where the GL context is current
+			void DeleteReleased()
+			{
+				std::vector<GLuint> releasedIds, releasedBufferIds;
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					releasedIds.swap(m_releasedIds);
+					releasedBufferIds.swap(m_releasedBufferIds);
+				}
+				if (!releasedIds.empty())
+					glDeleteTextures(static_cast<GLsizei>(releasedIds.size()), &releasedIds[0]);
+				if (!releasedBufferIds.empty())
+					glDeleteBuffers(static_cast<GLsizei>(releasedBufferIds.size()), &releasedBufferIds[0]);
+			}
+
+			//Working memory for pico::decodePNG, kept between textures instead of allocated for every decode. Decodes
+			//running at the same time each borrow their own.
+			std::unique_ptr<pico::DecodeBuffers> BorrowDecodeBuffers()
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (m_decodeBuffers.empty())
+					return std::unique_ptr<pico::DecodeBuffers>(new pico::DecodeBuffers());
+
+				auto buffers = std::move(m_decodeBuffers.back());
+				m_decodeBuffers.pop_back();
+				return buffers;
+			}
+
+			//No more are kept than there are threads to decode on, the rest are freed
+			void ReturnDecodeBuffers(std::unique_ptr<pico::DecodeBuffers> buffers)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (m_decodeBuffers.size() < m_maxDecodeBuffers)
+					m_decodeBuffers.push_back(std::move(buffers));
+			}
+
+			//Frees the kept buffers once the loads are done, they grow to fit the largest image decoded
+			void ReleaseDecodeBuffers()
+			{
+				std::vector<std::unique_ptr<pico::DecodeBuffers>> decodeBuffers;
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					decodeBuffers.swap(m_decodeBuffers);
+				}
+			}
+
+			void UseDiskCache(const std::shared_ptr<TextureDiskCache>& diskCache)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_diskCache = diskCache;
+			}
+
+			std::shared_ptr<TextureDiskCache> DiskCache() const
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				return m_diskCache;
+			}
+
+			TextureCacheStats Stats() const
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				auto stats = m_stats;
+				stats.m_textures = m_textures.size();
+				return stats;
+			}
+
+		private:
+			TextureCache(const TextureCache&) = delete;
+
+			static std::string Key(const std::string& path, const TextureSampling& sampling)
+			{
+				std::stringstream key;
+				key << CanonicalPath(path) << '|' << sampling.m_minFilter << ',' << sampling.m_magFilter << ',' << sampling.m_wrapS << ',' << sampling.m_wrapT;
+				return key.str();
+			}
+
+			mutable std::mutex m_mutex;
+			std::unordered_map<std::string, std::weak_ptr<CachedTexture>> m_textures;
+			std::vector<GLuint> m_releasedIds;
+			std::vector<GLuint> m_releasedBufferIds;
+			std::vector<std::unique_ptr<pico::DecodeBuffers>> m_decodeBuffers;
+			const size_t m_maxDecodeBuffers;
+			std::shared_ptr<TextureDiskCache> m_diskCache; //None unless Engine::UseTextureDiskCache was called
+			TextureCacheStats m_stats;
+		};
+
+		CachedTexture::~CachedTexture()
+		{
+			m_cache->Released(m_key, m_textureId);
+		}
+
+		//-------------------------------------------------------------------------------------------------
+
+		//Reads obj files from memory with the same results as tinyobj::LoadObj, which it replaces for meshes. Floats
+		//come out with the same bits, vertices are shared within a group the same way and shapes are split at the same
+		//commands. Large files are split into line aligned chunks parsed in parallel, only the grouping runs serially.
+		//Materials still go through the tinyobj material reader, mtl files are small.
+		namespace ObjParser
+		{
+			const int s_absent = INT_MIN; //Index left out of a face vertex
+			const size_t s_parallelSize = 1 << 20; //Smaller files are parsed on the calling thread
+			const size_t s_minChunkSize = 256 << 10;
+
+			struct RawIndex
+			{
+				int m_v;
+				int m_vt;
+				int m_vn;
+			};
+
+			//The counts are the chunk's own at the face, needed to resolve relative indices
+			struct Face
+			{
+				uint32_t m_firstIndex;
+				uint32_t m_indexCount;
+				uint32_t m_vCount;
+				uint32_t m_vtCount;
+				uint32_t m_vnCount;
+			};
+
+			enum CommandType
+			{
+				Command_Face,
+				Command_UseMaterial,
+				Command_MaterialLibrary,
+				Command_Group,
+				Command_Object
+			};
+
+			struct Command
+			{
+				CommandType m_type;
+				uint32_t m_index; //Into the faces or the names
+			};
+
+			struct Chunk
+			{
+				std::vector<float> m_v;
+				std::vector<float> m_vt;
+				std::vector<float> m_vn;
+				std::vector<RawIndex> m_indices;
+				std::vector<Face> m_faces;
+				std::vector<std::string> m_names;
+				std::vector<Command> m_commands;
+			};
+
+			inline bool IsSpace(const char c)
+			{
+				return c == ' ' || c == '\t';
+			}
+
+			//What atoi and sscanf skip
+			inline bool IsWhiteSpace(const char c)
+			{
+				return c == ' ' || (c >= '\t' && c <= '\r');
+			}
+
+			inline bool IsDigit(const char c)
+			{
+				return c >= '0' && c <= '9';
+			}
+
+			inline char At(const char* p, const char* e, const size_t i)
+			{
+				return static_cast<size_t>(e - p) > i ? p[i] : '\0';
+			}
+
+			inline bool IsCommand(const char* p, const char* e, const char* command, const size_t length)
+			{
+				return static_cast<size_t>(e - p) > length && std::memcmp(p, command, length) == 0 && IsSpace(p[length]);
+			}
+
+			//tinyobj adds up the digits with these, a table gives the same values without calling pow per digit
+			struct PowersOfTen
+			{
+				PowersOfTen()
+				{
+					for (int i = 0; i != s_count; ++i)
+						m_negative[i] = pow(10.0, -i);
+				}
+
+				static const int s_count = 32;
+				double m_negative[s_count];
+			};
+
+			static double NegativePowerOfTen(const int exponent)
+			{
+				static const PowersOfTen s_powers;
+				return exponent < PowersOfTen::s_count ? s_powers.m_negative[exponent] : pow(10.0, -exponent);
+			}
+
+			//tinyobj's tryParseDouble, step for step
+			static bool TryParseDouble(const char* s, const char* end, double& result)
+			{
+				if (s >= end)
+					return false;
+
+				double mantissa = 0.0;
+				int exponent = 0;
+				bool negative = false;
+				const char* p = s;
+				if (*p == '+' || *p == '-')
+					negative = *p++ == '-';
+				else if (!IsDigit(*p))
+					return false;
+
+				int read = 0;
+				while (p != end && IsDigit(*p))
+				{
+					mantissa = mantissa * 10 + static_cast<int>(*p++ - '0');
+					++read;
+				}
+				if (read == 0)
+					return false;
+
+				if (p != end && *p == '.')
+				{
+					++p;
+					read = 1;
+					while (p != end && IsDigit(*p))
+						mantissa += static_cast<int>(*p++ - '0') * NegativePowerOfTen(read++);
+				}
+
+				if (p != end && (*p == 'e' || *p == 'E'))
+				{
+					++p;
+					bool negativeExponent = false;
+					if (p != end && (*p == '+' || *p == '-'))
+						negativeExponent = *p++ == '-';
+					else if (p == end || !IsDigit(*p))
+						return false;
+
+					read = 0;
+					while (p != end && IsDigit(*p))
+					{
+						exponent = exponent * 10 + static_cast<int>(*p++ - '0');
+						++read;
+					}
+					if (read == 0)
+						return false;
+					if (negativeExponent)
+						exponent = -exponent;
+				}
+
+				result = (negative ? -1 : 1) * (exponent == 0 ? mantissa : ldexp(mantissa * pow(5.0, exponent), exponent));
+				return true;
+			}
+
+			static float ParseFloat(const char*& p, const char* e)
+			{
+				while (p != e && IsSpace(*p))
+					++p;
+				const char* end = p;
+				while (end != e && !IsSpace(*end) && *end != '\r')
+					++end;
+
+				double value = 0.0;
+				TryParseDouble(p, end, value);
+				p = end;
+				return static_cast<float>(value);
+			}
+
+			//atoi, which doesn't move p
+			static int ParseInt(const char* p, const char* e)
+			{
+				while (p != e && IsWhiteSpace(*p))
+					++p;
+				bool negative = false;
+				if (p != e && (*p == '+' || *p == '-'))
+					negative = *p++ == '-';
+
+				unsigned int value = 0;
+				while (p != e && IsDigit(*p))
+					value = value * 10 + static_cast<unsigned int>(*p++ - '0');
+				return static_cast<int>(negative ? 0u - value : value);
+			}
+
+			static void SkipIndex(const char*& p, const char* e)
+			{
+				while (p != e && *p != '/' && !IsSpace(*p) && *p != '\r')
+					++p;
+			}
+
+			//i, i/j, i//k or i/j/k
+			static RawIndex ParseFaceVertex(const char*& p, const char* e)
+			{
+				RawIndex index = { ParseInt(p, e), s_absent, s_absent };
+				SkipIndex(p, e);
+				if (p == e || *p != '/')
+					return index;
+
+				++p;
+				if (p != e && *p == '/')
+				{
+					++p;
+					index.m_vn = ParseInt(p, e);
+					SkipIndex(p, e);
+					return index;
+				}
+
+				index.m_vt = ParseInt(p, e);
+				SkipIndex(p, e);
+				if (p == e || *p != '/')
+					return index;
+
+				++p;
+				index.m_vn = ParseInt(p, e);
+				SkipIndex(p, e);
+				return index;
+			}
+
+			//sscanf's %s
+			static std::string ParseWord(const char* p, const char* e)
+			{
+				while (p != e && IsWhiteSpace(*p))
+					++p;
+				const char* end = p;
+				while (end != e && !IsWhiteSpace(*end))
+					++end;
+				return std::string(p, end);
+			}
+
+			static void AddName(Chunk& chunk, const CommandType type, const std::string& name)
+			{
+				const Command command = { type, static_cast<uint32_t>(chunk.m_names.size()) };
+				chunk.m_names.push_back(name);
+				chunk.m_commands.push_back(command);
+			}
+
+			static void ParseLine(const char* p, const char* e, Chunk& chunk)
+			{
+				while (p != e && IsSpace(*p))
+					++p;
+				if (p == e || *p == '#')
+					return;
+
+				if (p[0] == 'v' && IsSpace(At(p, e, 1)))
+				{
+					p += 2;
+					for (int i = 0; i != 3; ++i)
+						chunk.m_v.push_back(ParseFloat(p, e));
+				}
+				else if (p[0] == 'v' && At(p, e, 1) == 'n' && IsSpace(At(p, e, 2)))
+				{
+					p += 3;
+					for (int i = 0; i != 3; ++i)
+						chunk.m_vn.push_back(ParseFloat(p, e));
+				}
+				else if (p[0] == 'v' && At(p, e, 1) == 't' && IsSpace(At(p, e, 2)))
+				{
+					p += 3;
+					for (int i = 0; i != 2; ++i)
+						chunk.m_vt.push_back(ParseFloat(p, e));
+				}
+				else if (p[0] == 'f' && IsSpace(At(p, e, 1)))
+				{
+					p += 2;
+					while (p != e && IsSpace(*p))
+						++p;
+
+					Face face;
+					face.m_firstIndex = static_cast<uint32_t>(chunk.m_indices.size());
+					face.m_vCount = static_cast<uint32_t>(chunk.m_v.size() / 3);
+					face.m_vtCount = static_cast<uint32_t>(chunk.m_vt.size() / 2);
+					face.m_vnCount = static_cast<uint32_t>(chunk.m_vn.size() / 3);
+					while (p != e && *p != '\r')
+					{
+						chunk.m_indices.push_back(ParseFaceVertex(p, e));
+						while (p != e && (IsSpace(*p) || *p == '\r'))
+							++p;
+					}
+					face.m_indexCount = static_cast<uint32_t>(chunk.m_indices.size()) - face.m_firstIndex;
+
+					const Command command = { Command_Face, static_cast<uint32_t>(chunk.m_faces.size()) };
+					chunk.m_faces.push_back(face);
+					chunk.m_commands.push_back(command);
+				}
+				else if (IsCommand(p, e, "usemtl", 6))
+				{
+					AddName(chunk, Command_UseMaterial, ParseWord(p + 7, e));
+				}
+				else if (IsCommand(p, e, "mtllib", 6))
+				{
+					AddName(chunk, Command_MaterialLibrary, ParseWord(p + 7, e));
+				}
+				else if (p[0] == 'g' && IsSpace(At(p, e, 1)))
+				{
+					//The first word is the g itself, the group is named by the second
+					std::string name;
+					for (int word = 0; p != e && *p != '\r'; ++word)
+					{
+						while (p != e && IsSpace(*p))
+							++p;
+						const char* end = p;
+						while (end != e && !IsSpace(*end) && *end != '\r')
+							++end;
+						if (word == 1)
+							name.assign(p, end);
+						p = end;
+						while (p != e && (IsSpace(*p) || *p == '\r'))
+							++p;
+					}
+					AddName(chunk, Command_Group, name);
+				}
+				else if (p[0] == 'o' && IsSpace(At(p, e, 1)))
+				{
+					AddName(chunk, Command_Object, ParseWord(p + 2, e));
+				}
+			}
+
+			static void ParseChunk(const char* p, const char* end, Chunk& chunk)
+			{
+				while (p != end)
+				{
+					const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+					const char* next = lineEnd == nullptr ? end : lineEnd + 1;
+					const char* e = lineEnd == nullptr ? end : lineEnd;
+					if (e != p && e[-1] == '\r')
+						--e;
+					ParseLine(p, e, chunk);
+					p = next;
+				}
+			}
+
+			//Shares vertices between the faces of a group, the open addressing counterpart of tinyobj's std::map
+			class VertexCache
+			{
+			public:
+				VertexCache()
+					:m_slots(1024)
+					, m_generation(1)
+					, m_count(0)
+				{
+				}
+
+				void Clear()
+				{
+					++m_generation;
+					m_count = 0;
+				}
+
+				//Returns the vertex already stored for the key, otherwise stores and returns newVertex
+				unsigned int FindOrAdd(const int v, const int vt, const int vn, const unsigned int newVertex)
+				{
+					if ((m_count + 1) * 2 > m_slots.size())
+						Grow();
+
+					Slot* slot = Probe(v, vt, vn);
+					if (slot->m_generation != m_generation)
+					{
+						const Slot added = { v, vt, vn, m_generation, newVertex };
+						*slot = added;
+						++m_count;
+					}
+					return slot->m_vertex;
+				}
+
+			private:
+				struct Slot
+				{
+					int m_v;
+					int m_vt;
+					int m_vn;
+					uint32_t m_generation; //Slots from older groups count as empty
+					unsigned int m_vertex;
+				};
+
+				Slot* Probe(const int v, const int vt, const int vn)
+				{
+					const size_t mask = m_slots.size() - 1;
+					size_t i = (static_cast<size_t>(v) * 73856093u ^ static_cast<size_t>(vt) * 19349663u ^ static_cast<size_t>(vn) * 83492791u) & mask;
+					for (;; i = (i + 1) & mask)
+					{
+						Slot& slot = m_slots[i];
+						if (slot.m_generation != m_generation || (slot.m_v == v && slot.m_vt == vt && slot.m_vn == vn))
+							return &slot;
+					}
+				}
+
+				void Grow()
+				{
+					std::vector<Slot> old(m_slots.size() * 2);
+					old.swap(m_slots);
+					for (const auto& slot : old)
+					{
+						if (slot.m_generation == m_generation)
+							*Probe(slot.m_v, slot.m_vt, slot.m_vn) = slot;
+					}
+				}
+
+				std::vector<Slot> m_slots;
+				uint32_t m_generation;
+				size_t m_count;
+			};
+
+			//Turns the faces of a group into a shape as tinyobj's exportFaceGroupToShape does
+			class ShapeBuilder
+			{
+			public:
+				ShapeBuilder(const std::vector<float>& v, const std::vector<float>& vt, const std::vector<float>& vn)
+					:m_v(v)
+					, m_vt(vt)
+					, m_vn(vn)
+					, m_faceCount(0)
+				{
+				}
+
+				bool AddFace(const RawIndex* indices, const uint32_t count, const int vCount, const int vtCount, const int vnCount)
+				{
+					++m_faceCount;
+					if (count < 3)
+						return true;
+
+					int face[3][3];
+					Resolve(indices[0], vCount, vtCount, vnCount, face[0]);
+					Resolve(indices[1], vCount, vtCount, vnCount, face[2]);
+					for (uint32_t k = 2; k < count; ++k)
+					{
+						std::copy(face[2], face[2] + 3, face[1]);
+						Resolve(indices[k], vCount, vtCount, vnCount, face[2]);
+						for (int i = 0; i != 3; ++i)
+						{
+							if (!AddVertex(face[i]))
+								return false;
+						}
+					}
+					return true;
+				}
+
+				void Flush(const int material, const std::string& name, std::vector<tinyobj::shape_t>& shapes)
+				{
+					if (m_faceCount == 0)
+						return;
+
+					m_shape.name = name;
+					m_shape.mesh.material_ids.assign(m_shape.mesh.indices.size() / 3, material);
+					shapes.push_back(tinyobj::shape_t());
+					std::swap(shapes.back(), m_shape);
+
+					m_faceCount = 0;
+					m_cache.Clear();
+				}
+
+			private:
+				static int FixIndex(const int index, const int count)
+				{
+					return index > 0 ? index - 1 : (index == 0 ? 0 : count + index);
+				}
+
+				static void Resolve(const RawIndex& raw, const int vCount, const int vtCount, const int vnCount, int* resolved)
+				{
+					resolved[0] = FixIndex(raw.m_v, vCount);
+					resolved[1] = raw.m_vt == s_absent ? -1 : FixIndex(raw.m_vt, vtCount);
+					resolved[2] = raw.m_vn == s_absent ? -1 : FixIndex(raw.m_vn, vnCount);
+				}
+
+				bool AddVertex(const int* index)
+				{
+					auto& mesh = m_shape.mesh;
+					const auto newVertex = static_cast<unsigned int>(mesh.positions.size() / 3);
+					const auto vertex = m_cache.FindOrAdd(index[0], index[1], index[2], newVertex);
+					if (vertex == newVertex)
+					{
+						if (index[0] < 0 || static_cast<size_t>(index[0]) * 3 + 2 >= m_v.size()
+							|| (index[1] >= 0 && static_cast<size_t>(index[1]) * 2 + 1 >= m_vt.size())
+							|| (index[2] >= 0 && static_cast<size_t>(index[2]) * 3 + 2 >= m_vn.size()))
+							return false;
+
+						mesh.positions.insert(mesh.positions.end(), &m_v[index[0] * 3], &m_v[index[0] * 3] + 3);
+						if (index[2] >= 0)
+							mesh.normals.insert(mesh.normals.end(), &m_vn[index[2] * 3], &m_vn[index[2] * 3] + 3);
+						if (index[1] >= 0)
+							mesh.texcoords.insert(mesh.texcoords.end(), &m_vt[index[1] * 2], &m_vt[index[1] * 2] + 2);
+					}
+					mesh.indices.push_back(vertex);
+					return true;
+				}
+
+				const std::vector<float>& m_v;
+				const std::vector<float>& m_vt;
+				const std::vector<float>& m_vn;
+				tinyobj::shape_t m_shape;
+				size_t m_faceCount; //Faces too small for a triangle count too, tinyobj still makes a shape of them
+				VertexCache m_cache;
+			};
+
+			template <typename T>
+			static void Append(std::vector<T>& all, std::vector<T>& part)
+			{
+				if (all.empty())
+					all.swap(part);
+				else
+					all.insert(all.end(), part.begin(), part.end());
+			}
+
+			//Same contract as tinyobj::LoadObj, the error is returned and empty on success
+			static std::string Parse(const char* data, const size_t size, std::vector<tinyobj::shape_t>& shapes, std::vector<tinyobj::material_t>& materials,
+				tinyobj::MaterialReader& readMaterials, JobSystem* jobs)
+			{
+				shapes.clear();
+
+				size_t chunkCount = 1;
+				if (jobs != nullptr && jobs->ThreadCount() > 1 && size >= s_parallelSize)
+					chunkCount = std::min(jobs->ThreadCount() * 4, size / s_minChunkSize);
+
+				std::vector<const char*> bounds(1, data);
+				for (size_t i = 1; i < chunkCount; ++i)
+				{
+					const char* start = std::max(data + size * i / chunkCount, bounds.back());
+					const char* lineEnd = static_cast<const char*>(std::memchr(start, '\n', data + size - start));
+					bounds.push_back(lineEnd == nullptr ? data + size : lineEnd + 1);
+				}
+				bounds.push_back(data + size);
+
+				std::vector<Chunk> chunks(chunkCount);
+				if (chunkCount == 1)
+					ParseChunk(data, data + size, chunks[0]);
+				else
+					jobs->ParallelFor(chunkCount, [&](size_t begin, size_t end)
+					{
+						for (size_t i = begin; i != end; ++i)
+							ParseChunk(bounds[i], bounds[i + 1], chunks[i]);
+					});
+
+				//Every chunk sees the vertices of the ones before it
+				std::vector<int> vBase, vtBase, vnBase;
+				std::vector<float> v, vt, vn;
+				for (auto& chunk : chunks)
+				{
+					vBase.push_back(static_cast<int>(v.size() / 3));
+					vtBase.push_back(static_cast<int>(vt.size() / 2));
+					vnBase.push_back(static_cast<int>(vn.size() / 3));
+					Append(v, chunk.m_v);
+					Append(vt, chunk.m_vt);
+					Append(vn, chunk.m_vn);
+				}
+
+				ShapeBuilder builder(v, vt, vn);
+				std::map<std::string, int> materialMap;
+				int material = -1;
+				std::string name;
+				for (size_t c = 0; c != chunks.size(); ++c)
+				{
+					const auto& chunk = chunks[c];
+					for (const auto& command : chunk.m_commands)
+					{
+						if (command.m_type == Command_Face)
+						{
+							const auto& face = chunk.m_faces[command.m_index];
+							if (!builder.AddFace(&chunk.m_indices[0] + face.m_firstIndex, face.m_indexCount,
+								vBase[c] + static_cast<int>(face.m_vCount), vtBase[c] + static_cast<int>(face.m_vtCount), vnBase[c] + static_cast<int>(face.m_vnCount)))
+								return "Face index out of range";
+							continue;
+						}
+
+						const auto& commandName = chunk.m_names[command.m_index];
+						if (command.m_type == Command_MaterialLibrary)
+						{
+							const auto error = readMaterials(commandName, materials, materialMap);
+							if (!error.empty())
+								return error;
+							continue;
+						}
+
+						builder.Flush(material, name, shapes);
+						if (command.m_type == Command_UseMaterial)
+						{
+							const auto iter = materialMap.find(commandName);
+							material = iter != std::end(materialMap) ? iter->second : -1;
+						}
+						else
+						{
+							name = commandName;
+						}
+					}
+				}
+				builder.Flush(material, name, shapes);
+				return std::string();
+			}
+		}
+
+		//-------------------------------------------------------------------------------------------------
+
+		//The cooked mesh layout, which is also what Mesh draws from: one block holding the interleaved vertices and
+		//the 16 bit indices of every shape, with a range of indices per material. It's mapped and handed to GL as it
+		//is, so it's in the byte order of the machine that cooked it. Offsets are in bytes from the start of the file.
+		//Version 1 files have the shorter header without the vertex format and are all floats.
+		namespace PMeshFormat
+		{
+			const uint32_t s_version = 2;
+
+			//Vertices are position xyz then texture coordinate uv, floats unless these are set
+			enum VertexFormat
+			{
+				VertexFormat_ShortPositions = 1, //Normalised GL_SHORT xyz and a pad, scaled and offset back by the header
+				VertexFormat_ShortTexCoords = 2 //Normalised GL_UNSIGNED_SHORT, only when every coordinate is within 0..1
+			};
+
+			struct Header
+			{
+				char m_magic[4]; //"PMSH"
+				uint32_t m_version;
+				float m_boundingSphere[4]; //Model space, see BoundsTools
+				uint32_t m_fileSize;
+				uint32_t m_textureCount;
+				uint32_t m_textureOffset;
+				uint32_t m_shapeCount;
+				uint32_t m_shapeOffset;
+				uint32_t m_rangeCount;
+				uint32_t m_rangeOffset;
+				uint32_t m_vertexDataOffset;
+				uint32_t m_vertexDataSize;
+				uint32_t m_indexDataOffset;
+				uint32_t m_indexDataSize;
+				//Version 2
+				uint32_t m_vertexFormat; //VertexFormat flags
+				uint32_t m_vertexStride;
+				float m_positionOffset[3]; //The model space position is offset + scale * the normalised stored one
+				float m_positionScale[3];
+			};
+
+			const size_t s_headerSizeV1 = offsetof(Header, m_vertexFormat);
+
+			struct Texture
+			{
+				int32_t m_materialId;
+				uint32_t m_nameOffset;
+				uint32_t m_nameLength;
+			};
+
+			struct Shape
+			{
+				uint32_t m_vertexOffset;
+				uint32_t m_vertexCount;
+				uint32_t m_firstRange;
+				uint32_t m_rangeCount;
+			};
+
+			struct Range
+			{
+				int32_t m_materialId;
+				uint32_t m_indexOffset;
+				uint32_t m_indexCount;
+			};
+
+			const char s_magic[4] = { 'P', 'M', 'S', 'H' };
+
+			static size_t Align4(const size_t size)
+			{
+				return (size + 3) & ~static_cast<size_t>(3);
+			}
+
+			static bool Within(const uint64_t offset, const uint64_t size, const uint64_t limit)
+			{
+				return offset <= limit && size <= limit - offset;
+			}
+
+			static uint32_t PositionSize(const uint32_t format)
+			{
+				return (format & VertexFormat_ShortPositions) != 0 ? 4 * sizeof(GLshort) : 3 * sizeof(GLfloat);
+			}
+
+			static uint32_t VertexStride(const uint32_t format)
+			{
+				return PositionSize(format) + ((format & VertexFormat_ShortTexCoords) != 0 ? 2 * sizeof(GLushort) : 2 * sizeof(GLfloat));
+			}
+
+			//GLES 3 and D3D read a normalised short back as value / 32767, GLES 2 as (2 * value + 1) / 65535. The two
+			//differ by at most one step, so positions are within 1.5 steps of the source on either.
+			const float s_shortPositionError = 1.5f / 32767.0f;
+
+			static GLshort QuantiseSigned(const float value)
+			{
+				return static_cast<GLshort>(floorf(std::max(-1.0f, std::min(1.0f, value)) * 32767.0f + 0.5f));
+			}
+
+			static GLushort QuantiseUnsigned(const float value)
+			{
+				return static_cast<GLushort>(floorf(std::max(0.0f, std::min(1.0f, value)) * 65535.0f + 0.5f));
+			}
+
+			//Version 1 headers are completed with the all float format. Only call on validated data.
+			static Header ReadHeader(const char* data)
+			{
+				Header header;
+				const auto version = reinterpret_cast<const Header*>(data)->m_version;
+				std::memcpy(&header, data, version == 1 ? s_headerSizeV1 : sizeof(Header));
+				if (version == 1)
+				{
+					header.m_vertexFormat = 0;
+					header.m_vertexStride = VertexStride(0);
+					for (int i = 0; i != 3; ++i)
+					{
+						header.m_positionOffset[i] = 0.0f;
+						header.m_positionScale[i] = 1.0f;
+					}
+				}
+				return header;
+			}
+
+			//Rejects anything that would be read outside the file when drawn
+			static bool Validate(const char* data, const size_t size)
+			{
+				if (data == nullptr || size < s_headerSizeV1)
+					return false;
+
+				const auto* stored = reinterpret_cast<const Header*>(data);
+				if (std::memcmp(stored->m_magic, s_magic, sizeof(s_magic)) != 0 || stored->m_version < 1 || stored->m_version > s_version
+					|| (stored->m_version > 1 && size < sizeof(Header)))
+					return false;
+
+				const auto header = ReadHeader(data);
+				if (header.m_fileSize != size || (header.m_vertexFormat & ~3u) != 0 || header.m_vertexStride != VertexStride(header.m_vertexFormat))
+					return false;
+
+				if (!Within(header.m_textureOffset, static_cast<uint64_t>(header.m_textureCount) * sizeof(Texture), size)
+					|| !Within(header.m_shapeOffset, static_cast<uint64_t>(header.m_shapeCount) * sizeof(Shape), size)
+					|| !Within(header.m_rangeOffset, static_cast<uint64_t>(header.m_rangeCount) * sizeof(Range), size)
+					|| !Within(header.m_vertexDataOffset, header.m_vertexDataSize, size)
+					|| !Within(header.m_indexDataOffset, header.m_indexDataSize, size)
+					|| (header.m_textureOffset | header.m_shapeOffset | header.m_rangeOffset | header.m_vertexDataOffset) % 4 != 0
+					|| header.m_indexDataOffset % 2 != 0)
+					return false;
+
+				const auto* textures = reinterpret_cast<const Texture*>(data + header.m_textureOffset);
+				for (uint32_t i = 0; i != header.m_textureCount; ++i)
+				{
+					if (!Within(textures[i].m_nameOffset, textures[i].m_nameLength, size))
+						return false;
+				}
+
+				const auto* ranges = reinterpret_cast<const Range*>(data + header.m_rangeOffset);
+				for (uint32_t i = 0; i != header.m_rangeCount; ++i)
+				{
+					const auto& range = ranges[i];
+					if (range.m_indexOffset < header.m_indexDataOffset || range.m_indexOffset % 2 != 0
+						|| !Within(range.m_indexOffset - header.m_indexDataOffset, static_cast<uint64_t>(range.m_indexCount) * sizeof(GLushort), header.m_indexDataSize))
+						return false;
+				}
+
+				//Every index a shape draws has to be one of its vertices, GL would read past the vertex data otherwise
+				const auto* shapes = reinterpret_cast<const Shape*>(data + header.m_shapeOffset);
+				for (uint32_t i = 0; i != header.m_shapeCount; ++i)
+				{
+					const auto& shape = shapes[i];
+					if (shape.m_vertexOffset < header.m_vertexDataOffset
+						|| !Within(shape.m_vertexOffset - header.m_vertexDataOffset, static_cast<uint64_t>(shape.m_vertexCount) * header.m_vertexStride, header.m_vertexDataSize)
+						|| !Within(shape.m_firstRange, shape.m_rangeCount, header.m_rangeCount))
+						return false;
+
+					for (uint32_t r = shape.m_firstRange; r != shape.m_firstRange + shape.m_rangeCount; ++r)
+					{
+						const auto* indices = reinterpret_cast<const GLushort*>(data + ranges[r].m_indexOffset);
+						const auto maxIndex = std::max_element(indices, indices + ranges[r].m_indexCount);
+						if (maxIndex != indices + ranges[r].m_indexCount && *maxIndex >= shape.m_vertexCount)
+							return false;
+					}
+				}
+				return true;
+			}
+
+			//Lays out what was read from an obj, drawn shape by shape and material id by material id. The triangles of each
+			//material are reordered for the vertex cache and the vertices of each shape are renumbered in the order
+			//they're first drawn, so they're fetched in order too. Compact vertices store positions as normalised shorts
+			//within the bounding box of the whole mesh, and texture coordinates too when they're all within 0..1.
+			static MeshCookStats Cook(const std::vector<tinyobj::shape_t>& objShapes, const std::vector<tinyobj::material_t>& materials, std::vector<char>& cooked,
+				const bool compactVertices)
+			{
+				typedef std::map<int, std::vector<GLushort>> MaterialIndices;
+				std::vector<MaterialIndices> shapeIndices(objShapes.size());
+				std::vector<float> positions; //Of all shapes, for the bounds
+				bool unitTexCoords = true;
+				size_t vertexCount = 0, rangeCount = 0, indexCount = 0, nameBytes = 0;
+				for (size_t s = 0; s != objShapes.size(); ++s)
+				{
+					const auto& mesh = objShapes[s].mesh;
+					if (mesh.positions.size() / 3 > 0x10000)
+						throw EngineException("Failed to cook mesh, a shape has more vertices than 16 bit indices can address");
+
+					positions.insert(positions.end(), mesh.positions.begin(), mesh.positions.end());
+					if (mesh.texcoords.size() >= mesh.positions.size() / 3 * 2)
+					{
+						for (const float coordinate : mesh.texcoords)
+							unitTexCoords = unitTexCoords && coordinate >= 0.0f && coordinate <= 1.0f;
+					}
+
+					const auto faceCount = mesh.indices.size() / 3;
+					for (size_t f = 0; f != faceCount; ++f)
+					{
+						auto& indices = shapeIndices[s][mesh.material_ids[f]];
+						for (auto i = 0; i != 3; ++i)
+							indices.push_back(static_cast<GLushort>(mesh.indices[i + f * 3]));
+					}
+					vertexCount += mesh.positions.size() / 3;
+					rangeCount += shapeIndices[s].size();
+					indexCount += faceCount * 3;
+				}
+
+				MeshCookStats stats;
+				size_t missesBefore = 0, missesAfter = 0;
+				std::vector<std::vector<GLushort>> vertexOrder(objShapes.size());
+				for (size_t s = 0; s != objShapes.size(); ++s)
+				{
+					const auto& mesh = objShapes[s].mesh;
+					const auto shapeVertices = mesh.positions.size() / 3;
+					for (auto& materialIndices : shapeIndices[s])
+					{
+						auto& indices = materialIndices.second;
+						missesBefore += IndexOrderTools::CacheMisses(&indices[0], indices.size(), IndexOrderTools::s_fifoSize);
+						IndexOrderTools::OptimizeTriangleOrder(&indices[0], indices.size(), shapeVertices);
+						IndexOrderTools::ReduceOverdraw(&indices[0], indices.size(), &mesh.positions[0], 3, 1.05f);
+						missesAfter += IndexOrderTools::CacheMisses(&indices[0], indices.size(), IndexOrderTools::s_fifoSize);
+						stats.m_triangles += indices.size() / 3;
+					}
+
+					//Renumbered by first use, vertices no triangle uses go last
+					std::vector<int> newIndex(shapeVertices, -1);
+					auto& order = vertexOrder[s];
+					for (auto& materialIndices : shapeIndices[s])
+					{
+						for (auto& index : materialIndices.second)
+						{
+							if (newIndex[index] < 0)
+							{
+								newIndex[index] = static_cast<int>(order.size());
+								order.push_back(index);
+							}
+							index = static_cast<GLushort>(newIndex[index]);
+						}
+					}
+					for (size_t v = 0; v != shapeVertices; ++v)
+					{
+						if (newIndex[v] < 0)
+							order.push_back(static_cast<GLushort>(v));
+					}
+				}
+				if (stats.m_triangles != 0)
+				{
+					stats.m_acmrBefore = static_cast<float>(missesBefore) / stats.m_triangles;
+					stats.m_acmrAfter = static_cast<float>(missesAfter) / stats.m_triangles;
+				}
+				for (const auto& material : materials)
+					nameBytes += material.diffuse_texname.size();
+
+				Header header;
+				std::memcpy(header.m_magic, s_magic, sizeof(s_magic));
+				header.m_version = s_version;
+				header.m_vertexFormat = compactVertices ? VertexFormat_ShortPositions | (unitTexCoords ? VertexFormat_ShortTexCoords : 0) : 0;
+				header.m_vertexStride = VertexStride(header.m_vertexFormat);
+				const bool shortPositions = (header.m_vertexFormat & VertexFormat_ShortPositions) != 0;
+				const bool shortTexCoords = (header.m_vertexFormat & VertexFormat_ShortTexCoords) != 0;
+				for (int i = 0; i != 3; ++i)
+				{
+					float minP = FLT_MAX, maxP = -FLT_MAX;
+					for (size_t v = i; v < positions.size(); v += 3)
+					{
+						minP = std::min(minP, positions[v]);
+						maxP = std::max(maxP, positions[v]);
+					}
+					const bool scaled = shortPositions && minP < maxP;
+					header.m_positionOffset[i] = scaled ? (minP + maxP) * 0.5f : (shortPositions && minP == maxP ? minP : 0.0f);
+					header.m_positionScale[i] = scaled ? (maxP - minP) * 0.5f : 1.0f;
+				}
+				header.m_textureCount = static_cast<uint32_t>(materials.size());
+				header.m_textureOffset = static_cast<uint32_t>(sizeof(Header));
+				header.m_shapeCount = static_cast<uint32_t>(objShapes.size());
+				header.m_shapeOffset = header.m_textureOffset + header.m_textureCount * sizeof(Texture);
+				header.m_rangeCount = static_cast<uint32_t>(rangeCount);
+				header.m_rangeOffset = header.m_shapeOffset + header.m_shapeCount * sizeof(Shape);
+				const size_t namesOffset = header.m_rangeOffset + header.m_rangeCount * sizeof(Range);
+				header.m_vertexDataOffset = static_cast<uint32_t>(Align4(namesOffset + nameBytes));
+				header.m_vertexDataSize = static_cast<uint32_t>(vertexCount * header.m_vertexStride);
+				header.m_indexDataOffset = header.m_vertexDataOffset + header.m_vertexDataSize;
+				header.m_indexDataSize = static_cast<uint32_t>(indexCount * sizeof(GLushort));
+				header.m_fileSize = static_cast<uint32_t>(Align4(header.m_indexDataOffset + header.m_indexDataSize));
+
+				cooked.assign(header.m_fileSize, 0);
+				char* data = &cooked[0];
+
+				auto* textures = reinterpret_cast<Texture*>(data + header.m_textureOffset);
+				size_t nameOffset = namesOffset;
+				for (size_t i = 0; i != materials.size(); ++i)
+				{
+					const auto& name = materials[i].diffuse_texname;
+					textures[i].m_materialId = static_cast<int32_t>(i);
+					textures[i].m_nameOffset = static_cast<uint32_t>(nameOffset);
+					textures[i].m_nameLength = static_cast<uint32_t>(name.size());
+					std::copy(name.begin(), name.end(), data + nameOffset);
+					nameOffset += name.size();
+				}
+
+				auto* shapes = reinterpret_cast<Shape*>(data + header.m_shapeOffset);
+				auto* ranges = reinterpret_cast<Range*>(data + header.m_rangeOffset);
+				char* vertices = data + header.m_vertexDataOffset;
+				auto* indices = reinterpret_cast<GLushort*>(data + header.m_indexDataOffset);
+				uint32_t range = 0;
+				for (size_t s = 0; s != objShapes.size(); ++s)
+				{
+					const auto& mesh = objShapes[s].mesh;
+					const auto shapeVertices = mesh.positions.size() / 3;
+					const bool textured = mesh.texcoords.size() >= shapeVertices * 2;
+
+					auto& shape = shapes[s];
+					shape.m_vertexOffset = static_cast<uint32_t>(vertices - data);
+					shape.m_vertexCount = static_cast<uint32_t>(shapeVertices);
+					shape.m_firstRange = range;
+					shape.m_rangeCount = static_cast<uint32_t>(shapeIndices[s].size());
+					for (const size_t v : vertexOrder[s])
+					{
+						if (shortPositions)
+						{
+							auto* position = reinterpret_cast<GLshort*>(vertices);
+							for (int i = 0; i != 3; ++i)
+								position[i] = QuantiseSigned((mesh.positions[v * 3 + i] - header.m_positionOffset[i]) / header.m_positionScale[i]);
+							position[3] = 0;
+						}
+						else
+						{
+							std::copy(&mesh.positions[v * 3], &mesh.positions[v * 3] + 3, reinterpret_cast<float*>(vertices));
+						}
+
+						char* texCoord = vertices + PositionSize(header.m_vertexFormat);
+						for (int i = 0; i != 2; ++i)
+						{
+							const float coordinate = textured ? mesh.texcoords[v * 2 + i] : 0.0f;
+							if (shortTexCoords)
+								reinterpret_cast<GLushort*>(texCoord)[i] = QuantiseUnsigned(coordinate);
+							else
+								reinterpret_cast<float*>(texCoord)[i] = coordinate;
+						}
+						vertices += header.m_vertexStride;
+					}
+
+					for (const auto& materialIndices : shapeIndices[s])
+					{
+						ranges[range].m_materialId = materialIndices.first;
+						ranges[range].m_indexOffset = static_cast<uint32_t>(reinterpret_cast<char*>(indices) - data);
+						ranges[range].m_indexCount = static_cast<uint32_t>(materialIndices.second.size());
+						indices = std::copy(materialIndices.second.begin(), materialIndices.second.end(), indices);
+						++range;
+					}
+				}
+
+				auto sphere = BoundsTools::SphereFromPoints(positions.empty() ? nullptr : &positions[0], vertexCount, 3);
+				if (shortPositions && sphere.W >= 0.0f)
+				{
+					const float* scale = header.m_positionScale;
+					sphere.W += s_shortPositionError * sqrtf(scale[0] * scale[0] + scale[1] * scale[1] + scale[2] * scale[2]);
+				}
+				header.m_boundingSphere[0] = sphere.X;
+				header.m_boundingSphere[1] = sphere.Y;
+				header.m_boundingSphere[2] = sphere.Z;
+				header.m_boundingSphere[3] = sphere.W;
+				std::memcpy(data, &header, sizeof(header));
+				return stats;
+			}
+		}
+
+		//-------------------------------------------------------------------------------------------------
+
+		class Mesh : public IMesh
+		{
+		public:
+			Mesh(SystemSpecificData data, const bool useArrayBuffers, const bool compactVertices, const std::shared_ptr<TextureCache>& textureCache,
+				const std::shared_ptr<FileSystems>& fileSystems, JobSystem* jobs)
+				:m_useArrayBuffers(useArrayBuffers)
+				, m_compactVertices(compactVertices)
+				, m_boundingSphere(BoundsTools::EmptySphere())
+				, m_dequantisation(Mat4::Identity())
+				, m_resident(false)
+				, m_failed(false)
+				, m_data(nullptr)
+				, m_vertexBuffer(0)
+				, m_indexBuffer(0)
+				, m_textureCache(textureCache)
+				, m_fileSystems(fileSystems)
+				, m_jobs(jobs)
+				, m_systemData(data)
+			{
+				std::memset(&m_header, 0, sizeof(m_header));
+			}
+
+			//The last reference may go on a job thread, the render thread or the game thread, so the buffers are
+			//deleted later where the context is current
+			virtual ~Mesh()
+			{
+				m_textureCache->ReleasedBuffers(m_vertexBuffer, m_indexBuffer);
+			}
+
+			bool IsResident() const override
+			{
+				return m_resident.load(std::memory_order_acquire);
+			}
+
+			//An asynchronous Read or its Upload threw, the mesh will never become resident
+			void MarkFailed()
+			{
+				m_failed.store(true, std::memory_order_release);
+			}
+
+			bool HasFailed() const override
+			{
+				return m_failed.load(std::memory_order_acquire);
+			}
+
+			bool UsesArrayBuffers() const
+			{
+				return m_useArrayBuffers;
+			}
+
+			//In model space, see BoundsTools
+			const Vec4& BoundingSphere() const
+			{
+				return m_boundingSphere;
+			}
+
+			//Maps the stored positions to model space, applied before the world matrix. nullptr when they're floats.
+			const Mat4* Dequantisation() const
+			{
+				return (m_header.m_vertexFormat & PMeshFormat::VertexFormat_ShortPositions) != 0 ? &m_dequantisation : nullptr;
+			}
+
+			//Only binds the geometry and textures and draws, the uniforms are set up by the render bucket.
+			//Specialised on the vertex source so the buffer object and client memory paths can live side by side.
+			template <bool ArrayBuffers>
+			void Draw(const IGameObject::RenderDetails& renderDetails) const
+			{
+				if (ArrayBuffers)
+				{
+					glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+					glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+					DrawShapes(renderDetails, nullptr, nullptr); //Offsets into the bound buffers
+					glBindBuffer(GL_ARRAY_BUFFER, 0);
+					glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+				}
+				else
+				{
+					DrawShapes(renderDetails, m_data + m_header.m_vertexDataOffset, m_data + m_header.m_indexDataOffset);
+				}
+			}
+
+			//Reads the mesh and decodes the textures, no GL calls so it can run on any thread. A cooked .pmesh is
+			//mapped and used as it is, an obj is cooked in memory first.
+			void Read(const std::string& meshName)
+			{
+				ReleaseData();
+
+				const auto cookedName = CookedMeshName(meshName);
+				if (cookedName.empty())
+				{
+					std::vector<tinyobj::shape_t> shapes;
+					std::vector<tinyobj::material_t> materials;
+					ReadObj(meshName, shapes, materials);
+					PMeshFormat::Cook(shapes, materials, m_cooked, m_compactVertices);
+					m_data = &m_cooked[0];
+				}
+				else
+				{
+					m_file = m_fileSystems->Open(cookedName);
+					if (!m_file)
+						throw EngineException(("Failed to open cooked mesh:" + cookedName).c_str());
+					m_data = m_file->Data();
+					if (!PMeshFormat::Validate(m_data, m_file->Size()))
+						throw EngineException(("Invalid cooked mesh:" + cookedName).c_str());
+				}
+
+				m_header = PMeshFormat::ReadHeader(m_data);
+				m_boundingSphere = Vec4(m_header.m_boundingSphere[0], m_header.m_boundingSphere[1], m_header.m_boundingSphere[2], m_header.m_boundingSphere[3]);
+				for (int i = 0; i != 3; ++i)
+				{
+					m_dequantisation.M[i][i] = m_header.m_positionScale[i];
+					m_dequantisation.M[i][3] = m_header.m_positionOffset[i];
+				}
+
+				const auto* shapes = reinterpret_cast<const PMeshFormat::Shape*>(m_data + m_header.m_shapeOffset);
+				m_shapes.assign(shapes, shapes + m_header.m_shapeCount);
+				const auto* ranges = reinterpret_cast<const PMeshFormat::Range*>(m_data + m_header.m_rangeOffset);
+				m_ranges.assign(ranges, ranges + m_header.m_rangeCount);
+
+				MateralId2TextureNameMap textureNames;
+				const auto* textures = reinterpret_cast<const PMeshFormat::Texture*>(m_data + m_header.m_textureOffset);
+				for (uint32_t i = 0; i != m_header.m_textureCount; ++i)
+					textureNames[textures[i].m_materialId] = std::string(m_data + textures[i].m_nameOffset, textures[i].m_nameLength);
+				AcquireTextures(textureNames);
+			}
+
+			//Has to run where the GL context is current
+			void Upload()
+			{
+				if (m_useArrayBuffers)
+					UploadArrayBuffers();
+
+				for (const auto& texture : m_textures)
+					m_materialId2TextureId[texture.first] = texture.second->Upload();
+				m_resident.store(true, std::memory_order_release);
+			}
+
+		private:
+			void ReadObj(const std::string& meshName, std::vector<tinyobj::shape_t>& shapes, std::vector<tinyobj::material_t>& materials)
+			{
+				const auto file = m_fileSystems->Open(meshName);
+				if (!file)
+					throw EngineException(("Failed to load objfile:Cannot open file [" + meshName + "]").c_str());
+
+				PicoMaterialReader::FileReaderFn fn([this](std::vector<char>& buffer, const std::string& filename)
+				{
+					const auto material = m_fileSystems->Open(filename);
+					if (material)
+						buffer.assign(material->Data(), material->Data() + material->Size());
+					else
+						buffer.clear();
+				});
+				PicoMaterialReader materialReader(fn);
+				const std::string err = ObjParser::Parse(file->Data(), file->Size(), shapes, materials, materialReader, m_jobs);
+				if (!err.empty())
+					throw EngineException(("Failed to load objfile:" + err).c_str());
+			}
+
+			//The mesh itself when it's a .pmesh, otherwise a cooked copy next to it that's at least as new as the source.
+			//Empty when the source has to be read. Packs, memory and apk assets have no time stamps, they hold what ships
+			//so a cooked mesh in them is always the one to use.
+			std::string CookedMeshName(const std::string& meshName) const
+			{
+				const std::string extension(".pmesh");
+				if (meshName.size() >= extension.size() && meshName.compare(meshName.size() - extension.size(), extension.size(), extension) == 0)
+					return meshName;
+
+				const auto dot = meshName.find_last_of('.');
+				const auto separator = meshName.find_last_of("/\\");
+				const bool hasExtension = dot != std::string::npos && (separator == std::string::npos || dot > separator);
+				const auto cookedName = (hasExtension ? meshName.substr(0, dot) : meshName) + extension;
+
+				const auto fileSystem = m_fileSystems->Find(cookedName);
+				if (!fileSystem)
+					return std::string();
+
+				long long cooked = 0;
+				long long source = 0;
+				if (fileSystem->ModifiedTime(cookedName, cooked) && fileSystem->ModifiedTime(meshName, source) && cooked < source)
+					return std::string();
+				return cookedName;
+			}
 
-				const auto shapeCount = shapes.size();
-				m_vertexData.resize(shapeCount);
-				m_textureCoordData.resize(shapeCount);
-				m_indexData.resize(shapeCount);
+			//Straight from the mapped or cooked data, which isn't needed afterwards
+			void UploadArrayBuffers()
+			{
+				glGenBuffers(1, &m_vertexBuffer);
+				glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+				glBufferData(GL_ARRAY_BUFFER, m_header.m_vertexDataSize, m_data + m_header.m_vertexDataOffset, GL_STATIC_DRAW);
+				glGenBuffers(1, &m_indexBuffer);
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+				glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_header.m_indexDataSize, m_data + m_header.m_indexDataOffset, GL_STATIC_DRAW);
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-				int shapeCnt = 0;
-				for (const auto& shape : shapes)
-				{
-					const auto& mesh = shape.mesh;
-					auto& vertexData = m_vertexData[shapeCnt];
-					auto& texCoordData = m_textureCoordData[shapeCnt];
-					vertexData.insert(std::end(vertexData), mesh.positions.begin(), mesh.positions.end());
-					texCoordData.insert(std::end(texCoordData), mesh.texcoords.begin(), mesh.texcoords.end());
+				ReleaseData();
+			}
 
-					auto& indices = m_indexData[shapeCnt];
-					const auto faceCount = mesh.indices.size() / 3;
-					for (size_t f = 0; f != faceCount; ++f)
-					{
-						auto& indexData = indices[mesh.material_ids[f]];
-						for (auto i = 0; i != 3; ++i)
-							indexData.push_back(mesh.indices[i + f * 3]);
-					}
+			void ReleaseData()
+			{
+				std::vector<char>().swap(m_cooked);
+				m_file.reset();
+				m_data = nullptr;
+			}
 
-					++shapeCnt;
-				}
+			void BindMaterial(const int materialId, int& lastestMaterialId) const
+			{
+				if (lastestMaterialId == materialId)
+					return;
 
-#ifdef USE_ARRAY_BUFFERS
-				for (const auto& vData : m_vertexData)
-				{
-					GLuint buffer;
-					glGenBuffers(1, &buffer);
-					glBindBuffer(GL_ARRAY_BUFFER, buffer);
-					glBufferData(GL_ARRAY_BUFFER, vData.size() * sizeof(GLfloat), &vData[0], GL_STATIC_DRAW);
-					m_vertexDataBuffer.push_back(buffer);
-				}
+				lastestMaterialId = materialId;
+				glActiveTexture(GL_TEXTURE0);
+				const auto& textureIter = m_materialId2TextureId.find(materialId);
+				if (textureIter != std::end(m_materialId2TextureId))
+					glBindTexture(GL_TEXTURE_2D, textureIter->second);
+			}
 
-				for (const auto& tData : m_textureCoordData)
+			//vertexData and indexData point at the start of the vertex and index blocks, in client memory or as buffer offsets
+			void DrawShapes(const IGameObject::RenderDetails& renderDetails, const char* vertexData, const char* indexData) const
+			{
+				const GLsizei stride = m_header.m_vertexStride;
+				const bool shortPositions = (m_header.m_vertexFormat & PMeshFormat::VertexFormat_ShortPositions) != 0;
+				const bool shortTexCoords = (m_header.m_vertexFormat & PMeshFormat::VertexFormat_ShortTexCoords) != 0;
+				const auto texCoordOffset = PMeshFormat::PositionSize(m_header.m_vertexFormat);
+				int lastestMaterialId = -1;
+				for (const auto& shape : m_shapes)
 				{
-					GLuint buffer;
-					glGenBuffers(1, &buffer);
-					glBindBuffer(GL_ARRAY_BUFFER, buffer);
-					glBufferData(GL_ARRAY_BUFFER, tData.size() * sizeof(GLfloat), &tData[0], GL_STATIC_DRAW);
-					m_textureCoordDataBuffer.push_back(buffer);
-				}
+					const char* vertices = vertexData + (shape.m_vertexOffset - m_header.m_vertexDataOffset);
+					glVertexAttribPointer(renderDetails.m_positionLoc, 3, shortPositions ? GL_SHORT : GL_FLOAT, shortPositions ? GL_TRUE : GL_FALSE, stride, vertices);
+					glVertexAttribPointer(renderDetails.m_texCoordLoc, 2, shortTexCoords ? GL_UNSIGNED_SHORT : GL_FLOAT, shortTexCoords ? GL_TRUE : GL_FALSE, stride, vertices + texCoordOffset);
 
-				m_indexDataBuffers.resize(shapeCount);
-				for (int shapeCnt = 0; shapeCnt != shapes.size(); ++shapeCnt)
-				{
-					auto& indices = m_indexData[shapeCnt];
-					for (const auto& indexData : indices)
+					const auto rangeEnd = shape.m_firstRange + shape.m_rangeCount;
+					for (auto r = shape.m_firstRange; r != rangeEnd; ++r)
 					{
-						auto& indexBuffers = m_indexDataBuffers[shapeCnt][indexData.first];
-						const auto& theData = indices[indexData.first];
-						glGenBuffers(1, &indexBuffers.second);
-						glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffers.second);
-						glBufferData(GL_ELEMENT_ARRAY_BUFFER, theData.size() * sizeof(GLushort), &theData[0], GL_STATIC_DRAW);
-						indexBuffers.first = theData.size();
+						const auto& range = m_ranges[r];
+						BindMaterial(range.m_materialId, lastestMaterialId);
+						glDrawElements(GL_TRIANGLES, range.m_indexCount, GL_UNSIGNED_SHORT, indexData + (range.m_indexOffset - m_header.m_indexDataOffset));
 					}
 				}
-				glBindBuffer(GL_ARRAY_BUFFER, 0);
-				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-#endif
-				m_materialId2TextureId = LoadTextures(textureNames);
-				return true;
 			}
 
-		private:
-			typedef std::vector<std::vector<GLfloat>> FloatSeries;
-			typedef std::vector<std::map<int, std::vector<GLushort>>> MaterialId2IndexDataMap;
-
-#ifdef USE_ARRAY_BUFFERS
-			std::vector<GLuint> m_vertexDataBuffer;
-			std::vector<GLuint> m_textureCoordDataBuffer;
-			std::vector<std::map<int, std::pair<int, GLuint>>> m_indexDataBuffers;
-#else
-			FloatSeries m_vertexData;
-			FloatSeries m_textureCoordData;
-			MaterialId2IndexDataMap m_indexData;
-#endif
+			const bool m_useArrayBuffers;
+			const bool m_compactVertices; //For obj files cooked on load, .pmesh files have the format they were cooked with
+			Vec4 m_boundingSphere;
+			Mat4 m_dequantisation;
+			std::atomic<bool> m_resident; //Set once uploaded, everything Read wrote is visible to whoever sees it
+			std::atomic<bool> m_failed;
+
+			//The cooked layout, either mapped from a .pmesh or cooked from an obj. Released once it's in buffer objects,
+			//the tables are copied out since they're needed for drawing either way.
+			PMeshFormat::Header m_header;
+			std::vector<PMeshFormat::Shape> m_shapes;
+			std::vector<PMeshFormat::Range> m_ranges;
+			const char* m_data;
+			FilePtr m_file; //A .pmesh, which may point into a mounted pack that it keeps mapped
+			std::vector<char> m_cooked;
+
+			//Buffer objects, used when m_useArrayBuffers is set
+			GLuint m_vertexBuffer;
+			GLuint m_indexBuffer;
 
 			typedef std::map<int, std::string> MateralId2TextureNameMap;
 			typedef std::map<int, int> MaterialId2TextureIdMap;
 			MaterialId2TextureIdMap m_materialId2TextureId;
-
-			//Ripped out of picopng example with additional Android assetmanager support
-			template<typename T>
-			void LoadFile(std::vector<T>& buffer, const std::string& filename) //designed for loading files from hard disk in an std::vector
+			std::map<int, std::shared_ptr<CachedTexture>> m_textures; //Keeps the shared textures alive as long as the mesh
+			std::shared_ptr<TextureCache> m_textureCache;
+			std::shared_ptr<FileSystems> m_fileSystems;
+			JobSystem* m_jobs; //Only used while reading, for parsing large obj files and decoding textures in parallel
+
+			//Textures already used by another mesh are shared, only the ones new to the cache are decoded. The reads and
+			//decodes are spread over the job threads, Upload makes the GL textures afterwards.
+			void AcquireTextures(const MateralId2TextureNameMap& textureNames)
 			{
-#ifdef PICO_ANDROID
-				LoadAssetFile(m_systemData, buffer, filename);
-#else
-				std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+				m_textures.clear();
+				std::vector<std::pair<std::string, std::shared_ptr<CachedTexture>>> decodes; //Once per texture even if several materials use it
+				for (const auto& texture : textureNames)
+				{
+					auto cached = m_textureCache->Acquire(texture.second, TextureSampling());
+					m_textures[texture.first] = cached;
+					const auto sameTexture = [&cached](const std::pair<std::string, std::shared_ptr<CachedTexture>>& decode) { return decode.second == cached; };
+					if (std::none_of(std::begin(decodes), std::end(decodes), sameTexture))
+						decodes.push_back(std::make_pair(texture.second, cached));
+				}
 
-				//get filesize
-				std::streamsize size = 0;
-				if (file.seekg(0, std::ios::end).good()) size = file.tellg();
-				if (file.seekg(0, std::ios::beg).good()) size -= file.tellg();
+				//Errors are kept per texture so the one thrown is the first in material order, whichever thread hit it
+				std::vector<std::exception_ptr> errors(decodes.size());
+				const auto decodeRange = [this, &decodes, &errors](const size_t begin, const size_t end)
+				{
+					for (size_t i = begin; i != end; ++i)
+					{
+						try
+						{
+							DecodeTexture(decodes[i].first, *decodes[i].second);
+						}
+						catch (...)
+						{
+							errors[i] = std::current_exception();
+						}
+					}
+				};
+				if (m_jobs != nullptr && decodes.size() > 1)
+					m_jobs->ParallelFor(decodes.size(), decodeRange);
+				else
+					decodeRange(0, decodes.size());
 
-				//read contents of the file into the vector
-				if (size > 0)
+				for (const auto& error : errors)
 				{
-					buffer.resize((size_t)size);
-					file.read((char*)(&buffer[0]), size);
+					if (error)
+						std::rethrow_exception(error);
 				}
-				else buffer.clear();
-#endif
 			}
 
-			MaterialId2TextureIdMap LoadTextures(const MateralId2TextureNameMap& textureNames)
+			//Any thread
+			void DecodeTexture(const std::string& textureName, CachedTexture& texture)
 			{
-				MaterialId2TextureIdMap materialId2TextureId;
-				std::vector<GLuint> textureIds;
-				textureIds.resize(textureNames.size());
-				glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-				glGenTextures(textureIds.size(), &textureIds[0]);
+				if (texture.IsDecoded())
+					return;
 
-				int i = 0;
-				for (const auto& texture : textureNames)
+				//Opened before Decode takes the texture's lock. Opening a compressed file can wait on the job system,
+				//which may run another mesh's decode of this same texture on this thread.
+				const auto file = m_fileSystems->Open(textureName);
+				texture.Decode([this, &textureName, &file](unsigned long& width, unsigned long& height, std::vector<unsigned char>& image, MappedFile& blob)
 				{
-					auto materialId = texture.first;
-					auto textureName = texture.second;
+					const char* data = file ? file->Data() : nullptr; //Empty when missing, which fails to decode
+					const size_t size = file ? file->Size() : 0;
+
+					//Decoded bottom-up, the row order glTexImage2D wants. QOI and raw textures are told from PNG by their
+					//magic bytes, they decode fast enough to skip the disk cache.
+					if (QoiFormat::Matches(data, size) || RawTextureFormat::Matches(data, size))
+					{
+						const bool decoded = QoiFormat::Matches(data, size) ? QoiFormat::Decode(data, size, width, height, image, true) : RawTextureFormat::Decode(data, size, width, height, image, true);
+						if (!decoded)
+							throw EngineException(("Failed to decode texture:" + textureName).c_str());
+						return;
+					}
+
+					const auto format = pico::PixelRGBA8888;
+					const auto diskCache = m_textureCache->DiskCache();
+					const auto key = diskCache ? TextureDiskCache::Key(data, size, format, true) : 0;
+					if (diskCache && diskCache->Find(key, format, true, blob, width, height))
+						return;
 
-					std::vector<unsigned char> buffer, imageUpsideDown;
-					LoadFile<unsigned char>(buffer, textureName);
-					unsigned long width, height;
-					int error = pico::decodePNG(imageUpsideDown, width, height, buffer.empty() ? 0 : &buffer[0], (unsigned long)buffer.size());
+					auto buffers = m_textureCache->BorrowDecodeBuffers();
+					int error = pico::decodePNG(image, width, height, reinterpret_cast<const unsigned char*>(data), size, format, true, *buffers);
+					m_textureCache->ReturnDecodeBuffers(std::move(buffers));
 					if (error != 0)
 						throw EngineException(("Failed to decode texture:" + textureName).c_str());
 
-					//Flipping the image on Y...
-					std::vector<unsigned char> image;
-					image.reserve(imageUpsideDown.size());
+					if (diskCache)
+						diskCache->Store(key, width, height, format, true, image);
+				});
+			}
+
+			SystemSpecificData m_systemData;
+		};
+
+		//-------------------------------------------------------------------------------------------------
+
+#ifndef PICO_ANDROID
+		MeshCookStats CookMesh(const std::string& objName, const std::string& pmeshName, const bool compactVertices)
+		{
+			std::vector<tinyobj::shape_t> shapes;
+			std::vector<tinyobj::material_t> materials;
+			MappedFile obj;
+			if (!obj.Open(objName))
+				throw EngineException(("Failed to load objfile:Cannot open file [" + objName + "]").c_str());
+
+			tinyobj::MaterialFileReader materialReader("");
+			const std::string err = ObjParser::Parse(obj.Data(), obj.Size(), shapes, materials, materialReader, nullptr);
+			if (!err.empty())
+				throw EngineException(("Failed to load objfile:" + err).c_str());
+
+			std::vector<char> cooked;
+			const auto stats = PMeshFormat::Cook(shapes, materials, cooked, compactVertices);
+
+			std::ofstream file(pmeshName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			file.write(&cooked[0], cooked.size());
+			if (!file)
+				throw EngineException(("Failed to write cooked mesh:" + pmeshName).c_str());
+			return stats;
+		}
+
+		void ConvertTexture(const std::string& pngName, const std::string& textureName)
+		{
+			const auto extension = textureName.substr(std::min(textureName.rfind('.'), textureName.size()));
+			if (extension != ".qoi" && extension != ".rgba")
+				throw EngineException(("Failed to convert texture:Unknown format [" + textureName + "]").c_str());
+
+			MappedFile png;
+			if (!png.Open(pngName))
+				throw EngineException(("Failed to convert texture:Cannot open file [" + pngName + "]").c_str());
+
+			std::vector<unsigned char> rgba;
+			unsigned long width = 0;
+			unsigned long height = 0;
+			if (pico::decodePNG(rgba, width, height, reinterpret_cast<const unsigned char*>(png.Data()), png.Size()) != 0 || rgba.empty())
+				throw EngineException(("Failed to decode texture:" + pngName).c_str());
+
+			std::vector<char> converted;
+			if (extension == ".qoi")
+				QoiFormat::Encode(&rgba[0], static_cast<uint32_t>(width), static_cast<uint32_t>(height), converted);
+			else
+				RawTextureFormat::Encode(&rgba[0], static_cast<uint32_t>(width), static_cast<uint32_t>(height), converted);
+
+			std::ofstream file(textureName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			file.write(&converted[0], converted.size());
+			if (!file)
+				throw EngineException(("Failed to write texture:" + textureName).c_str());
+		}
+#endif
+
+		//-------------------------------------------------------------------------------------------------
+
+		//Meshes read by background jobs, waiting for their GL upload on the thread that owns the context
+		class MeshUploadQueue
+		{
+		public:
+			void Push(const std::shared_ptr<Mesh>& mesh)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_pending.push_back(mesh);
+			}
 
-					for (unsigned long y = 0; y != height; ++y)
+			//Uploads until the budget is used up, but always at least one so loading can't stall. A mesh whose
+			//upload throws is marked as failed and dropped, so one bad load doesn't end the game loop.
+			void Drain(const double budgetSeconds)
+			{
+				TimeRetriever timer;
+				do
+				{
+					std::shared_ptr<Mesh> mesh;
 					{
-						for (unsigned long x = 0; x != width * 4; ++x)
-							image.push_back(imageUpsideDown[(height - 1 - y)*width * 4 + x]);
+						std::lock_guard<std::mutex> lock(m_mutex);
+						if (m_pending.empty())
+							return;
+
+						mesh = m_pending.front();
+						m_pending.pop_front();
 					}
 
-					glBindTexture(GL_TEXTURE_2D, textureIds[i]);
-					glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, &image[0]);
-					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+					try
+					{
+						mesh->Upload();
+					}
+					catch (...)
+					{
+						mesh->MarkFailed();
+					}
+				} while (timer.ElapsedTimeInSeconds() < budgetSeconds);
+			}
 
-					materialId2TextureId[materialId] = textureIds[i++];
+			//Uploads the mesh at once if it's still waiting, for a synchronous load of it. Errors are passed on.
+			void Upload(const std::shared_ptr<Mesh>& mesh)
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					const auto iter = std::find(m_pending.begin(), m_pending.end(), mesh);
+					if (iter == m_pending.end())
+						return;
+					m_pending.erase(iter);
 				}
 
-				return std::move(materialId2TextureId);
+				try
+				{
+					mesh->Upload();
+				}
+				catch (...)
+				{
+					mesh->MarkFailed();
+					throw;
+				}
 			}
 
-			SystemSpecificData m_systemData;
+		private:
+			std::mutex m_mutex;
+			std::deque<std::shared_ptr<Mesh>> m_pending;
 		};
 
 		//-------------------------------------------------------------------------------------------------
 
+		static std::atomic<size_t> s_nextGameObjectId(0); //Objects can be created on any thread
+		static const size_t s_unassignedGameObjectId = std::numeric_limits<size_t>::max(); //Created during a parallel update and not added yet
+
+		struct DeferredMutations;
+
+		//Set while a worker runs parallel updates, the engine then defers adds and removes into it
+		static PICO_THREAD_LOCAL DeferredMutations* s_deferredMutations = nullptr;
+
 		IGameObject::IGameObject(MeshPtr mesh)
 			:m_lighting(true)
 			, m_skipViewMatrix(false)
 			, m_alpha(1.0f)
 			, m_mesh(mesh)
-			, m_gobId(s_gobId++)
+			, m_gobId(s_deferredMutations != nullptr ? s_unassignedGameObjectId : s_nextGameObjectId++)
 			, m_pass(0)
+			, m_transformDirty(true)
+			, m_threadSafeUpdate(false)
+			, m_sceneOrder(0)
 		{
 			MatrixTools::UpdateRotationMatrix(Vec3(), m_rotationMatrix);
-			UpdateScaleMatrix(Vec3(1.0f, 1.0f, 1.0f));
-			UpdateTranslationMatrix(Vec3());
+			MatrixTools::SetIdentity(m_worldMatrix);
+			m_scale = Vec3(1.0f, 1.0f, 1.0f);
 		}
 
 		IGameObject::~IGameObject()
@@ -1807,7 +6376,7 @@ namespace CogitareComputing
 		void IGameObject::SetPosition(const Vec3& pos)
 		{
 			m_position = UpdatePosition(pos);
-			UpdateTranslationMatrix(m_position);
+			m_transformDirty = true;
 		}
 
 		const Vec3& IGameObject::Position() const
@@ -1819,6 +6388,7 @@ namespace CogitareComputing
 		{
 			m_rotation = UpdateRotation(rot);
 			MatrixTools::UpdateRotationMatrix(m_rotation, m_rotationMatrix);
+			m_transformDirty = true;
 		}
 
 		const Vec3& IGameObject::Rotation() const
@@ -1829,7 +6399,7 @@ namespace CogitareComputing
 		void IGameObject::SetScale(const Vec3& scale)
 		{
 			m_scale = UpdateScale(scale);
-			UpdateScaleMatrix(m_scale);
+			m_transformDirty = true;
 		}
 
 		const Vec3& IGameObject::Scale() const
@@ -1837,6 +6407,34 @@ namespace CogitareComputing
 			return m_scale;
 		}
 
+		const Mat4& IGameObject::RotationMatrix() const
+		{
+			return m_rotationMatrix;
+		}
+
+		void IGameObject::SetParent(const std::shared_ptr<IGameObject>& parent)
+		{
+			for (auto ancestor = parent; ancestor; ancestor = ancestor->m_parent.lock())
+			{
+				if (ancestor.get() == this)
+					throw EngineException("An object can't be parented to itself or one of its children");
+			}
+
+			m_parent = parent;
+			m_transformDirty = true;
+			++s_hierarchyVersion;
+		}
+
+		std::shared_ptr<IGameObject> IGameObject::Parent() const
+		{
+			return m_parent.lock();
+		}
+
+		const Mat4& IGameObject::WorldMatrix() const
+		{
+			return m_worldMatrix;
+		}
+
 		void IGameObject::UseLighting(const bool lighting)
 		{
 			m_lighting = lighting;
@@ -1846,6 +6444,12 @@ namespace CogitareComputing
 		void IGameObject::SkipViewMatrix(const bool skipViewMatrix)
 		{
 			m_skipViewMatrix = skipViewMatrix;
+			m_transformDirty = true; //Moves it between the view and screen frustum, so the bounds have to be redone
+		}
+
+		bool IGameObject::SkipsViewMatrix() const
+		{
+			return m_skipViewMatrix;
 		}
 
 		void IGameObject::SetAlpha(const float alpha)
@@ -1853,11 +6457,26 @@ namespace CogitareComputing
 			m_alpha = alpha;
 		}
 
+		float IGameObject::Alpha() const
+		{
+			return m_alpha;
+		}
+
 		bool IGameObject::Update(const double elapsedTime)
 		{
 			return UpdateState(elapsedTime);
 		}
 
+		void IGameObject::SetThreadSafeUpdate(const bool threadSafe)
+		{
+			m_threadSafeUpdate = threadSafe;
+		}
+
+		bool IGameObject::HasThreadSafeUpdate() const
+		{
+			return m_threadSafeUpdate;
+		}
+
 		void IGameObject::SetPass(const int pass)
 		{
 			m_pass = pass;
@@ -1868,19 +6487,6 @@ namespace CogitareComputing
 			return m_pass;
 		}
 
-		void IGameObject::Render(const double elapsedTime, const RenderDetails& renderDetails)
-		{
-			AdditionalRenderInstructionsBefore(elapsedTime);
-#ifdef PICO_ANDROID
-			auto m = (const Pico::Mesh*)&Mesh();//No rtti on android?
-#else
-			auto m = dynamic_cast<const Pico::Mesh*>(&Mesh());
-#endif
-			if (m != nullptr)//This only supports normal Meshes right now, no overloads...
-				m->Render(renderDetails, m_rotationMatrix, m_scaleMatrix, m_translationMatrix, m_lighting, m_skipViewMatrix, m_alpha);
-			AdditionalRenderInstructionsAfter(elapsedTime);
-		}
-
 		const IMesh& IGameObject::Mesh() const
 		{
 			return *m_mesh;
@@ -1891,24 +6497,385 @@ namespace CogitareComputing
 			return m_gobId;
 		}
 
-		void IGameObject::UpdateTranslationMatrix(const Vec3& pos)
-		{
-			m_translationMatrix[0][0] = 1.0f; m_translationMatrix[0][1] = 0.0f; m_translationMatrix[0][2] = 0.0f; m_translationMatrix[0][3] = pos.X;
-			m_translationMatrix[1][0] = 0.0f; m_translationMatrix[1][1] = 1.0f; m_translationMatrix[1][2] = 0.0f; m_translationMatrix[1][3] = pos.Y;
-			m_translationMatrix[2][0] = 0.0f; m_translationMatrix[2][1] = 0.0f; m_translationMatrix[2][2] = 1.0f; m_translationMatrix[2][3] = pos.Z;
-			m_translationMatrix[3][0] = 0.0f; m_translationMatrix[3][1] = 0.0f; m_translationMatrix[3][2] = 0.0f; m_translationMatrix[3][3] = 1.0f;
-		}
+		size_t IGameObject::s_hierarchyVersion = 0;
+
+		//-------------------------------------------------------------------------------------------------
+
+		struct IGameObject::Renderer
+		{
+			//nullptr if the object has nothing the engine knows how to draw
+			static const Pico::Mesh* DrawableMesh(const IGameObject& gob)
+			{
+#ifdef PICO_ANDROID
+				return (const Pico::Mesh*)gob.m_mesh.get();//No rtti on android?
+#else
+				return dynamic_cast<const Pico::Mesh*>(gob.m_mesh.get());//This only supports normal Meshes right now, no overloads...
+#endif
+			}
+
+			//The render bucket of an object
+			static unsigned int Classify(const IGameObject& gob, const Pico::Mesh& mesh)
+			{
+				return (gob.m_skipViewMatrix ? RenderFlag_SkipView : 0)
+					| (gob.m_lighting ? RenderFlag_Lit : 0)
+					| (mesh.UsesArrayBuffers() ? 0 : RenderFlag_ClientMemory)
+					| (gob.m_alpha < 1.0f ? RenderFlag_Alpha : 0);
+			}
+
+			static void Draw(const double elapsedTime, const RenderDetails& renderDetails, const TransformBatch& batch)
+			{
+				typedef void(*DrawBucketFn)(const double, const RenderDetails&, const TransformBatch&, const TransformBatch::Bucket&);
+				static const DrawBucketFn drawBucket[RenderFlag_Count] =
+				{
+					&DrawBucket<0>, &DrawBucket<1>, &DrawBucket<2>, &DrawBucket<3>,
+					&DrawBucket<4>, &DrawBucket<5>, &DrawBucket<6>, &DrawBucket<7>,
+					&DrawBucket<8>, &DrawBucket<9>, &DrawBucket<10>, &DrawBucket<11>,
+					&DrawBucket<12>, &DrawBucket<13>, &DrawBucket<14>, &DrawBucket<15>
+				};
+
+				glEnableVertexAttribArray(renderDetails.m_positionLoc);
+				glEnableVertexAttribArray(renderDetails.m_texCoordLoc);
+				glUniform1i(renderDetails.m_samplerLoc, 0);
+				for (const auto& bucket : batch.Buckets())
+					drawBucket[bucket.m_flags](elapsedTime, renderDetails, batch, bucket);
+			}
+
+		private:
+			//Everything that is the same for the whole bucket is set once, the loop itself has no flag checks left.
+			//The view flag was already consumed by the transform pass.
+			template <unsigned int Flags>
+			static void DrawBucket(const double elapsedTime, const RenderDetails& renderDetails, const TransformBatch& batch, const TransformBatch::Bucket& bucket)
+			{
+				const bool lit = (Flags & RenderFlag_Lit) != 0;
+				const bool translucent = (Flags & RenderFlag_Alpha) != 0;
+				const bool arrayBuffers = (Flags & RenderFlag_ClientMemory) == 0;
+
+				glUniform1i(renderDetails.m_useLightingLocation, lit ? 1 : 0);
+				if (!translucent)
+					glUniform1f(renderDetails.m_alphaLocation, 1.0f);
+
+				for (size_t i = bucket.m_begin; i != bucket.m_end; ++i)
+				{
+					IGameObject* gob = batch.Object(i);
+					gob->AdditionalRenderInstructionsBefore(elapsedTime);
+					glUniformMatrix4fv(renderDetails.m_modelLoc, 1, GL_FALSE, static_cast<const GLfloat*>(&batch.Model(i).M[0][0]));
+					glUniformMatrix4fv(renderDetails.m_mvpLoc, 1, GL_FALSE, static_cast<const GLfloat*>(&batch.Mvp(i).M[0][0]));
+					if (translucent)
+						glUniform1f(renderDetails.m_alphaLocation, batch.Alpha(i));
+					batch.MeshAt(i)->Draw<arrayBuffers>(renderDetails);
+					gob->AdditionalRenderInstructionsAfter(elapsedTime);
+				}
+			}
+		};
+
+		//-------------------------------------------------------------------------------------------------
+
+		//Engine::AddGameObject and RemoveGameObject calls made from a parallel update, in call order
+		struct DeferredMutations
+		{
+			struct Mutation
+			{
+				GameObjectPtr m_added; //Empty for a removal
+				size_t m_removedId;
+			};
+
+			void Add(const GameObjectPtr& gob)
+			{
+				const Mutation mutation = { gob, 0 };
+				m_mutations.push_back(mutation);
+			}
+
+			void Remove(const size_t id)
+			{
+				const Mutation mutation = { GameObjectPtr(), id };
+				m_mutations.push_back(mutation);
+			}
+
+			std::vector<Mutation> m_mutations;
+		};
+
+		//-------------------------------------------------------------------------------------------------
+
+		//The game objects flattened in depth first order, a parent always comes before its children and every
+		//subtree is a contiguous range. Propagation is then a single forward walk over flat arrays, and world
+		//matrices are only recomputed for objects that changed or have a changed ancestor.
+		struct IGameObject::SceneGraph
+		{
+			SceneGraph()
+				:m_version(0)
+				, m_stale(true)
+				, m_recomputeAll(true)
+				, m_boundsChanged(true)
+				, m_nextOrder(0)
+			{}
+
+			//Has to be called when objects are added to or removed from the engine
+			void Invalidate()
+			{
+				m_stale = true;
+			}
+
+			//Objects created during a parallel update are numbered when they're added on the main thread, in the
+			//order the deferred adds are applied, so their ids don't depend on which worker ran first
+			static void AssignId(IGameObject& gob)
+			{
+				if (gob.m_gobId == s_unassignedGameObjectId)
+					gob.m_gobId = s_nextGameObjectId++;
+			}
+
+			//Siblings are ordered by when they were added, which can differ from the order they were created in
+			void Added(IGameObject& gob)
+			{
+				gob.m_sceneOrder = m_nextOrder++;
+				m_stale = true;
+			}
+
+			//Redoes the ordering if objects or parent links changed since the last call. An object whose parent
+			//isn't in the engine is treated as a root.
+			void Rebuild(const std::unordered_map<size_t, GameObjectPtr>& gameObjects)
+			{
+				if (!m_stale && m_version == s_hierarchyVersion)
+					return;
+
+				std::vector<IGameObject*> roots;
+				std::unordered_map<size_t, std::vector<IGameObject*>> children;
+				for (const auto& gob : gameObjects)
+				{
+					const auto parent = gob.second->m_parent.lock();
+					const auto parentIter = parent ? gameObjects.find(parent->Id()) : std::end(gameObjects);
+					if (parentIter != std::end(gameObjects) && parentIter->second == parent)
+						children[parent->Id()].push_back(gob.second.get());
+					else
+						roots.push_back(gob.second.get());
+				}
+
+				const auto byOrder = [](const IGameObject* lhs, const IGameObject* rhs) { return lhs->m_sceneOrder < rhs->m_sceneOrder; };
+				std::sort(std::begin(roots), std::end(roots), byOrder);
+				for (auto& siblings : children)
+					std::sort(std::begin(siblings.second), std::end(siblings.second), byOrder);
+
+				const auto count = gameObjects.size();
+				m_objects.clear();
+				m_parents.clear();
+				m_objects.reserve(count);
+				m_parents.reserve(count);
+
+				std::vector<std::pair<IGameObject*, size_t>> stack; //Object and the index of its parent
+				for (auto iter = roots.rbegin(); iter != roots.rend(); ++iter)
+					stack.push_back(std::make_pair(*iter, s_noParent));
+				while (!stack.empty())
+				{
+					const auto entry = stack.back();
+					stack.pop_back();
+
+					const auto index = m_objects.size();
+					m_objects.push_back(entry.first);
+					m_parents.push_back(entry.second);
+
+					const auto childIter = children.find(entry.first->m_gobId);
+					if (childIter == std::end(children))
+						continue;
+					for (auto iter = childIter->second.rbegin(); iter != childIter->second.rend(); ++iter)
+						stack.push_back(std::make_pair(*iter, index));
+				}
+
+				m_subtreeEnds.resize(count);
+				for (size_t i = 0; i != count; ++i)
+					m_subtreeEnds[i] = i + 1;
+				for (size_t i = count; i-- > 0;)
+				{
+					if (m_parents[i] != s_noParent)
+						m_subtreeEnds[m_parents[i]] = std::max(m_subtreeEnds[m_parents[i]], m_subtreeEnds[i]);
+				}
+
+				m_meshes.resize(count);
+				for (size_t i = 0; i != count; ++i)
+					m_meshes[i] = Renderer::DrawableMesh(*m_objects[i]);
+
+				m_worlds.resize(count);
+				m_changed.resize(count);
+				m_visible.assign(count, 0);
+				m_parallel.clear();
+				m_bounds.assign(count, BoundsTools::EmptySphere());
+				m_waitingForMesh.assign(count, 0);
+				m_subtreeBounds.resize(count);
+				m_subtreeSkipsView.resize(count);
+
+				m_version = s_hierarchyVersion;
+				m_stale = false;
+				m_recomputeAll = true;
+			}
+
+			//Updates the objects marked thread safe on the workers, in chunks of a fixed size. The chunks don't depend
+			//on the number of threads and each has its own deferred mutations, so applying those in chunk order gives
+			//the same outcome whatever the thread count.
+			void UpdateParallel(const double elapsedTime, JobSystem& jobs, std::vector<DeferredMutations>& deferred)
+			{
+				const auto count = m_objects.size();
+				m_parallel.clear();
+				for (size_t i = 0; i != count; ++i)
+				{
+					if (m_objects[i]->m_threadSafeUpdate)
+						m_parallel.push_back(i);
+				}
+
+				const auto chunkCount = (m_parallel.size() + s_updateChunkSize - 1) / s_updateChunkSize;
+				deferred.resize(chunkCount);
+				for (auto& mutations : deferred)
+					mutations.m_mutations.clear();
+
+				jobs.ParallelFor(chunkCount, [this, elapsedTime, &deferred](const size_t begin, const size_t end)
+				{
+					struct ResetDeferred
+					{
+						~ResetDeferred() { s_deferredMutations = nullptr; }
+					} resetDeferred;
+
+					for (size_t chunk = begin; chunk != end; ++chunk)
+					{
+						s_deferredMutations = &deferred[chunk];
+						const auto first = chunk * s_updateChunkSize;
+						const auto last = std::min(first + s_updateChunkSize, m_parallel.size());
+						for (size_t i = first; i != last; ++i)
+						{
+							const auto index = m_parallel[i];
+							m_visible[index] = m_objects[index]->Update(elapsedTime) ? 1 : 0;
+						}
+					}
+				});
+			}
+
+			//Everything UpdateParallel didn't take, in depth first order so parents are updated before their children
+			void UpdateSerial(const double elapsedTime)
+			{
+				const auto count = m_objects.size();
+				size_t nextParallel = 0;
+				for (size_t i = 0; i != count; ++i)
+				{
+					if (nextParallel != m_parallel.size() && m_parallel[nextParallel] == i)
+					{
+						++nextParallel;
+						continue;
+					}
+					m_visible[i] = m_objects[i]->Update(elapsedTime) ? 1 : 0;
+				}
+				m_parallel.clear();
+			}
+
+			void Propagate()
+			{
+				const auto count = m_objects.size();
+				for (size_t i = 0; i != count; ++i)
+				{
+					IGameObject* gob = m_objects[i];
+					const auto parent = m_parents[i];
+					const bool changed = m_recomputeAll || gob->m_transformDirty || (parent != s_noParent && m_changed[parent] != 0);
+					m_changed[i] = changed ? 1 : 0;
+					if (changed)
+					{
+						Mat4 local;
+						MatrixTools::ComposeTRS(Vec4(gob->m_position, 1.0f), gob->m_rotationMatrix, Vec4(gob->m_scale, 1.0f), local);
+						if (parent == s_noParent)
+							m_worlds[i] = local;
+						else
+							MatrixTools::MatrixMul(m_worlds[parent], local, m_worlds[i]);
+
+						gob->m_worldMatrix = m_worlds[i];
+						gob->m_transformDirty = false;
+						UpdateBounds(i);
+					}
+					else if (m_waitingForMesh[i] != 0 && m_meshes[i]->IsResident())
+					{
+						UpdateBounds(i);
+					}
+				}
+				m_recomputeAll = false;
+
+				if (m_boundsChanged)
+					UpdateSubtreeBounds();
+			}
+
+			//Calls visit(IGameObject*, const Mesh*, const Mat4& world) for every visible object with something to draw.
+			//Objects drawn without the view matrix are never culled, and neither are the subtrees containing them.
+			template <typename Visitor>
+			void Visit(const Mat4& viewProjection, const bool frustumCulling, const Visitor& visit) const
+			{
+				Vec4 planes[6];
+				BoundsTools::ExtractFrustum(viewProjection, planes);
+
+				const auto count = m_objects.size();
+				for (size_t i = 0; i != count;)
+				{
+					const bool cull = frustumCulling && m_subtreeSkipsView[i] == 0;
+					if (cull && BoundsTools::OutsideFrustum(planes, m_subtreeBounds[i]))
+					{
+						i = m_subtreeEnds[i];
+						continue;
+					}
+
+					if (m_visible[i] != 0 && m_meshes[i] != nullptr && m_waitingForMesh[i] == 0 && !(cull && BoundsTools::OutsideFrustum(planes, m_bounds[i])))
+						visit(m_objects[i], m_meshes[i], m_worlds[i]);
+					++i;
+				}
+			}
+
+		private:
+			//A mesh that is still loading has no bounds yet, it's picked up by Propagate once it's resident
+			void UpdateBounds(const size_t i)
+			{
+				const Pico::Mesh* mesh = m_meshes[i];
+				const bool waiting = mesh != nullptr && !mesh->IsResident();
+				m_waitingForMesh[i] = waiting ? 1 : 0;
+				m_bounds[i] = mesh != nullptr && !waiting ? BoundsTools::TransformSphere(m_worlds[i], mesh->BoundingSphere()) : BoundsTools::EmptySphere();
+				m_boundsChanged = true;
+			}
+
+			//Children always come after their parent, so walking backwards merges every subtree before it's merged into its parent
+			void UpdateSubtreeBounds()
+			{
+				const auto count = m_objects.size();
+				for (size_t i = 0; i != count; ++i)
+				{
+					m_subtreeBounds[i] = m_bounds[i];
+					m_subtreeSkipsView[i] = m_objects[i]->m_skipViewMatrix ? 1 : 0;
+				}
+
+				for (size_t i = count; i-- > 0;)
+				{
+					const auto parent = m_parents[i];
+					if (parent == s_noParent)
+						continue;
 
-		void IGameObject::UpdateScaleMatrix(const Vec3& scale)
-		{
-			m_scaleMatrix[0][0] = scale.X; m_scaleMatrix[0][1] = 0.0f;   m_scaleMatrix[0][2] = 0.0f;   m_scaleMatrix[0][3] = 0.0f;
-			m_scaleMatrix[1][0] = 0.0f;   m_scaleMatrix[1][1] = scale.Y; m_scaleMatrix[1][2] = 0.0f;   m_scaleMatrix[1][3] = 0.0f;
-			m_scaleMatrix[2][0] = 0.0f;   m_scaleMatrix[2][1] = 0.0f;   m_scaleMatrix[2][2] = scale.Z; m_scaleMatrix[2][3] = 0.0f;
-			m_scaleMatrix[3][0] = 0.0f;   m_scaleMatrix[3][1] = 0.0f;   m_scaleMatrix[3][2] = 0.0f;   m_scaleMatrix[3][3] = 1.0f;
-		}
+					m_subtreeBounds[parent] = BoundsTools::MergeSpheres(m_subtreeBounds[parent], m_subtreeBounds[i]);
+					m_subtreeSkipsView[parent] |= m_subtreeSkipsView[i];
+				}
+				m_boundsChanged = false;
+			}
 
+			static const size_t s_noParent = ~static_cast<size_t>(0);
+			static const size_t s_updateChunkSize = 16; //Small, the updates this is meant for are expensive
+
+			size_t m_version;
+			bool m_stale;
+			bool m_recomputeAll;
+			bool m_boundsChanged;
+			size_t m_nextOrder;
+
+			std::vector<IGameObject*> m_objects;
+			std::vector<size_t> m_parents;
+			std::vector<size_t> m_subtreeEnds; //One past the last descendant
+			std::vector<const Pico::Mesh*> m_meshes;
+			std::vector<Mat4> m_worlds;
+			std::vector<unsigned char> m_changed;
+			std::vector<unsigned char> m_visible;
+			std::vector<size_t> m_parallel; //Indices updated by UpdateParallel this frame
+			std::vector<Vec4> m_bounds;
+			std::vector<unsigned char> m_waitingForMesh; //Not drawn and no bounds until the mesh is resident
+			std::vector<Vec4> m_subtreeBounds;
+			std::vector<unsigned char> m_subtreeSkipsView;
+		};
 
-		size_t IGameObject::s_gobId = 0;
+		const size_t IGameObject::SceneGraph::s_noParent;
 
 		//-------------------------------------------------------------------------------------------------
 
@@ -2012,8 +6979,8 @@ namespace CogitareComputing
 			float m_light[3];
 			GLuint m_lightLocation;
 
-			float m_viewTranslationMatrix[4][4];
-			float m_viewRotationMatrix[4][4];
+			Mat4 m_viewTranslationMatrix;
+			Mat4 m_viewRotationMatrix;
 
 			const std::string m_windowName;
 			size_t m_windowWidth;
@@ -2024,10 +6991,207 @@ namespace CogitareComputing
 			NativeWindow m_window;
 			EGLSupport m_egl;
 
-			std::unordered_map<size_t, GameObjectPtr> m_objectsToAdd;
+			std::vector<GameObjectPtr> m_objectsToAdd; //In call order, it decides the update order
 			std::vector<size_t> m_objectsToRemove;
 			std::unordered_map<size_t, GameObjectPtr> m_gameObjects;
 
+			IGameObject::SceneGraph m_sceneGraph;
+			bool m_frustumCulling;
+
+			JobSystem m_jobs;
+			TransformBatch m_transforms;
+			static const size_t s_parallelTransformThreshold = 1024; //Below this the fork/join overhead outweighs the gain
+
+			void UpdateTransforms(TransformBatch& transforms, const Mat4& viewProjection)
+			{
+				const Mat4& projection = m_renderDetails.m_perspectiveMatrix;
+				transforms.Prepare();
+				const auto count = transforms.Count();
+				if (count < s_parallelTransformThreshold)
+				{
+					transforms.Compute(0, count, viewProjection, projection);
+					return;
+				}
+
+				m_jobs.ParallelFor(count, [&transforms, &viewProjection, &projection](const size_t begin, const size_t end)
+				{
+					transforms.Compute(begin, end, viewProjection, projection);
+				}, s_parallelTransformThreshold / 4);
+			}
+
+			struct RenderEntry
+			{
+				RenderEntry(IGameObject* gob, const Mesh* mesh, const Mat4* world) :m_object(gob), m_mesh(mesh), m_world(world) {}
+				IGameObject* m_object;
+				const Mesh* m_mesh;
+				const Mat4* m_world;
+			};
+			std::map<int, std::vector<std::vector<RenderEntry>>> m_objectsToRender; //Pass -> flags -> objects
+
+			bool m_parallelUpdates;
+			std::vector<DeferredMutations> m_deferredMutations; //One per chunk of parallel updates
+
+			void ApplyDeferredMutations()
+			{
+				for (auto& deferred : m_deferredMutations)
+				{
+					for (const auto& mutation : deferred.m_mutations)
+					{
+						if (mutation.m_added)
+							AddGameObject(mutation.m_added);
+						else
+							RemoveGameObject(mutation.m_removedId);
+					}
+					deferred.m_mutations.clear();
+				}
+			}
+
+			//Updates the objects and fills the batch with everything to draw, no GL calls
+			void UpdateFrame(const double elapsedTime, TransformBatch& transforms)
+			{
+				m_sceneGraph.Rebuild(m_gameObjects);
+				if (m_parallelUpdates)
+				{
+					m_sceneGraph.UpdateParallel(elapsedTime, m_jobs, m_deferredMutations);
+					ApplyDeferredMutations();
+				}
+				m_sceneGraph.UpdateSerial(elapsedTime);
+				m_sceneGraph.Propagate();
+
+				Mat4 viewProjection;
+				MatrixTools::MatrixMul(m_renderDetails.m_perspectiveMatrix, m_renderDetails.m_viewMatrix, viewProjection);
+
+				auto& objectsToRender = m_objectsToRender;
+				for (auto& pass : objectsToRender)
+				{
+					for (auto& bucket : pass.second)
+						bucket.clear();
+				}
+				m_sceneGraph.Visit(viewProjection, m_frustumCulling, [&objectsToRender](IGameObject* gob, const Mesh* mesh, const Mat4& world)
+				{
+					auto& pass = objectsToRender[gob->Pass()];
+					pass.resize(RenderFlag_Count);
+					pass[IGameObject::Renderer::Classify(*gob, *mesh)].push_back(RenderEntry(gob, mesh, &world));
+				});
+
+				transforms.Clear();
+				for (const auto& pass : objectsToRender)
+				{
+					for (size_t flags = 0; flags != pass.second.size(); ++flags)
+					{
+						const auto& bucket = pass.second[flags];
+						if (bucket.empty())
+							continue;
+
+						transforms.BeginBucket(static_cast<unsigned int>(flags));
+						for (const auto& entry : bucket)
+							transforms.Add(entry.m_object, entry.m_mesh, *entry.m_world, entry.m_mesh->Dequantisation(), entry.m_object->Alpha());
+					}
+				}
+				UpdateTransforms(transforms, viewProjection);
+			}
+
+			TimeRetriever m_clock;
+			FrameStatsTracker m_frameStats;
+			RenderThread m_renderThread;
+			bool m_useRenderThread;
+			size_t m_bufferedFrames;
+			Vec4 m_clearColour;
+			std::vector<GameObjectPtr> m_retiredObjects; //Removed while the render thread may still be drawing them
+			std::shared_ptr<MeshUploadQueue> m_uploads; //Shared with the load jobs, which may outlive the engine
+			std::shared_ptr<TextureCache> m_textureCache;
+			std::shared_ptr<FileSystems> m_fileSystems;
+			FileSystemPtr m_defaultFileSystem;
+			double m_uploadBudget;
+			JobCounter m_loads;
+
+			//Loaded meshes by canonical path and vertex source. Only weak references, a mesh no object uses is freed
+			//unless it was preloaded.
+			std::unordered_map<std::string, std::weak_ptr<Mesh>> m_meshCache;
+			std::unordered_map<std::string, MeshPtr> m_preloadedMeshes; //Kept until evicted
+
+			std::string MeshKey(const std::string& meshName) const
+			{
+				return (m_useArrayBuffers ? "buffers|" : "client|") + std::string(m_compactVertices ? "compact|" : "") + CanonicalPath(meshName);
+			}
+
+			//A mesh whose load failed is evicted, so asking for it again retries the load and reports the error anew
+			std::shared_ptr<Mesh> CachedMesh(const std::string& key)
+			{
+				auto iter = m_meshCache.find(key);
+				if (iter == std::end(m_meshCache))
+					return std::shared_ptr<Mesh>();
+
+				auto mesh = iter->second.lock();
+				if (mesh && mesh->HasFailed())
+				{
+					m_preloadedMeshes.erase(key);
+					mesh.reset();
+				}
+				if (!mesh)
+					m_meshCache.erase(iter);
+				return mesh;
+			}
+
+			//Completes an asynchronous load on the calling thread, the mesh is then resident unless the load failed.
+			//Upload errors are passed on.
+			void FinishLoad(const std::shared_ptr<Mesh>& mesh)
+			{
+				m_jobs.Wait(m_loads);
+				auto uploads = m_uploads;
+				m_renderThread.Invoke([&mesh, &uploads]() { uploads->Upload(mesh); });
+			}
+
+			//Without workers nothing runs the load jobs unless the game thread does, one per frame keeps loading going
+			void RunLoadJobs()
+			{
+				if (m_jobs.ThreadCount() == 1 && !m_loads.IsDone())
+					m_jobs.RunPendingJob();
+			}
+
+			//Runs on the render thread
+			void RenderFrame(FramePacket& packet)
+			{
+				m_textureCache->DeleteReleased();
+				m_uploads->Drain(packet.m_uploadBudget);
+
+				glClearColor(packet.m_clearColour.X, packet.m_clearColour.Y, packet.m_clearColour.Z, packet.m_clearColour.W);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				glUseProgram(m_renderDetails.m_program);
+				glViewport(0, 0, packet.m_width, packet.m_height);
+				glUniform3fv(m_lightLocation, 1, packet.m_light);
+				IGameObject::Renderer::Draw(packet.m_elapsedTime, m_renderDetails, packet.m_transforms);
+
+				m_egl.SwapBuffer();
+				m_frameStats.Presented(packet.m_frameStart, m_clock.ElapsedTimeInSeconds());
+			}
+
+			void StartRenderThread()
+			{
+				m_egl.ReleaseCurrent();
+				m_renderThread.Start(m_bufferedFrames,
+					[this]() { m_egl.MakeCurrent(); },
+					[this](FramePacket& packet) { RenderFrame(packet); },
+					[this]() { m_egl.ReleaseCurrent(); });
+			}
+
+			void StopRenderThread()
+			{
+				std::exception_ptr error;
+				try
+				{
+					m_renderThread.Stop();
+				}
+				catch (...)
+				{
+					error = std::current_exception();
+				}
+				m_egl.MakeCurrent();
+				m_retiredObjects.clear();
+				if (error)
+					std::rethrow_exception(error);
+			}
+
 #ifdef PICO_PI
 			int m_keyboardFd;
 			std::unordered_set<char> m_keys;
@@ -2120,9 +7284,10 @@ namespace CogitareComputing
 
 #endif
 			float m_perspectiveScaling;
+			bool m_useArrayBuffers;
+			bool m_compactVertices;
 
-			template<int N>
-			void InitPerspective(float(&perspectiveMatrix)[N][N], float screenWidth, float screenHeight)
+			void InitPerspective(Mat4& perspectiveMatrix, float screenWidth, float screenHeight)
 			{
 				float zNear = 0.1f;
 				float zFar = 1000.0f;
@@ -2131,19 +7296,15 @@ namespace CogitareComputing
 				const float zRange = zNear - zFar;
 				const float tanHalfFOV = tanf(1.04f / 2.0f);
 
-				perspectiveMatrix[0][0] = m_perspectiveScaling / (tanHalfFOV * ar); perspectiveMatrix[0][1] = 0.0f;              perspectiveMatrix[0][2] = 0.0f;            perspectiveMatrix[0][3] = 0.0;
-				perspectiveMatrix[1][0] = 0.0f;                     perspectiveMatrix[1][1] = m_perspectiveScaling / tanHalfFOV; perspectiveMatrix[1][2] = 0.0f;            perspectiveMatrix[1][3] = 0.0;
-				perspectiveMatrix[2][0] = 0.0f;                     perspectiveMatrix[2][1] = 0.0f;			     perspectiveMatrix[2][2] = (-zNear - zFar) / zRange; perspectiveMatrix[2][3] = 2.0f*zFar*zNear / zRange;
-				perspectiveMatrix[3][0] = 0.0f;                     perspectiveMatrix[3][1] = 0.0f;              perspectiveMatrix[3][2] = 1.0f;            perspectiveMatrix[3][3] = 0.0;
+				perspectiveMatrix.M[0][0] = m_perspectiveScaling / (tanHalfFOV * ar); perspectiveMatrix.M[0][1] = 0.0f;              perspectiveMatrix.M[0][2] = 0.0f;            perspectiveMatrix.M[0][3] = 0.0;
+				perspectiveMatrix.M[1][0] = 0.0f;                     perspectiveMatrix.M[1][1] = m_perspectiveScaling / tanHalfFOV; perspectiveMatrix.M[1][2] = 0.0f;            perspectiveMatrix.M[1][3] = 0.0;
+				perspectiveMatrix.M[2][0] = 0.0f;                     perspectiveMatrix.M[2][1] = 0.0f;			     perspectiveMatrix.M[2][2] = (-zNear - zFar) / zRange; perspectiveMatrix.M[2][3] = 2.0f*zFar*zNear / zRange;
+				perspectiveMatrix.M[3][0] = 0.0f;                     perspectiveMatrix.M[3][1] = 0.0f;              perspectiveMatrix.M[3][2] = 1.0f;            perspectiveMatrix.M[3][3] = 0.0;
 			}
 
-			template<int N>
-			void InitViewMatrix(float(&viewMatrix)[N][N])
+			void InitViewMatrix(Mat4& viewMatrix)
 			{
-				viewMatrix[0][0] = 1.0f; viewMatrix[0][1] = 0.0f; viewMatrix[0][2] = 0.0f; viewMatrix[0][3] = 0.0f;
-				viewMatrix[1][0] = 0.0f; viewMatrix[1][1] = 1.0f; viewMatrix[1][2] = 0.0f; viewMatrix[1][3] = 0.0f;
-				viewMatrix[2][0] = 0.0f; viewMatrix[2][1] = 0.0f; viewMatrix[2][2] = 1.0f; viewMatrix[2][3] = 0.0f;
-				viewMatrix[3][0] = 0.0f; viewMatrix[3][1] = 0.0f; viewMatrix[3][2] = 0.0f; viewMatrix[3][3] = 1.0f;
+				MatrixTools::SetIdentity(viewMatrix);
 			}
 
 			void UpdateViewMatrix()
@@ -2153,9 +7314,9 @@ namespace CogitareComputing
 
 			void UpdateViewMatrixTranslation(const Vec3& pos)
 			{
-				m_viewTranslationMatrix[0][3] = -pos.X;
-				m_viewTranslationMatrix[1][3] = -pos.Y;
-				m_viewTranslationMatrix[2][3] = -pos.Z;
+				m_viewTranslationMatrix.M[0][3] = -pos.X;
+				m_viewTranslationMatrix.M[1][3] = -pos.Y;
+				m_viewTranslationMatrix.M[2][3] = -pos.Z;
 				UpdateViewMatrix();
 			}
 
@@ -2174,11 +7335,34 @@ namespace CogitareComputing
 				, m_systemData(sData)
 				, m_window(m_windowName, m_windowWidth, m_windowHeight, sData)
 				, m_egl(m_window, m_swapInterval)
+				, m_frustumCulling(true)
+				, m_jobs(std::max(std::thread::hardware_concurrency(), 1u) - 1)
+				, m_parallelUpdates(false)
+				, m_useRenderThread(false)
+				, m_bufferedFrames(2)
+				, m_clearColour(0.0f, 0.0f, 0.0f, 0.0f)
+				, m_uploads(std::make_shared<MeshUploadQueue>())
+				, m_textureCache(std::make_shared<TextureCache>(m_jobs.ThreadCount()))
+				, m_fileSystems(std::make_shared<FileSystems>())
+#ifdef PICO_ANDROID
+				, m_defaultFileSystem(std::make_shared<ApkFileSystem>(sData))
+#else
+				, m_defaultFileSystem(CreateDirectoryFileSystem(""))
+#endif
+				, m_uploadBudget(0.004)
 				, m_perspectiveScaling(1.0f)
+#ifdef USE_ARRAY_BUFFERS
+				, m_useArrayBuffers(true)
+#else
+				, m_useArrayBuffers(false)
+#endif
+				, m_compactVertices(false)
 #if defined(PICO_ANDROID) || defined(PICO_PI)
 				, m_timeDiffForVsync(0.0)
 #endif
 			{
+				m_fileSystems->Mount(m_defaultFileSystem, 0);
+
 #ifdef SOUND_SUPPORT
 				InitialiseSound();
 #endif
@@ -2212,13 +7396,29 @@ namespace CogitareComputing
 
 			void HandleObjectMapUpdate()
 			{
-				for (const auto& objPair : m_objectsToAdd)
-					m_gameObjects[objPair.first] = objPair.second;
+				if (!m_objectsToAdd.empty() || !m_objectsToRemove.empty())
+					m_sceneGraph.Invalidate();
+
+				for (const auto& gob : m_objectsToAdd)
+				{
+					auto& entry = m_gameObjects[gob->Id()];
+					if (entry != gob)
+						m_sceneGraph.Added(*gob);
+					entry = gob;
+				}
 
 				m_objectsToAdd.clear();
 
 				for (const auto objId : m_objectsToRemove)
-					m_gameObjects.erase(objId);
+				{
+					auto iter = m_gameObjects.find(objId);
+					if (iter == std::end(m_gameObjects))
+						continue;
+
+					if (m_renderThread.IsRunning())
+						m_retiredObjects.push_back(iter->second);
+					m_gameObjects.erase(iter);
+				}
 
 				m_objectsToRemove.clear();
 			}
@@ -2227,9 +7427,36 @@ namespace CogitareComputing
 			double m_timeDiffForVsync;
 #endif
 			bool Run(std::function<bool(double)> callBack)
+			{
+				m_frameStats.Reset();
+				if (!m_useRenderThread)
+					return RunFrames(callBack);
+
+				StartRenderThread();
+				bool result;
+				try
+				{
+					result = RunFrames(callBack);
+				}
+				catch (...)
+				{
+					try
+					{
+						StopRenderThread();
+					}
+					catch (...)
+					{
+					}
+					throw;
+				}
+				StopRenderThread();
+				return result;
+			}
+
+			bool RunFrames(std::function<bool(double)>& callBack)
 			{
 				TimeRetriever timer;
-				std::map<int, std::vector<size_t>> objectsToRender;
+				const bool renderThread = m_renderThread.IsRunning();
 
 				HandleObjectMapUpdate();
 
@@ -2248,13 +7475,17 @@ namespace CogitareComputing
 					elapsedTime = timer.ElapsedTimeInSeconds();
 					m_timeDiffForVsync = elapsedTime;
 #endif
+					const auto frameStart = m_clock.ElapsedTimeInSeconds();
 					m_egl.RefreshWindowData();
 
 					if (m_window.Width() != m_windowWidth || m_window.Height() != m_windowHeight)
 						InitPerspective(m_renderDetails.m_perspectiveMatrix, static_cast<float>(m_window.Width()), static_cast<float>(m_window.Height()));
 
-					glUseProgram(m_renderDetails.m_program);
-					glViewport(0, 0, m_window.Width(), m_window.Height());
+					if (!renderThread)
+					{
+						glUseProgram(m_renderDetails.m_program);
+						glViewport(0, 0, m_window.Width(), m_window.Height());
+					}
 					m_windowWidth = m_window.Width();
 					m_windowHeight = m_window.Height();
 
@@ -2266,20 +7497,31 @@ namespace CogitareComputing
 					if (isRunning)
 					{
 						HandleObjectMapUpdate();
+						RunLoadJobs();
+						if (m_loads.IsDone())
+							m_textureCache->ReleaseDecodeBuffers(); //The loads made so far are done, more may not come for a while
 
-						objectsToRender.clear();
-						for (auto& gob : m_gameObjects)
+						if (renderThread)
 						{
-							if (gob.second->Update(elapsedTime))
-								objectsToRender[gob.second->Pass()].push_back(gob.first);
+							FramePacket& packet = m_renderThread.Acquire();
+							UpdateFrame(elapsedTime, packet.m_transforms);
+							std::copy(m_light, m_light + 3, packet.m_light);
+							packet.m_clearColour = m_clearColour;
+							packet.m_width = m_windowWidth;
+							packet.m_height = m_windowHeight;
+							packet.m_elapsedTime = elapsedTime;
+							packet.m_frameStart = frameStart;
+							packet.m_uploadBudget = m_uploadBudget;
+							packet.m_retired.swap(m_retiredObjects);
+							m_renderThread.Submit();
 						}
-
-						glUniform3fv(m_lightLocation, 1, m_light);
-
-						for (auto pass : objectsToRender)
+						else
 						{
-							for (auto gobId : pass.second)
-								m_gameObjects[gobId]->Render(elapsedTime, m_renderDetails);
+							m_textureCache->DeleteReleased();
+							m_uploads->Drain(m_uploadBudget);
+							UpdateFrame(elapsedTime, m_transforms);
+							glUniform3fv(m_lightLocation, 1, m_light);
+							IGameObject::Renderer::Draw(elapsedTime, m_renderDetails, m_transforms);
 						}
 
 						Event event;
@@ -2295,7 +7537,11 @@ namespace CogitareComputing
 						return true;
 					}
 
-					m_egl.SwapBuffer();
+					if (!renderThread)
+					{
+						m_egl.SwapBuffer();
+						m_frameStats.Presented(frameStart, m_clock.ElapsedTimeInSeconds());
+					}
 
 					m_window.MsgLoop();
 
@@ -2311,7 +7557,14 @@ namespace CogitareComputing
 
 			bool AddGameObject(GameObjectPtr gob)
 			{
-				m_objectsToAdd[gob->Id()] = gob;
+				if (s_deferredMutations != nullptr)
+				{
+					s_deferredMutations->Add(gob);
+					return true;
+				}
+
+				IGameObject::SceneGraph::AssignId(*gob);
+				m_objectsToAdd.push_back(gob);
 				return true;
 			}
 
@@ -2326,9 +7579,14 @@ namespace CogitareComputing
 
 			bool RemoveGameObject(const size_t id)
 			{
-				auto iter = m_objectsToAdd.find(id);
-				if (iter != std::end(m_objectsToAdd))
-					m_objectsToAdd.erase(iter);
+				if (s_deferredMutations != nullptr)
+				{
+					s_deferredMutations->Remove(id);
+					return m_gameObjects.find(id) != std::end(m_gameObjects);
+				}
+
+				m_objectsToAdd.erase(std::remove_if(std::begin(m_objectsToAdd), std::end(m_objectsToAdd),
+					[id](const GameObjectPtr& gob) { return gob->Id() == id; }), std::end(m_objectsToAdd));
 
 				if (m_gameObjects.find(id) == std::end(m_gameObjects))
 					return false;
@@ -2342,7 +7600,7 @@ namespace CogitareComputing
 			ALCdevice* m_alDevice;
 			ALCcontext* m_alContext;
 			std::unordered_map<std::string, ALuint> m_soundBuffers;
-			std::vector<unsigned char> m_oggSoundBuffer;
+			FilePtr m_oggFile; //stb_vorbis streams out of it while the ogg plays
 
 #ifdef OGG_PLAYBACK
 			ALuint m_oggPlaybackSource;
@@ -2367,12 +7625,10 @@ namespace CogitareComputing
 				auto buffer3 = GetSoundBuffer("oggbuffer3");
 
 				int error;
-#ifdef PICO_ANDROID
-				LoadAssetFile(m_systemData, m_oggSoundBuffer, m_oggFilename);
-				m_vorbisFileInfo = stb_vorbis_open_memory(&m_oggSoundBuffer[0], m_oggSoundBuffer.size(), &error, nullptr);
-#else
-				m_vorbisFileInfo = stb_vorbis_open_filename(m_oggFilename.c_str(), &error, nullptr);
-#endif
+				m_vorbisFileInfo = nullptr;
+				m_oggFile = m_fileSystems->Open(m_oggFilename);
+				if (m_oggFile)
+					m_vorbisFileInfo = stb_vorbis_open_memory(reinterpret_cast<const unsigned char*>(m_oggFile->Data()), static_cast<int>(m_oggFile->Size()), &error, nullptr);
 				if (m_vorbisFileInfo == nullptr)
 					throw EngineException("Failed to load ogg file:" + m_oggFilename);
 
@@ -2474,75 +7730,70 @@ namespace CogitareComputing
 
 			struct WAVData
 			{
-				std::vector<char> Data;
+				const char* Data; //Points into the file, valid while it stays open
+				size_t DataSize;
 				unsigned short AudioFormat;
 				unsigned short NumberOfChannels;
 				unsigned long SampleRate;
 				unsigned short BitsPerSample;
 			};
 
-#ifdef PICO_ANDROID
-			template<typename CharT, typename TraitsT = std::char_traits<CharT> >
-			class vectorwrapbuf : public std::basic_streambuf<CharT, TraitsT>
+			//Reads a little endian field of the wave file and moves past it
+			template <class T>
+			static void ReadWAVField(const char*& data, const char* end, T& value)
 			{
-			public:
-				vectorwrapbuf(std::vector<CharT> &vec)
-				{
-					std::streambuf::setg(vec.data(), vec.data(), vec.data() + vec.size());
-				}
-			};
-#endif
-			WAVData LoadWAVFile(const std::string& filename)
+				if (static_cast<size_t>(end - data) < sizeof(T))
+					throw EngineException("Wave file is truncated");
+				value = T();
+				memcpy(&value, data, sizeof(T));
+				data += sizeof(T);
+			}
+
+			static WAVData ParseWAV(const char* data, const size_t size)
 			{
+				const char* end = data + size;
 				WAVData waveData;
-#ifdef PICO_ANDROID
-				std::vector<char> buffer;
-				LoadAssetFile(m_systemData, buffer, filename);
-				vectorwrapbuf<char> databuf(buffer);
-				std::istream waveFile(&databuf);
-#else
-
-				std::ifstream waveFile(filename, std::ios::in | std::ios::binary);
-				if (!waveFile.is_open())
-					throw EngineException("Could not open wave file:" + filename);
-#endif
 				unsigned int idHolder = 0;
-				waveFile.read(reinterpret_cast<char*>(&idHolder), 4);
+				ReadWAVField(data, end, idHolder);
 				if (idHolder != 'FFIR')
 					throw EngineException("Wave file has no RIFF header");
 
 				unsigned int dataSize = 0;
-				waveFile.read(reinterpret_cast<char*>(&dataSize), 4);
+				ReadWAVField(data, end, dataSize);
 
-				waveFile.read(reinterpret_cast<char*>(&idHolder), 4);
+				ReadWAVField(data, end, idHolder);
 				if (idHolder != 'EVAW')
 					throw EngineException("Wave file is not WAVE format");
 
-				waveFile.read(reinterpret_cast<char*>(&idHolder), 4);
+				ReadWAVField(data, end, idHolder);
 				if (idHolder != ' tmf')
 					throw EngineException("Wave file is missing format info");
 
-				waveFile.read(reinterpret_cast<char*>(&dataSize), 4);
+				ReadWAVField(data, end, dataSize);
 				if (dataSize != 16)
 					throw EngineException("This reader only supports PCM files");
 
-				waveFile.read(reinterpret_cast<char*>(&waveData.AudioFormat), 2);
-				waveFile.read(reinterpret_cast<char*>(&waveData.NumberOfChannels), 2);
-				waveFile.read(reinterpret_cast<char*>(&waveData.SampleRate), 4);
-				waveFile.read(reinterpret_cast<char*>(&dataSize), 4);//ByteRate
+				unsigned int sampleRate = 0;
+				ReadWAVField(data, end, waveData.AudioFormat);
+				ReadWAVField(data, end, waveData.NumberOfChannels);
+				ReadWAVField(data, end, sampleRate);
+				waveData.SampleRate = sampleRate;
+				ReadWAVField(data, end, dataSize);//ByteRate
 				unsigned short blockAlign;
-				waveFile.read(reinterpret_cast<char*>(&blockAlign), 2);
-				waveFile.read(reinterpret_cast<char*>(&waveData.BitsPerSample), 2);
+				ReadWAVField(data, end, blockAlign);
+				ReadWAVField(data, end, waveData.BitsPerSample);
 
 				//Assuming PCM so there's no check for extra params
 
-				waveFile.read(reinterpret_cast<char*>(&idHolder), 4);
+				ReadWAVField(data, end, idHolder);
 				if (idHolder != 'atad')
 					throw EngineException("Wave file is missing data chunk");
 
-				waveFile.read(reinterpret_cast<char*>(&dataSize), 4);
-				waveData.Data = std::vector<char>(dataSize);
-				waveFile.read(&waveData.Data[0], dataSize);
+				ReadWAVField(data, end, dataSize);
+				if (static_cast<size_t>(end - data) < dataSize)
+					throw EngineException("Wave file is truncated");
+				waveData.Data = data;
+				waveData.DataSize = dataSize;
 
 				return waveData;
 			}
@@ -2609,11 +7860,16 @@ namespace CogitareComputing
 
 			ALuint GetSoundBufferForWAV(const std::string& filename)
 			{
-				auto buffer = GetSoundBuffer(filename);
-				const auto waveData = LoadWAVFile(filename);
+				const auto file = m_fileSystems->Open(filename);
+				if (!file)
+					throw EngineException("Could not open wave file:" + filename);
+
+				const auto waveData = ParseWAV(file->Data(), file->Size());
 				const auto format = GetALFormat(waveData);
+				auto buffer = GetSoundBuffer(filename);
 
-				alBufferData(buffer, format, &waveData.Data[0], waveData.Data.size(), waveData.SampleRate);
+				//OpenAL takes its own copy, so the file can close right after
+				alBufferData(buffer, format, waveData.Data, static_cast<ALsizei>(waveData.DataSize), waveData.SampleRate);
 				m_soundBuffers[filename] = buffer;
 				return buffer;
 			}
@@ -2690,11 +7946,122 @@ namespace CogitareComputing
 
 		MeshPtr Engine::LoadMesh(const std::string& meshName)
 		{
-			auto mesh = std::make_shared<Mesh>(m_impl->m_systemData);
-			mesh->Load(meshName);
+			if (!m_impl)
+				return MeshPtr();
+
+			const auto key = m_impl->MeshKey(meshName);
+			auto cached = m_impl->CachedMesh(key);
+			if (cached && !cached->IsResident())
+			{
+				m_impl->FinishLoad(cached);
+				cached = m_impl->CachedMesh(key); //Evicted if the load failed, it's then read again below so the error is thrown
+			}
+			if (cached)
+				return cached;
+
+			auto mesh = std::make_shared<Mesh>(m_impl->m_systemData, m_impl->m_useArrayBuffers, m_impl->m_compactVertices, m_impl->m_textureCache, m_impl->m_fileSystems, &m_impl->m_jobs);
+			mesh->Read(meshName);
+			m_impl->m_renderThread.Invoke([&mesh]() { mesh->Upload(); });
+			m_impl->m_meshCache[key] = mesh;
+			return mesh;
+		}
+
+		MeshPtr Engine::LoadMeshAsync(const std::string& meshName)
+		{
+			if (!m_impl)
+				return MeshPtr();
+
+			const auto key = m_impl->MeshKey(meshName);
+			auto cached = m_impl->CachedMesh(key);
+			if (cached)
+				return cached;
+
+			auto mesh = std::make_shared<Mesh>(m_impl->m_systemData, m_impl->m_useArrayBuffers, m_impl->m_compactVertices, m_impl->m_textureCache, m_impl->m_fileSystems, &m_impl->m_jobs);
+			auto uploads = m_impl->m_uploads;
+			m_impl->m_jobs.Run([mesh, uploads, meshName]()
+			{
+				try
+				{
+					mesh->Read(meshName);
+				}
+				catch (...)
+				{
+					mesh->MarkFailed();
+					return;
+				}
+				uploads->Push(mesh);
+			}, m_impl->m_loads);
+			m_impl->m_meshCache[key] = mesh;
 			return mesh;
 		}
 
+		void Engine::PreloadMesh(const std::string& meshName)
+		{
+			if (!m_impl)
+				return;
+
+			m_impl->m_preloadedMeshes[m_impl->MeshKey(meshName)] = LoadMeshAsync(meshName);
+		}
+
+		bool Engine::EvictMesh(const std::string& meshName)
+		{
+			if (!m_impl)
+				return false;
+
+			const auto key = m_impl->MeshKey(meshName);
+			const bool preloaded = m_impl->m_preloadedMeshes.erase(key) != 0;
+			const bool cached = m_impl->m_meshCache.erase(key) != 0;
+			return preloaded || cached;
+		}
+
+		void Engine::Mount(const FileSystemPtr& fileSystem, const int priority)
+		{
+			if (!m_impl)
+				return;
+
+			m_impl->m_fileSystems->Mount(fileSystem, priority);
+		}
+
+		bool Engine::Unmount(const FileSystemPtr& fileSystem)
+		{
+			if (!m_impl)
+				return false;
+
+			return m_impl->m_fileSystems->Unmount(fileSystem);
+		}
+
+		void Engine::MountPack(const std::string& packName)
+		{
+			if (!m_impl)
+				return;
+
+			Mount(CreatePackFileSystem(packName, &m_impl->m_jobs), 0);
+		}
+
+		FileSystemPtr Engine::DefaultFileSystem() const
+		{
+			if (!m_impl)
+				return nullptr;
+
+			return m_impl->m_defaultFileSystem;
+		}
+
+		FileSystemStats Engine::GetFileSystemStats(const FileSystemPtr& fileSystem) const
+		{
+			if (!m_impl)
+				return FileSystemStats();
+
+			return m_impl->m_fileSystems->Stats(fileSystem);
+		}
+
+		void Engine::SetUploadBudget(const double seconds)
+		{
+			if (!m_impl)
+				return;
+
+			m_impl->m_uploadBudget = seconds;
+		}
+
 		bool Engine::IsKeyDown(char key) const
 		{
 #ifdef PICO_WINDOWS
@@ -2754,6 +8121,90 @@ namespace CogitareComputing
 			m_impl->InitPerspective(m_impl->m_renderDetails.m_perspectiveMatrix, static_cast<float>(m_impl->m_window.Width()), static_cast<float>(m_impl->m_window.Height()));
 		}
 
+		void Engine::UseArrayBuffers(const bool useArrayBuffers)
+		{
+			if (!m_impl)
+				return;
+
+			m_impl->m_useArrayBuffers = useArrayBuffers;
+		}
+
+		void Engine::UseCompactVertices(const bool compactVertices)
+		{
+			if (!m_impl)
+				return;
+
+			m_impl->m_compactVertices = compactVertices;
+		}
+
+		void Engine::UseTextureDiskCache(const std::string& directory, const size_t maxBytes)
+		{
+			if (!m_impl)
+				return;
+
+			m_impl->m_textureCache->UseDiskCache(directory.empty() ? std::shared_ptr<TextureDiskCache>() : std::make_shared<TextureDiskCache>(directory, maxBytes));
+		}
+
+		void Engine::UseFrustumCulling(const bool frustumCulling)
+		{
+			if (!m_impl)
+				return;
+
+			m_impl->m_frustumCulling = frustumCulling;
+		}
+
+		void Engine::UseParallelUpdates(const bool parallelUpdates)
+		{
+			if (!m_impl)
+				return;
+
+			m_impl->m_parallelUpdates = parallelUpdates;
+		}
+
+		void Engine::UseRenderThread(const bool renderThread, const size_t bufferedFrames)
+		{
+			if (!m_impl)
+				return;
+
+			m_impl->m_useRenderThread = renderThread;
+			m_impl->m_bufferedFrames = std::max(bufferedFrames, static_cast<size_t>(2));
+		}
+
+		void Engine::SetClearColour(const Vec4& colour)
+		{
+			if (!m_impl)
+				return;
+
+			m_impl->m_clearColour = colour;
+		}
+
+		FrameStats Engine::GetFrameStats() const
+		{
+			if (!m_impl)
+				return FrameStats();
+
+			return m_impl->m_frameStats.Stats();
+		}
+
+		TextureCacheStats Engine::GetTextureCacheStats() const
+		{
+			if (!m_impl)
+				return TextureCacheStats();
+
+			return m_impl->m_textureCache->Stats();
+		}
+
+		JobSystem& Engine::Jobs()
+		{
+			if (!m_impl)
+			{
+				static JobSystem noWorkers(0); //Jobs run on the thread that waits for them
+				return noWorkers;
+			}
+
+			return m_impl->m_jobs;
+		}
+
 		Engine::~Engine()
 		{
 		}
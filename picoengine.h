@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <vector>
 #include <memory>
 #include <functional>
 #include <stdexcept>
@@ -42,9 +43,31 @@
 //PICO_UNIVERSAL      - Win10 Universal app support, allowing the Pico Engine to be used on any platform that support Universal Apps with ANGLE
 
 //Additional switches: 
-//USE_ARRAY_BUFFERS - Use array buffer object instead of client side memory for vertex data. 
+//USE_ARRAY_BUFFERS - Use array buffer object instead of client side memory for vertex data by default. Engine::UseArrayBuffers changes it per mesh at runtime.
 //SOUND_SUPPORT - Basic sound effect and wave-file loading support using OpenAL
 //OGG_PLAYBACK - Ogg Vorbis playback using stb_vorbis decoder http://www.nothings.org/stb_vorbis/ . Requires SOUND_SUPPORT
+//PICO_NO_SIMD - Use the scalar matrix math and PNG unfiltering even when SSE2 or NEON is available
+//
+//Render thread:
+//Engine::UseRenderThread hands the GL context to a thread of its own for the duration of Run. The callback and the
+//object updates of the next frame then run while the previous frame is drawn and swapped. What changes when it's on:
+//- The callback and the IGameObject updates run without a GL context, so they must not make GL calls. The engine
+//  clears the screen itself, see Engine::SetClearColour.
+//- AdditionalRenderInstructionsBefore/After run on the render thread. They may make GL calls but must not touch
+//  game state, the object can already be a frame or two further along by then.
+//- Everything else the engine draws from is copied at the end of each update, so objects, the camera and the light
+//  can be changed freely from the callback.
+//- LoadMesh still works from the callback, the files are read on the calling thread and the GL upload blocks until
+//  the render thread has done it.
+//- More buffered frames smooth out uneven frame times at the cost of latency, Engine::GetFrameStats measures both.
+//
+//Parallel updates:
+//With Engine::UseParallelUpdates on, objects marked with IGameObject::SetThreadSafeUpdate are updated on the worker
+//threads before the rest of the objects are updated in order. Such an update may change its own object, read other
+//objects, and call Engine::AddGameObject, RemoveGameObject, GameObject and IsKeyDown. Adds and removes are held back
+//and applied in object order once every update is done, so the outcome doesn't depend on the number of threads.
+//An object created during such an update gets its id when that add is applied, Id() isn't meaningful before.
+//Anything else, such as SetParent, other engine calls or writes to shared game state, needs the object to stay serial.
 //
 
 #define USE_ARRAY_BUFFERS
@@ -57,6 +80,12 @@
 #ifdef PICO_ANDROID
 struct android_app;
 #endif
+//For static data only, heap allocations aren't guaranteed to honour it
+#ifdef _MSC_VER
+#define PICO_ALIGN16 __declspec(align(16))
+#else
+#define PICO_ALIGN16 __attribute__((aligned(16)))
+#endif
 #ifdef PICO_UNIVERSAL
 struct IInspectable;
 typedef IInspectable* EGLNativeWindowType;
@@ -111,11 +140,61 @@ namespace CogitareComputing
 
 		//-------------------------------------------------------------------------------------------------
 
+		struct Vec4
+		{
+			Vec4(float x, float y, float z, float w)
+				:X(x)
+				, Y(y)
+				, Z(z)
+				, W(w)
+			{}
+
+			Vec4(const Vec3& v, float w)
+				:X(v.X)
+				, Y(v.Y)
+				, Z(v.Z)
+				, W(w)
+			{}
+
+			Vec4()
+				:X(0.0f)
+				, Y(0.0f)
+				, Z(0.0f)
+				, W(0.0f)
+			{}
+
+			float X;
+			float Y;
+			float Z;
+			float W;
+		};
+
+		//-------------------------------------------------------------------------------------------------
+
+		//Row major 4x4 matrix, M[row][column], uploaded as is to GL (the shaders multiply the vector from the left).
+		//The math uses SSE2 or NEON when available, with unaligned loads and stores. It isn't declared 16 byte aligned,
+		//since neither C++11 operator new nor every malloc would honour that for the objects holding one.
+		struct Mat4
+		{
+			static Mat4 Identity();
+
+			float M[4][4];
+		};
+
+		Mat4 operator*(const Mat4& lhs, const Mat4& rhs);
+		Vec4 operator*(const Mat4& lhs, const Vec4& rhs);
+		Mat4 Transpose(const Mat4& m);
+		bool Inverse(const Mat4& m, Mat4& inverse); //Returns false, and leaves inverse untouched, for singular matrices
+
+		//-------------------------------------------------------------------------------------------------
+
 		class IMesh
 		{
 		public:
 			virtual ~IMesh();
 			size_t Id() const;
+			virtual bool IsResident() const; //False until an asynchronous load has been uploaded, objects using it draw nothing until then
+			virtual bool HasFailed() const; //True once an asynchronous load has failed, the mesh then never becomes resident
 		protected:
 			IMesh();
 
@@ -124,6 +203,45 @@ namespace CogitareComputing
 		};
 		typedef std::shared_ptr<IMesh> MeshPtr;
 
+		//How well the post transform vertex cache does on a cooked mesh, in vertices transformed per triangle by a 16
+		//entry FIFO cache (ACMR), for the triangles in obj order and in the order they were cooked into
+		struct MeshCookStats
+		{
+			MeshCookStats()
+				:m_triangles(0)
+				, m_acmrBefore(0.0f)
+				, m_acmrAfter(0.0f)
+			{}
+
+			size_t m_triangles;
+			float m_acmrBefore;
+			float m_acmrAfter;
+		};
+
+#ifndef PICO_ANDROID
+		//Converts an obj and its materials into the .pmesh format, which is mapped and uploaded without any parsing.
+		//Engine::LoadMesh uses foo.pmesh in place of foo.obj when it's at least as new. Throws EngineException on failure.
+		//Android can't cook, cook them on the desktop and ship the .pmesh files.
+		//Compact vertices are normalised shorts, see Engine::UseCompactVertices.
+		MeshCookStats CookMesh(const std::string& objName, const std::string& pmeshName, const bool compactVertices = false);
+
+		//Converts a PNG to .qoi or .rgba, picked by textureName's extension. Both decode several times faster than PNG,
+		//.rgba is uncompressed. Textures are recognised by their contents, so the mtl files can name them as they are.
+		//Throws EngineException on failure.
+		void ConvertTexture(const std::string& pngName, const std::string& textureName);
+#endif
+#if defined(PICO_PI) || defined(PICO_WINDOWS)
+		//Packs every file below directory into a .pak for Engine::MountPack, named by their paths relative to it.
+		//A compressed pack stores them as LZ4, which reads less from slow storage for some decompression time. Large
+		//files of it are decompressed in parallel on the jobs given to CreatePackFileSystem.
+		void BuildAssetPack(const std::string& directory, const std::string& packName, const bool compress = false);
+
+		//Writes every file below directory into a C++ source of byte arrays, so they're compiled into the binary. The
+		//source defines FileSystemPtr functionName(), a file system that serves them without copying or any file I/O.
+		//Mount it and unmount Engine::DefaultFileSystem for a startup that opens no files at all.
+		void BuildEmbeddedAssets(const std::string& directory, const std::string& sourceName, const std::string& functionName);
+#endif
+
 		//-------------------------------------------------------------------------------------------------
 
 		class IGameObject
@@ -131,19 +249,28 @@ namespace CogitareComputing
 		public:
 			IGameObject(MeshPtr mesh);
 			virtual ~IGameObject();
-			size_t Id() const;
+			size_t Id() const; //Objects created during a parallel update are numbered when they're added
 			void SetPosition(const Vec3& pos);
 			const Vec3& Position() const;
 			void SetRotation(const Vec3& pos);
 			const Vec3& Rotation() const;
 			void SetScale(const Vec3& pos);
 			const Vec3& Scale() const;
+			const Mat4& RotationMatrix() const;
+			void SetParent(const std::shared_ptr<IGameObject>& parent); //Position, rotation and scale become relative to the parent, nullptr detaches
+			std::shared_ptr<IGameObject> Parent() const;
+			const Mat4& WorldMatrix() const; //Refreshed by the engine every frame after the objects have been updated
 			void UseLighting(const bool lighting);
 			void SetAlpha(const float alpha);
+			float Alpha() const;
 			void SkipViewMatrix(const bool skipViewMatrix);
+			bool SkipsViewMatrix() const;
 			bool Update(const double elapsedTime);
+			void SetThreadSafeUpdate(const bool threadSafe); //See the parallel update notes at the top
+			bool HasThreadSafeUpdate() const;
 			struct RenderDetails;
-			void Render(const double elapsedTime, const RenderDetails& details);
+			struct Renderer; //Engine internal, draws buckets of objects sharing the same render flags
+			struct SceneGraph; //Engine internal, the object hierarchy flattened in depth first order
 			void SetPass(const int pass);
 			int Pass() const;
 		protected:
@@ -155,8 +282,6 @@ namespace CogitareComputing
 			virtual void AdditionalRenderInstructionsAfter(const double elapsedTime) {}
 			const IMesh& Mesh() const;
 		private:
-			void UpdateTranslationMatrix(const Vec3 & pos);
-			void UpdateScaleMatrix(const Vec3 & scale);
 			Vec3 m_position;
 			Vec3 m_rotation;
 			Vec3 m_scale;
@@ -164,12 +289,15 @@ namespace CogitareComputing
 			bool m_skipViewMatrix;
 			float m_alpha;
 			MeshPtr m_mesh;
-			static size_t s_gobId;
 			size_t m_gobId;
-			float m_rotationMatrix[4][4];
-			float m_translationMatrix[4][4];
-			float m_scaleMatrix[4][4];
+			Mat4 m_rotationMatrix;
 			int m_pass;
+			std::weak_ptr<IGameObject> m_parent;
+			Mat4 m_worldMatrix;
+			bool m_transformDirty;
+			bool m_threadSafeUpdate;
+			size_t m_sceneOrder;
+			static size_t s_hierarchyVersion;
 		};
 		typedef std::shared_ptr<IGameObject> GameObjectPtr;
 
@@ -277,6 +405,134 @@ namespace CogitareComputing
 #endif
 		//-------------------------------------------------------------------------------------------------
 
+		//Counts the jobs started with it that haven't finished yet. Copies share the count. It can be used again for
+		//more jobs once it's done.
+		class JobCounter
+		{
+		public:
+			JobCounter();
+			bool IsDone() const;
+			struct State; //Job system internal
+		private:
+			friend class JobSystem;
+			std::shared_ptr<State> m_state;
+		};
+
+		//Work stealing job scheduler, reached through Engine::Jobs. Every worker and the thread that created it own a
+		//deque of jobs, and idle threads steal from the others. Jobs can be started from any thread, and a thread can
+		//create several job systems.
+		class JobSystem
+		{
+		public:
+			typedef std::function<void()> Job;
+			typedef std::function<void(const size_t, const size_t)> RangeJob;
+
+			explicit JobSystem(const size_t workerCount);
+			~JobSystem();
+			JobSystem(const JobSystem&) = delete;
+
+			void Run(const Job& job, JobCounter& counter);
+			void RunAfter(const JobCounter& dependency, const Job& job, JobCounter& counter); //Starts the job once dependency is done
+			void Wait(const JobCounter& counter); //Runs other jobs until the counter is done, sleeping when there are none. Rethrows the first exception of its jobs.
+			void ParallelFor(const size_t count, const RangeJob& job, const size_t minGrain = 1); //Calls job with sub ranges of [0, count), splitting further only while threads are idle
+			bool RunPendingJob(); //Runs one waiting job on the calling thread, false if there wasn't any
+			size_t ThreadCount() const; //Workers plus the creating thread
+		private:
+			struct Impl;
+			std::unique_ptr<Impl> m_impl;
+		};
+
+		//-------------------------------------------------------------------------------------------------
+
+		//The contents of an opened file, valid as long as the FilePtr
+		class IFile
+		{
+		public:
+			virtual ~IFile() {}
+			virtual const char* Data() const = 0;
+			virtual size_t Size() const = 0;
+			virtual size_t StoredSize() const { return Size(); } //Bytes it took in storage, less than Size when it was compressed
+		};
+		typedef std::shared_ptr<IFile> FilePtr;
+
+		//Where meshes, textures and sounds are read from, see Engine::Mount. Opened from the job threads, so the
+		//implementations have to be thread safe.
+		class IFileSystem
+		{
+		public:
+			virtual ~IFileSystem() {}
+			virtual FilePtr Open(const std::string& name) = 0; //The whole file, nullptr when there's no such file
+			virtual bool Exists(const std::string& name) { return Open(name) != nullptr; }
+			virtual bool ModifiedTime(const std::string&, long long&) { return false; } //For files that have one, tells a cooked mesh older than its source
+		};
+		typedef std::shared_ptr<IFileSystem> FileSystemPtr;
+
+		//A file served straight from memory
+		struct MemoryFile
+		{
+			MemoryFile(const std::string& name, const char* data, const size_t size)
+				:m_name(name)
+				, m_data(data)
+				, m_size(size)
+			{}
+
+			std::string m_name;
+			const char* m_data;
+			size_t m_size;
+		};
+
+		FileSystemPtr CreateDirectoryFileSystem(const std::string& directory); //Loose files below directory, empty is the working directory
+		FileSystemPtr CreatePackFileSystem(const std::string& packName, JobSystem* jobs = nullptr); //A .pak made by BuildAssetPack, mapped and served without copying unless it's compressed. Large compressed files are decompressed on jobs. Throws EngineException if it can't be opened
+		FileSystemPtr CreateMemoryFileSystem(const std::vector<MemoryFile>& files); //Not copied, the buffers must stay unchanged as long as the file system is used
+		FileSystemPtr CreateMemoryFileSystem(const FileSystemPtr& source, const std::vector<std::string>& names); //Reads the named files of source into memory once. Throws EngineException if one is missing
+
+		//-------------------------------------------------------------------------------------------------
+
+		struct FrameStats
+		{
+			FrameStats()
+				:m_frameTime(0.0)
+				, m_latency(0.0)
+				, m_frames(0)
+			{}
+
+			double m_frameTime; //Seconds between presented frames, averaged
+			double m_latency; //Seconds from the start of a frame's update until it was presented, averaged
+			size_t m_frames; //Frames presented by the current or last Run
+		};
+
+		struct TextureCacheStats
+		{
+			TextureCacheStats()
+				:m_hits(0)
+				, m_misses(0)
+				, m_textures(0)
+			{}
+
+			size_t m_hits; //Texture references served by a texture another mesh had already loaded
+			size_t m_misses; //Texture references that had to be read and decoded
+			size_t m_textures; //Distinct textures in use right now
+		};
+
+		struct FileSystemStats
+		{
+			FileSystemStats()
+				:m_opens(0)
+				, m_misses(0)
+				, m_bytes(0)
+				, m_storedBytes(0)
+				, m_seconds(0.0)
+			{}
+
+			size_t m_opens; //Files the file system served
+			size_t m_misses; //Files it was asked for but didn't have
+			unsigned long long m_bytes; //Size of the files it served
+			unsigned long long m_storedBytes; //What they took in storage, less than m_bytes for a compressed pack
+			double m_seconds; //Time spent opening files, including decompression. Mapped files are paged in as they're read afterwards, which isn't included
+		};
+
+		//-------------------------------------------------------------------------------------------------
+
 		class Engine
 		{
 		public:
@@ -288,10 +544,29 @@ namespace CogitareComputing
 			GameObjectPtr GameObject(const size_t id);
 			void SetCameraPos(const Vec3& pos);
 			void SetCameraRotation(const Vec3& rot);
-			MeshPtr LoadMesh(const std::string& meshName);
+			MeshPtr LoadMesh(const std::string& meshName); //Returns the mesh already loaded from the same path while anything still uses it. An asynchronous load of it in progress is finished first, so the mesh is always resident. Throws EngineException on failure
+			MeshPtr LoadMeshAsync(const std::string& meshName); //Returns at once, files are read and decoded on the job system and uploaded by Run. A mesh whose load fails reports HasFailed, and the next load of the name tries again
+			void PreloadMesh(const std::string& meshName); //Loads asynchronously and keeps the mesh cached even while nothing uses it
+			bool EvictMesh(const std::string& meshName); //Forgets the cached mesh so the next load reads the file again, objects using it keep it. False if it wasn't cached
+			void Mount(const FileSystemPtr& fileSystem, const int priority = 0); //Meshes, textures and sounds are read from the mounted file system with the highest priority that has them, the last mounted first among equal priorities
+			bool Unmount(const FileSystemPtr& fileSystem); //Files already opened from it stay valid. False if it wasn't mounted
+			void MountPack(const std::string& packName); //Mounts CreatePackFileSystem(packName) at priority 0, so it's searched before loose files
+			FileSystemPtr DefaultFileSystem() const; //The working directory, or the apk assets on Android, mounted at priority 0 from the start
+			FileSystemStats GetFileSystemStats(const FileSystemPtr& fileSystem) const; //Since it was mounted, zero if it isn't
+			void SetUploadBudget(const double seconds); //Time per frame Run may spend on the GL uploads of asynchronous loads, at least one is always done
 			bool IsKeyDown(char key) const;
 			void SetLight(const Vec3& pos);
 			void SetPerspectiveScaling(const float perspectiveScaling);
+			void UseArrayBuffers(const bool useArrayBuffers); //For meshes loaded after the call, both kinds can be drawn in the same frame
+			void UseCompactVertices(const bool compactVertices); //Off by default. For obj files loaded after the call, positions and texture coordinates in 0..1 are stored as normalised shorts, 12 bytes a vertex instead of 20
+			void UseTextureDiskCache(const std::string& directory, const size_t maxBytes); //Keeps decoded textures in the existing directory so later runs skip the PNG decode, least recently used ones go beyond maxBytes. Empty turns it off
+			void UseFrustumCulling(const bool frustumCulling); //On by default, objects outside the view aren't drawn
+			void UseParallelUpdates(const bool parallelUpdates); //Off by default, see the notes at the top
+			void UseRenderThread(const bool renderThread, const size_t bufferedFrames = 2); //From the next Run, 2 frames is double buffering and 3 triple. See the notes at the top
+			void SetClearColour(const Vec4& colour); //Used when the engine clears the screen itself, i.e. with a render thread
+			FrameStats GetFrameStats() const;
+			TextureCacheStats GetTextureCacheStats() const; //Meshes share textures with the same file and sampling, freed with the last mesh using them
+			JobSystem& Jobs(); //Without workers if the engine failed to start, so jobs run in Wait
 
 #ifdef SOUND_SUPPORT
 			ISoundPtr GetSound(const std::string& filename);
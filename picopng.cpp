@@ -0,0 +1,825 @@
+#include "picopng.h"
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+
+#ifndef PICO_NO_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PICO_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM) || defined(_M_ARM64)
+#define PICO_SIMD_NEON
+#include <arm_neon.h>
+#endif
+#endif
+using namespace std;
+
+namespace pico
+{
+#if defined(PICO_SIMD_SSE2) || defined(PICO_SIMD_NEON)
+	namespace simd
+	{
+		//Unfiltering of 3 and 4 byte pixels. Each pixel depends on the one to its left so the vectors hold a single pixel,
+		//the gain is doing its channels at once without the per byte branches of paethPredictor. The few operations needed
+		//are wrapped so the filters themselves are written once for SSE2 and NEON.
+#ifdef PICO_SIMD_SSE2
+		typedef __m128i Pixel; //one pixel in the low bytes, paeth works on 16 bit lanes
+
+		inline Pixel zero() { return _mm_setzero_si128(); }
+		inline Pixel add(Pixel a, Pixel b) { return _mm_add_epi8(a, b); }
+		inline Pixel average(Pixel a, Pixel b) { return _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1))); } //avg_epu8 rounds up, PNG rounds down
+		inline Pixel select(Pixel mask, Pixel a, Pixel b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+		inline Pixel absDiff(Pixel a, Pixel b) { Pixel d = _mm_sub_epi16(a, b); return _mm_max_epi16(d, _mm_sub_epi16(_mm_setzero_si128(), d)); }
+		inline Pixel paeth(Pixel a, Pixel b, Pixel c) //same choice as paethPredictor, ties go to a, then b
+		{
+			Pixel z = _mm_setzero_si128(), a16 = _mm_unpacklo_epi8(a, z), b16 = _mm_unpacklo_epi8(b, z), c16 = _mm_unpacklo_epi8(c, z);
+			Pixel pa = absDiff(b16, c16), pb = absDiff(a16, c16), pc = absDiff(_mm_add_epi16(a16, b16), _mm_add_epi16(c16, c16));
+			Pixel smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+			Pixel nearest = select(_mm_cmpeq_epi16(smallest, pc), c16, b16);
+			nearest = select(_mm_cmpeq_epi16(smallest, pb), b16, nearest);
+			nearest = select(_mm_cmpeq_epi16(smallest, pa), a16, nearest);
+			return _mm_packus_epi16(nearest, nearest);
+		}
+		template<size_t N> inline Pixel load(const unsigned char* p) { uint32_t v = 0; memcpy(&v, p, N); return _mm_cvtsi32_si128((int)v); }
+		template<size_t N> inline void store(unsigned char* p, Pixel v) { uint32_t x = (uint32_t)_mm_cvtsi128_si32(v); memcpy(p, &x, N); }
+		inline void up(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon, size_t length)
+		{
+			size_t i = 0;
+			for (; i + 16 <= length; i += 16) _mm_storeu_si128((__m128i*)(recon + i), _mm_add_epi8(_mm_loadu_si128((const __m128i*)(scanline + i)), _mm_loadu_si128((const __m128i*)(precon + i))));
+			for (; i < length; i++) recon[i] = scanline[i] + precon[i];
+		}
+#else
+		typedef uint8x8_t Pixel; //one pixel in the low bytes
+
+		inline Pixel zero() { return vdup_n_u8(0); }
+		inline Pixel add(Pixel a, Pixel b) { return vadd_u8(a, b); }
+		inline Pixel average(Pixel a, Pixel b) { return vhadd_u8(a, b); }
+		inline Pixel paeth(Pixel a, Pixel b, Pixel c) //same choice as paethPredictor, ties go to a, then b
+		{
+			uint16x8_t pa = vabdl_u8(b, c), pb = vabdl_u8(a, c), pc = vabdq_u16(vaddl_u8(a, b), vaddl_u8(c, c));
+			uint8x8_t useA = vmovn_u16(vandq_u16(vcleq_u16(pa, pb), vcleq_u16(pa, pc))), useB = vmovn_u16(vcleq_u16(pb, pc));
+			return vbsl_u8(useA, a, vbsl_u8(useB, b, c));
+		}
+		template<size_t N> inline Pixel load(const unsigned char* p) { uint32_t v = 0; memcpy(&v, p, N); return vreinterpret_u8_u32(vdup_n_u32(v)); }
+		template<size_t N> inline void store(unsigned char* p, Pixel v) { uint32_t x = vget_lane_u32(vreinterpret_u32_u8(v), 0); memcpy(p, &x, N); }
+		inline void up(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon, size_t length)
+		{
+			size_t i = 0;
+			for (; i + 16 <= length; i += 16) vst1q_u8(recon + i, vaddq_u8(vld1q_u8(scanline + i), vld1q_u8(precon + i)));
+			for (; i < length; i++) recon[i] = scanline[i] + precon[i];
+		}
+#endif
+		template<size_t N> void sub(unsigned char* recon, const unsigned char* scanline, size_t length)
+		{
+			Pixel a = zero();
+			for (size_t i = 0; i < length; i += N) { a = add(load<N>(scanline + i), a); store<N>(recon + i, a); }
+		}
+		template<size_t N> void average(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon, size_t length)
+		{
+			Pixel a = zero();
+			for (size_t i = 0; i < length; i += N) { a = add(load<N>(scanline + i), average(a, load<N>(precon + i))); store<N>(recon + i, a); }
+		}
+		template<size_t N> void paeth(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon, size_t length)
+		{
+			Pixel a = zero(), c = zero();
+			for (size_t i = 0; i < length; i += N)
+			{
+				Pixel b = load<N>(precon + i);
+				a = add(load<N>(scanline + i), paeth(a, b, c));
+				store<N>(recon + i, a);
+				c = b;
+			}
+		}
+		//Returns false for what is left to the scalar code: other pixel sizes, and Average and Paeth on the first line where they need no vectors
+		inline bool unFilterScanline(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon, size_t bytewidth, unsigned long filterType, size_t length)
+		{
+			if (filterType == 2 && precon) { up(recon, scanline, precon, length); return true; }
+			if ((bytewidth != 3 && bytewidth != 4) || length % bytewidth) return false;
+			bool four = bytewidth == 4;
+			switch (filterType)
+			{
+			case 1: four ? sub<4>(recon, scanline, length) : sub<3>(recon, scanline, length); return true;
+			case 3: if (!precon) return false; four ? average<4>(recon, scanline, precon, length) : average<3>(recon, scanline, precon, length); return true;
+			case 4: if (!precon) return false; four ? paeth<4>(recon, scanline, precon, length) : paeth<3>(recon, scanline, precon, length); return true;
+			default: return false;
+			}
+		}
+	}
+#endif
+
+	//Both decodePNG overloads, buffers is only given by the one writing a pixel format straight into out_image
+	static int decodeImage(std::vector<unsigned char>& out_image, unsigned long& image_width, unsigned long& image_height, const unsigned char* in_png, size_t in_size, bool convert_to_rgba32, PixelFormat format, bool flip_y, DecodeBuffers* buffers)
+	{
+		// picoPNG version 20101224
+		// Copyright (c) 2005-2010 Lode Vandevenne
+		//
+		// This software is provided 'as-is', without any express or implied
+		// warranty. In no event will the authors be held liable for any damages
+		// arising from the use of this software.
+		//
+		// Permission is granted to anyone to use this software for any purpose,
+		// including commercial applications, and to alter it and redistribute it
+		// freely, subject to the following restrictions:
+		//
+		//     1. The origin of this software must not be misrepresented; you must not
+		//     claim that you wrote the original software. If you use this software
+		//     in a product, an acknowledgment in the product documentation would be
+		//     appreciated but is not required.
+		//     2. Altered source versions must be plainly marked as such, and must not be
+		//     misrepresented as being the original software.
+		//     3. This notice may not be removed or altered from any source distribution.
+
+		// picoPNG is a PNG decoder in one C++ function of around 500 lines. Use picoPNG for
+		// programs that need only 1 .cpp file. Since it's a single function, it's very limited,
+		// it can convert a PNG to raw pixel data either converted to 32-bit RGBA color or
+		// with no color conversion at all. For anything more complex, another tiny library
+		// is available: LodePNG (lodepng.c(pp)), which is a single source and header file.
+		// Apologies for the compact code style, it's to make this tiny.
+
+		static const unsigned long LENBASE[29] = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+		static const unsigned long LENEXTRA[29] = { 0,0,0,0,0,0,0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4,  4,  5,  5,  5,  5,  0 };
+		static const unsigned long DISTBASE[30] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577 };
+		static const unsigned long DISTEXTRA[30] = { 0,0,0,0,1,1,2, 2, 3, 3, 4, 4, 5, 5,  6,  6,  7,  7,  8,  8,   9,   9,  10,  10,  11,  11,  12,   12,   13,   13 };
+		static const unsigned long CLCL[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 }; //code length code lengths
+		struct Zlib //nested functions for zlib decompression
+		{
+			struct BitReader //the stream in a 64 bit buffer refilled a word at a time, reading past its end gives zeros and sets overrun
+			{
+				const unsigned char* in; size_t size, pos; uint64_t buffer; unsigned bitcount;
+				void init(const unsigned char* data, size_t length) { in = data; size = length; pos = 0; buffer = 0; bitcount = 0; }
+				static uint64_t readWord(const unsigned char* p)
+				{
+					uint64_t word; memcpy(&word, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+					word = __builtin_bswap64(word);
+#endif
+					return word;
+				}
+				void refill() //afterwards there are at least 56 bits in the buffer
+				{
+					if (pos + 8 <= size) { buffer |= readWord(in + pos) << bitcount; pos += (63 - bitcount) >> 3; bitcount |= 56; } //bytes that didn't fit are read again next time
+					else while (bitcount <= 56) { buffer |= (uint64_t)(pos < size ? in[pos] : 0) << bitcount; pos++; bitcount += 8; }
+				}
+				unsigned long peek(unsigned n) const { return (unsigned long)(buffer & ((uint64_t(1) << n) - 1)); }
+				void consume(unsigned n) { buffer >>= n; bitcount -= n; }
+				unsigned long bits(unsigned n) { unsigned long result = peek(n); consume(n); return result; } //n bits must be in the buffer
+				unsigned long readBits(unsigned n) { refill(); return bits(n); }
+				bool overrun() const { return (pos << 3) - bitcount > (size << 3); } //more bits used than the stream has
+				size_t bytePos() const { return pos - (bitcount >> 3); } //of the next whole byte, once aligned
+				void alignToByte() { consume(bitcount & 7); }
+				void seek(size_t bytepos) { pos = bytepos; buffer = 0; bitcount = 0; }
+			};
+			struct HuffmanTree
+			{
+				//The first rootbits bits of a code index the root table, longer codes continue in a sub table. Entries are
+				//symbol << 8 | length, or offset << 8 | SUBTABLE | sub table bits. Length 0 is a code that doesn't exist.
+				enum { SUBTABLE = 0x80, LENGTHMASK = 0x7f };
+				std::vector<uint32_t> table;
+				unsigned rootbits;
+				int makeFromLengths(const std::vector<unsigned long>& bitlen, unsigned long maxbitlen, unsigned root)
+				{ //make the tables given the lengths
+					unsigned long numcodes = (unsigned long)(bitlen.size()), blcount[16] = { 0 }, nextcode[16] = { 0 };
+					for (unsigned long n = 0; n < numcodes; n++) { if (bitlen[n] > maxbitlen) return 55; blcount[bitlen[n]]++; } //count number of instances of each code length
+					blcount[0] = 0;
+					long left = 1;
+					for (unsigned long bits = 1; bits <= maxbitlen; bits++) { left = (left << 1) - (long)blcount[bits]; if (left < 0) return 55; } //more codes than the lengths allow
+					for (unsigned long bits = 1; bits <= maxbitlen; bits++) nextcode[bits] = (nextcode[bits - 1] + blcount[bits - 1]) << 1;
+					rootbits = root;
+					std::vector<unsigned long> reversed(numcodes); //codes are read starting from their first bit, so the tables are indexed by the reversed code
+					std::vector<unsigned char> subbits(size_t(1) << root, 0); //per root entry, the longest code starting with it
+					for (unsigned long n = 0; n < numcodes; n++)
+					{
+						if (bitlen[n] == 0) continue;
+						unsigned long code = nextcode[bitlen[n]]++, rev = 0;
+						for (unsigned long i = 0; i < bitlen[n]; i++) rev |= ((code >> i) & 1) << (bitlen[n] - i - 1);
+						reversed[n] = rev;
+						if (bitlen[n] > root) subbits[rev & ((1 << root) - 1)] = (unsigned char)std::max<unsigned long>(subbits[rev & ((1 << root) - 1)], bitlen[n] - root);
+					}
+					size_t size = size_t(1) << root;
+					for (size_t i = 0; i < subbits.size(); i++) size += subbits[i] ? size_t(1) << subbits[i] : 0;
+					table.assign(size, 0);
+					for (size_t i = 0, offset = size_t(1) << root; i < subbits.size(); i++)
+						if (subbits[i]) { table[i] = (uint32_t)(offset << 8) | SUBTABLE | subbits[i]; offset += size_t(1) << subbits[i]; }
+					for (unsigned long n = 0; n < numcodes; n++)
+					{
+						unsigned long len = bitlen[n], rev = reversed[n];
+						if (len == 0) continue;
+						if (len <= root) for (size_t i = rev; i < (size_t(1) << root); i += size_t(1) << len) table[i] = (uint32_t)(n << 8) | len; //every entry the code is a prefix of
+						else
+						{
+							uint32_t sub = table[rev & ((1 << root) - 1)];
+							for (size_t i = rev >> root; i < (size_t(1) << (sub & LENGTHMASK)); i += size_t(1) << (len - root)) table[(sub >> 8) + i] = (uint32_t)(n << 8) | (len - root);
+						}
+					}
+					return 0;
+				}
+			};
+			struct Inflator
+			{
+				int error;
+				BitReader reader;
+				void inflate(std::vector<unsigned char>& out, const std::vector<unsigned char>& in, size_t inpos = 0)
+				{
+					size_t pos = 0; //byte pointer in out
+					error = 0;
+					reader.init(&in[inpos], in.size() - inpos);
+					unsigned long BFINAL = 0;
+					while (!BFINAL && !error)
+					{
+						reader.refill();
+						BFINAL = reader.bits(1);
+						unsigned long BTYPE = reader.bits(2);
+						if (reader.overrun()) { error = 52; return; } //error, bit pointer will jump past memory
+						if (BTYPE == 3) { error = 20; return; } //error: invalid BTYPE
+						else if (BTYPE == 0) inflateNoCompression(out, pos);
+						else inflateHuffmanBlock(out, pos, BTYPE);
+					}
+					if (!error) out.resize(pos); //Only now we know the true size of out, resize it to that
+				}
+				void generateFixedTrees(HuffmanTree& tree, HuffmanTree& treeD) //get the tree of a deflated block with fixed tree
+				{
+					std::vector<unsigned long> bitlen(288, 8), bitlenD(32, 5);
+					for (size_t i = 144; i <= 255; i++) bitlen[i] = 9;
+					for (size_t i = 256; i <= 279; i++) bitlen[i] = 7;
+					tree.makeFromLengths(bitlen, 15, 9);
+					treeD.makeFromLengths(bitlenD, 15, 5);
+				}
+				HuffmanTree codetree, codetreeD, codelengthcodetree; //the code tree for Huffman codes, dist codes, and code length codes
+				unsigned long huffmanDecodeSymbol(const HuffmanTree& codetree)
+				{ //decode a single symbol with the given tables, the reader must hold at least 15 bits
+					uint32_t entry = codetree.table[reader.peek(codetree.rootbits)];
+					if (entry & HuffmanTree::SUBTABLE) { reader.consume(codetree.rootbits); entry = codetree.table[(entry >> 8) + reader.peek(entry & HuffmanTree::LENGTHMASK)]; }
+					if ((entry & HuffmanTree::LENGTHMASK) == 0) { error = 11; return 0; } //error: the code isn't in the tree
+					reader.consume(entry & HuffmanTree::LENGTHMASK);
+					return entry >> 8;
+				}
+				void getTreeInflateDynamic(HuffmanTree& tree, HuffmanTree& treeD)
+				{ //get the tree of a deflated block with dynamic tree, the tree itself is also Huffman compressed with a known tree
+					std::vector<unsigned long> bitlen(288, 0), bitlenD(32, 0);
+					size_t HLIT = reader.readBits(5) + 257; //number of literal/length codes + 257
+					size_t HDIST = reader.readBits(5) + 1; //number of dist codes + 1
+					size_t HCLEN = reader.readBits(4) + 4; //number of code length codes + 4
+					std::vector<unsigned long> codelengthcode(19); //lengths of tree to decode the lengths of the dynamic tree
+					for (size_t i = 0; i < 19; i++) codelengthcode[CLCL[i]] = (i < HCLEN) ? reader.readBits(3) : 0;
+					if (reader.overrun()) { error = 49; return; } //the bit pointer is or will go past the memory
+					error = codelengthcodetree.makeFromLengths(codelengthcode, 7, 7); if (error) return;
+					size_t i = 0, replength;
+					while (i < HLIT + HDIST)
+					{
+						reader.refill();
+						unsigned long code = huffmanDecodeSymbol(codelengthcodetree); if (error) return;
+						if (code <= 15) { if (i < HLIT) bitlen[i++] = code; else bitlenD[i++ - HLIT] = code; } //a length code
+						else if (code == 16) //repeat previous
+						{
+							if (i == 0) { error = 54; return; } //error: there is no previous length to repeat
+							replength = 3 + reader.bits(2);
+							unsigned long value; //set value to the previous code
+							if ((i - 1) < HLIT) value = bitlen[i - 1];
+							else value = bitlenD[i - HLIT - 1];
+							for (size_t n = 0; n < replength; n++) //repeat this value in the next lengths
+							{
+								if (i >= HLIT + HDIST) { error = 13; return; } //error: i is larger than the amount of codes
+								if (i < HLIT) bitlen[i++] = value; else bitlenD[i++ - HLIT] = value;
+							}
+						}
+						else if (code == 17) //repeat "0" 3-10 times
+						{
+							replength = 3 + reader.bits(3);
+							for (size_t n = 0; n < replength; n++) //repeat this value in the next lengths
+							{
+								if (i >= HLIT + HDIST) { error = 14; return; } //error: i is larger than the amount of codes
+								if (i < HLIT) bitlen[i++] = 0; else bitlenD[i++ - HLIT] = 0;
+							}
+						}
+						else if (code == 18) //repeat "0" 11-138 times
+						{
+							replength = 11 + reader.bits(7);
+							for (size_t n = 0; n < replength; n++) //repeat this value in the next lengths
+							{
+								if (i >= HLIT + HDIST) { error = 15; return; } //error: i is larger than the amount of codes
+								if (i < HLIT) bitlen[i++] = 0; else bitlenD[i++ - HLIT] = 0;
+							}
+						}
+						else { error = 16; return; } //error: somehow an unexisting code appeared. This can never happen.
+						if (reader.overrun()) { error = 50; return; } //error, bit pointer jumps past memory
+					}
+					if (bitlen[256] == 0) { error = 64; return; } //the length of the end code 256 must be larger than 0
+					error = tree.makeFromLengths(bitlen, 15, 10); if (error) return; //now we've finally got HLIT and HDIST, so generate the code trees, and the function is done
+					error = treeD.makeFromLengths(bitlenD, 15, 8); if (error) return;
+				}
+				void inflateHuffmanBlock(std::vector<unsigned char>& out, size_t& pos, unsigned long btype)
+				{
+					if (btype == 1) { generateFixedTrees(codetree, codetreeD); }
+					else if (btype == 2) { getTreeInflateDynamic(codetree, codetreeD); if (error) return; }
+					for (;;)
+					{
+						reader.refill(); //a length code, its extra bits, the distance code and its extra bits are at most 48 bits
+						if (reader.overrun()) { error = 10; return; } //error: end reached without endcode
+						unsigned long code = huffmanDecodeSymbol(codetree); if (error) return;
+						if (code == 256) return; //end code
+						else if (code <= 255) //literal symbol
+						{
+							if (pos >= out.size()) out.resize((pos + 1) * 2); //reserve more room
+							out[pos++] = (unsigned char)(code);
+						}
+						else if (code >= 257 && code <= 285) //length code
+						{
+							size_t length = LENBASE[code - 257] + reader.bits((unsigned)LENEXTRA[code - 257]);
+							unsigned long codeD = huffmanDecodeSymbol(codetreeD); if (error) return;
+							if (codeD > 29) { error = 18; return; } //error: invalid dist code (30-31 are never used)
+							size_t dist = DISTBASE[codeD] + reader.bits((unsigned)DISTEXTRA[codeD]);
+							if (dist > pos) { error = 52; return; } //error: the distance reaches back past the start of the output
+							if (pos + length >= out.size()) out.resize((pos + length) * 2); //reserve more room
+							unsigned char* dst = &out[pos];
+							const unsigned char* src = dst - dist;
+							if (dist >= 8 && pos + length + 8 <= out.size()) for (size_t i = 0; i < length; i += 8) memcpy(dst + i, src + i, 8); //unchecked, may write up to 7 bytes past the match that later output replaces
+							else if (dist == 1) memset(dst, *src, length);
+							else for (size_t i = 0; i < length; i++) dst[i] = src[i]; //overlapping, repeats the last dist bytes
+							pos += length;
+						}
+						else { error = 16; return; } //error: 286 and 287 are never used
+					}
+				}
+				void inflateNoCompression(std::vector<unsigned char>& out, size_t& pos)
+				{
+					reader.alignToByte(); //go to first boundary of byte
+					size_t p = reader.bytePos(), inlength = reader.size;
+					if (p + 4 > inlength) { error = 52; return; } //error, bit pointer will jump past memory
+					const unsigned char* in = reader.in;
+					unsigned long LEN = in[p] + 256 * in[p + 1], NLEN = in[p + 2] + 256 * in[p + 3]; p += 4;
+					if (LEN + NLEN != 65535) { error = 21; return; } //error: NLEN is not one's complement of LEN
+					if (pos + LEN >= out.size()) out.resize(pos + LEN);
+					if (p + LEN > inlength) { error = 23; return; } //error: reading outside of in buffer
+					if (LEN) memcpy(&out[pos], in + p, LEN); //read LEN bytes of literal data
+					pos += LEN; p += LEN;
+					reader.seek(p);
+				}
+			};
+			int decompress(std::vector<unsigned char>& out, const std::vector<unsigned char>& in) //returns error value
+			{
+				Inflator inflator;
+				if (in.size() < 2) { return 53; } //error, size of zlib data too small
+				if ((in[0] * 256 + in[1]) % 31 != 0) { return 24; } //error: 256 * in[0] + in[1] must be a multiple of 31, the FCHECK value is supposed to be made that way
+				unsigned long CM = in[0] & 15, CINFO = (in[0] >> 4) & 15, FDICT = (in[1] >> 5) & 1;
+				if (CM != 8 || CINFO > 7) { return 25; } //error: only compression method 8: inflate with sliding window of 32k is supported by the PNG spec
+				if (FDICT != 0) { return 26; } //error: the specification of PNG says about the zlib stream: "The additional flags shall not specify a preset dictionary."
+				inflator.inflate(out, in, 2);
+				return inflator.error; //note: adler32 checksum was skipped and ignored
+			}
+		};
+		struct PNG //nested functions for PNG decoding
+		{
+			struct Info
+			{
+				unsigned long width, height, colorType, bitDepth, compressionMethod, filterMethod, interlaceMethod, key_r, key_g, key_b;
+				bool key_defined; //is a transparent color key given?
+				std::vector<unsigned char> palette;
+			} info;
+			int error;
+			void decode(std::vector<unsigned char>& out, const unsigned char* in, size_t size, bool convert_to_rgba32)
+			{
+				std::vector<unsigned char> idat; //the data from idat chunks
+				readChunks(idat, in, size); if (error) return;
+				unsigned long bpp = getBpp(info);
+				std::vector<unsigned char> scanlines(((info.width * (info.height * bpp + 7)) / 8) + info.height); //now the out buffer will be filled
+				Zlib zlib; //decompress with the Zlib decompressor
+				error = zlib.decompress(scanlines, idat); if (error) return; //stop if the zlib decompressor returned an error
+				size_t bytewidth = (bpp + 7) / 8, outlength = (info.height * info.width * bpp + 7) / 8;
+				out.resize(outlength); //time to fill the out buffer
+				unsigned char* out_ = outlength ? &out[0] : 0; //use a regular pointer to the std::vector for faster code if compiled without optimization
+				if (info.interlaceMethod == 0) //no interlace, just filter
+				{
+					size_t linestart = 0, linelength = (info.width * bpp + 7) / 8; //length in bytes of a scanline, excluding the filtertype byte
+					if (scanlines.size() < info.height * (1 + linelength)) { error = 70; return; } //error: the zlib stream ended before all scanlines were decoded
+					if (bpp >= 8) //byte per byte
+						for (unsigned long y = 0; y < info.height; y++)
+						{
+							unsigned long filterType = scanlines[linestart];
+							const unsigned char* prevline = (y == 0) ? 0 : &out_[(y - 1) * info.width * bytewidth];
+							unFilterScanline(&out_[linestart - y], &scanlines[linestart + 1], prevline, bytewidth, filterType, linelength); if (error) return;
+							linestart += (1 + linelength); //go to start of next scanline
+						}
+					else //less than 8 bits per pixel, so fill it up bit per bit
+					{
+						std::vector<unsigned char> templine((info.width * bpp + 7) >> 3), prevtempline(templine.size()); //only used if bpp < 8
+						for (size_t y = 0, obp = 0; y < info.height; y++)
+						{
+							unsigned long filterType = scanlines[linestart];
+							const unsigned char* prevline = (y == 0) ? 0 : &prevtempline[0]; //the previous unfiltered line, out_ isn't byte aligned per line below 8 bits per pixel
+							unFilterScanline(&templine[0], &scanlines[linestart + 1], prevline, bytewidth, filterType, linelength); if (error) return;
+							for (size_t bp = 0; bp < info.width * bpp;) setBitOfReversedStream(obp, out_, readBitFromReversedStream(bp, &templine[0]));
+							templine.swap(prevtempline);
+							linestart += (1 + linelength); //go to start of next scanline
+						}
+					}
+				}
+				else //interlaceMethod is 1 (Adam7)
+				{
+					size_t passw[7] = { (info.width + 7) / 8, (info.width + 3) / 8, (info.width + 3) / 4, (info.width + 1) / 4, (info.width + 1) / 2, (info.width + 0) / 2, (info.width + 0) / 1 };
+					size_t passh[7] = { (info.height + 7) / 8, (info.height + 7) / 8, (info.height + 3) / 8, (info.height + 3) / 4, (info.height + 1) / 4, (info.height + 1) / 2, (info.height + 0) / 2 };
+					size_t passstart[7] = { 0 };
+					size_t pattern[28] = { 0,4,0,2,0,1,0,0,0,4,0,2,0,1,8,8,4,4,2,2,1,8,8,8,4,4,2,2 }; //values for the adam7 passes
+					for (int i = 0; i < 6; i++) passstart[i + 1] = passstart[i] + passh[i] * ((passw[i] ? 1 : 0) + (passw[i] * bpp + 7) / 8);
+					if (scanlines.size() < passstart[6] + passh[6] * ((passw[6] ? 1 : 0) + (passw[6] * bpp + 7) / 8)) { error = 70; return; } //error: the zlib stream ended before all passes were decoded
+					std::vector<unsigned char> scanlineo((info.width * bpp + 7) / 8), scanlinen((info.width * bpp + 7) / 8); //"old" and "new" scanline
+					for (int i = 0; i < 7; i++)
+						adam7Pass(&out_[0], &scanlinen[0], &scanlineo[0], &scanlines[passstart[i]], info.width, pattern[i], pattern[i + 7], pattern[i + 14], pattern[i + 21], passw[i], passh[i], bpp);
+				}
+				if (convert_to_rgba32 && (info.colorType != 6 || info.bitDepth != 8)) //conversion needed
+				{
+					std::vector<unsigned char> data;
+					data.swap(out); //the unfiltered image becomes the input of convert, no need to copy it
+					error = convert(out, &data[0], info, info.width, info.height);
+				}
+			}
+			void decodeInto(std::vector<unsigned char>& out, const unsigned char* in, size_t size, PixelFormat format, bool flipY, DecodeBuffers& buffers)
+			{ //like decode, but every line goes to its place in out in the final format as soon as it's unfiltered
+				buffers.idat.clear();
+				readChunks(buffers.idat, in, size); if (error) return;
+				unsigned long bpp = getBpp(info);
+				size_t bytewidth = (bpp + 7) / 8, linelength = (info.width * bpp + 7) / 8;
+				size_t rowsize = info.width * (format == PixelRGBA8888 ? 4 : format == PixelRGB888 ? 3 : 2);
+				buffers.scanlines.resize(((info.width * (info.height * bpp + 7)) / 8) + info.height);
+				Zlib zlib;
+				error = zlib.decompress(buffers.scanlines, buffers.idat); if (error) return;
+				out.resize(info.height * rowsize);
+				if (out.empty()) return;
+				if (format != PixelRGBA8888) buffers.rgba.resize(info.width * 4);
+				if (info.interlaceMethod == 0)
+				{
+					if (buffers.scanlines.size() < info.height * (1 + linelength)) { error = 70; return; } //error: the zlib stream ended before all scanlines were decoded
+					bool direct = format == PixelRGBA8888 && info.colorType == 6 && info.bitDepth == 8; //then the unfiltered lines are the final pixels, unfilter right into out
+					if (!direct) buffers.lines.resize(2 * linelength);
+					unsigned char* lines[2] = { direct ? 0 : &buffers.lines[0], direct ? 0 : &buffers.lines[linelength] };
+					const unsigned char* prevline = 0;
+					for (unsigned long y = 0; y < info.height; y++)
+					{
+						unsigned char* row = &out[(flipY ? info.height - 1 - y : y) * rowsize];
+						unsigned char* recon = direct ? row : lines[y & 1];
+						const unsigned char* scanline = &buffers.scanlines[y * (1 + linelength)];
+						unFilterScanline(recon, scanline + 1, prevline, bytewidth, scanline[0], linelength); if (error) return;
+						if (!direct) { writeRow(row, recon, 0, format, buffers); if (error) return; }
+						prevline = recon;
+					}
+				}
+				else //Adam7 scatters every pass over the image, so it's unfiltered whole first
+				{
+					size_t passw[7] = { (info.width + 7) / 8, (info.width + 3) / 8, (info.width + 3) / 4, (info.width + 1) / 4, (info.width + 1) / 2, (info.width + 0) / 2, (info.width + 0) / 1 };
+					size_t passh[7] = { (info.height + 7) / 8, (info.height + 7) / 8, (info.height + 3) / 8, (info.height + 3) / 4, (info.height + 1) / 4, (info.height + 1) / 2, (info.height + 0) / 2 };
+					size_t passstart[7] = { 0 };
+					size_t pattern[28] = { 0,4,0,2,0,1,0,0,0,4,0,2,0,1,8,8,4,4,2,2,1,8,8,8,4,4,2,2 }; //values for the adam7 passes
+					for (int i = 0; i < 6; i++) passstart[i + 1] = passstart[i] + passh[i] * ((passw[i] ? 1 : 0) + (passw[i] * bpp + 7) / 8);
+					if (buffers.scanlines.size() < passstart[6] + passh[6] * ((passw[6] ? 1 : 0) + (passw[6] * bpp + 7) / 8)) { error = 70; return; } //error: the zlib stream ended before all passes were decoded
+					buffers.lines.assign((info.height * info.width * bpp + 7) / 8, 0); //cleared, below 8 bits per pixel the passes are or'ed in
+					std::vector<unsigned char> scanlineo(linelength), scanlinen(linelength); //"old" and "new" scanline
+					for (int i = 0; i < 7; i++)
+						adam7Pass(&buffers.lines[0], &scanlinen[0], &scanlineo[0], &buffers.scanlines[passstart[i]], info.width, pattern[i], pattern[i + 7], pattern[i + 14], pattern[i + 21], passw[i], passh[i], bpp);
+					for (unsigned long y = 0; y < info.height; y++)
+					{
+						writeRow(&out[(flipY ? info.height - 1 - y : y) * rowsize], &buffers.lines[0], y * info.width * bpp, format, buffers); if (error) return;
+					}
+				}
+			}
+			void writeRow(unsigned char* row, const unsigned char* in, size_t firstBit, PixelFormat format, DecodeBuffers& buffers)
+			{ //converts one line of unfiltered pixels, starting firstBit bits into in, to the output format
+				unsigned char* rgba = format == PixelRGBA8888 ? row : &buffers.rgba[0];
+				error = convertPixels(rgba, in, firstBit, info, info.width); if (error) return;
+				if (format == PixelRGB888) for (size_t i = 0; i < info.width; i++) for (size_t c = 0; c < 3; c++) row[3 * i + c] = rgba[4 * i + c];
+				else if (format == PixelRGB565)
+					for (size_t i = 0; i < info.width; i++)
+					{
+						unsigned short pixel = (unsigned short)(((rgba[4 * i + 0] >> 3) << 11) | ((rgba[4 * i + 1] >> 2) << 5) | (rgba[4 * i + 2] >> 3));
+						memcpy(&row[2 * i], &pixel, 2);
+					}
+			}
+			void readChunks(std::vector<unsigned char>& idat, const unsigned char* in, size_t size) //reads the header and palette, and gathers the image data
+			{
+				error = 0;
+				if (size == 0 || in == 0) { error = 48; return; } //the given data is empty
+				readPngHeader(&in[0], size); if (error) return;
+				size_t pos = 33; //first byte of the first chunk after the header
+				bool IEND = false;// , known_type = true;
+				info.key_defined = false;
+				while (!IEND) //loop through the chunks, ignoring unknown chunks and stopping at IEND chunk. IDAT data is put at the start of the in buffer
+				{
+					if (pos + 8 >= size) { error = 30; return; } //error: size of the in buffer too small to contain next chunk
+					size_t chunkLength = read32bitInt(&in[pos]); pos += 4;
+					if (chunkLength > 2147483647) { error = 63; return; }
+					if (pos + chunkLength >= size) { error = 35; return; } //error: size of the in buffer too small to contain next chunk
+					if (in[pos + 0] == 'I' && in[pos + 1] == 'D' && in[pos + 2] == 'A' && in[pos + 3] == 'T') //IDAT chunk, containing compressed image data
+					{
+						idat.insert(idat.end(), &in[pos + 4], &in[pos + 4 + chunkLength]);
+						pos += (4 + chunkLength);
+					}
+					else if (in[pos + 0] == 'I' && in[pos + 1] == 'E' && in[pos + 2] == 'N' && in[pos + 3] == 'D') { pos += 4; IEND = true; }
+					else if (in[pos + 0] == 'P' && in[pos + 1] == 'L' && in[pos + 2] == 'T' && in[pos + 3] == 'E') //palette chunk (PLTE)
+					{
+						pos += 4; //go after the 4 letters
+						info.palette.resize(4 * (chunkLength / 3));
+						if (info.palette.size() > (4 * 256)) { error = 38; return; } //error: palette too big
+						for (size_t i = 0; i < info.palette.size(); i += 4)
+						{
+							for (size_t j = 0; j < 3; j++) info.palette[i + j] = in[pos++]; //RGB
+							info.palette[i + 3] = 255; //alpha
+						}
+					}
+					else if (in[pos + 0] == 't' && in[pos + 1] == 'R' && in[pos + 2] == 'N' && in[pos + 3] == 'S') //palette transparency chunk (tRNS)
+					{
+						pos += 4; //go after the 4 letters
+						if (info.colorType == 3)
+						{
+							if (4 * chunkLength > info.palette.size()) { error = 39; return; } //error: more alpha values given than there are palette entries
+							for (size_t i = 0; i < chunkLength; i++) info.palette[4 * i + 3] = in[pos++];
+						}
+						else if (info.colorType == 0)
+						{
+							if (chunkLength != 2) { error = 40; return; } //error: this chunk must be 2 bytes for greyscale image
+							info.key_defined = 1; info.key_r = info.key_g = info.key_b = 256 * in[pos] + in[pos + 1]; pos += 2;
+						}
+						else if (info.colorType == 2)
+						{
+							if (chunkLength != 6) { error = 41; return; } //error: this chunk must be 6 bytes for RGB image
+							info.key_defined = 1;
+							info.key_r = 256 * in[pos] + in[pos + 1]; pos += 2;
+							info.key_g = 256 * in[pos] + in[pos + 1]; pos += 2;
+							info.key_b = 256 * in[pos] + in[pos + 1]; pos += 2;
+						}
+						else { error = 42; return; } //error: tRNS chunk not allowed for other color models
+					}
+					else //it's not an implemented chunk type, so ignore it: skip over the data
+					{
+						if (!(in[pos + 0] & 32)) { error = 69; return; } //error: unknown critical chunk (5th bit of first byte of chunk type is 0)
+						pos += (chunkLength + 4); //skip 4 letters and uninterpreted data of unimplemented chunk
+						//known_type = false;
+					}
+					pos += 4; //step over CRC (which is ignored)
+				}
+			}
+			void readPngHeader(const unsigned char* in, size_t inlength) //read the information from the header and store it in the Info
+			{
+				if (inlength < 29) { error = 27; return; } //error: the data length is smaller than the length of the header
+				if (in[0] != 137 || in[1] != 80 || in[2] != 78 || in[3] != 71 || in[4] != 13 || in[5] != 10 || in[6] != 26 || in[7] != 10) { error = 28; return; } //no PNG signature
+				if (in[12] != 'I' || in[13] != 'H' || in[14] != 'D' || in[15] != 'R') { error = 29; return; } //error: it doesn't start with a IHDR chunk!
+				info.width = read32bitInt(&in[16]); info.height = read32bitInt(&in[20]);
+				info.bitDepth = in[24]; info.colorType = in[25];
+				info.compressionMethod = in[26]; if (in[26] != 0) { error = 32; return; } //error: only compression method 0 is allowed in the specification
+				info.filterMethod = in[27]; if (in[27] != 0) { error = 33; return; } //error: only filter method 0 is allowed in the specification
+				info.interlaceMethod = in[28]; if (in[28] > 1) { error = 34; return; } //error: only interlace methods 0 and 1 exist in the specification
+				error = checkColorValidity(info.colorType, info.bitDepth);
+			}
+			void unFilterScanline(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon, size_t bytewidth, unsigned long filterType, size_t length)
+			{
+#if defined(PICO_SIMD_SSE2) || defined(PICO_SIMD_NEON)
+				if (simd::unFilterScanline(recon, scanline, precon, bytewidth, filterType, length)) return;
+#endif
+				switch (filterType)
+				{
+				case 0: for (size_t i = 0; i < length; i++) recon[i] = scanline[i]; break;
+				case 1:
+					for (size_t i = 0; i < bytewidth; i++) recon[i] = scanline[i];
+					for (size_t i = bytewidth; i < length; i++) recon[i] = scanline[i] + recon[i - bytewidth];
+					break;
+				case 2:
+					if (precon) for (size_t i = 0; i < length; i++) recon[i] = scanline[i] + precon[i];
+					else       for (size_t i = 0; i < length; i++) recon[i] = scanline[i];
+					break;
+				case 3:
+					if (precon)
+					{
+						for (size_t i = 0; i < bytewidth; i++) recon[i] = scanline[i] + precon[i] / 2;
+						for (size_t i = bytewidth; i < length; i++) recon[i] = scanline[i] + ((recon[i - bytewidth] + precon[i]) / 2);
+					}
+					else
+					{
+						for (size_t i = 0; i < bytewidth; i++) recon[i] = scanline[i];
+						for (size_t i = bytewidth; i < length; i++) recon[i] = scanline[i] + recon[i - bytewidth] / 2;
+					}
+					break;
+				case 4:
+					if (precon)
+					{
+						for (size_t i = 0; i < bytewidth; i++) recon[i] = scanline[i] + paethPredictor(0, precon[i], 0);
+						for (size_t i = bytewidth; i < length; i++) recon[i] = scanline[i] + paethPredictor(recon[i - bytewidth], precon[i], precon[i - bytewidth]);
+					}
+					else
+					{
+						for (size_t i = 0; i < bytewidth; i++) recon[i] = scanline[i];
+						for (size_t i = bytewidth; i < length; i++) recon[i] = scanline[i] + paethPredictor(recon[i - bytewidth], 0, 0);
+					}
+					break;
+				default: error = 36; return; //error: unexisting filter type given
+				}
+			}
+			void adam7Pass(unsigned char* out, unsigned char* linen, unsigned char* lineo, const unsigned char* in, unsigned long w, size_t passleft, size_t passtop, size_t spacex, size_t spacey, size_t passw, size_t passh, unsigned long bpp)
+			{ //filter and reposition the pixels into the output when the image is Adam7 interlaced. This function can only do it after the full image is already decoded. The out buffer must have the correct allocated memory size already.
+				if (passw == 0) return;
+				size_t bytewidth = (bpp + 7) / 8, linelength = 1 + ((bpp * passw + 7) / 8);
+				for (unsigned long y = 0; y < passh; y++)
+				{
+					unsigned char filterType = in[y * linelength], *prevline = (y == 0) ? 0 : lineo;
+					unFilterScanline(linen, &in[y * linelength + 1], prevline, bytewidth, filterType, (w * bpp + 7) / 8); if (error) return;
+					if (bpp >= 8) for (size_t i = 0; i < passw; i++) for (size_t b = 0; b < bytewidth; b++) //b = current byte of this pixel
+						out[bytewidth * w * (passtop + spacey * y) + bytewidth * (passleft + spacex * i) + b] = linen[bytewidth * i + b];
+					else for (size_t i = 0; i < passw; i++)
+					{
+						size_t obp = bpp * w * (passtop + spacey * y) + bpp * (passleft + spacex * i), bp = i * bpp;
+						for (size_t b = 0; b < bpp; b++) setBitOfReversedStream(obp, out, readBitFromReversedStream(bp, &linen[0]));
+					}
+					unsigned char* temp = linen; linen = lineo; lineo = temp; //swap the two buffer pointers "line old" and "line new"
+				}
+			}
+			static unsigned long readBitFromReversedStream(size_t& bitp, const unsigned char* bits) { unsigned long result = (bits[bitp >> 3] >> (7 - (bitp & 0x7))) & 1; bitp++; return result; }
+			static unsigned long readBitsFromReversedStream(size_t& bitp, const unsigned char* bits, unsigned long nbits)
+			{
+				unsigned long result = 0;
+				for (size_t i = nbits - 1; i < nbits; i--) result += ((readBitFromReversedStream(bitp, bits)) << i);
+				return result;
+			}
+			void setBitOfReversedStream(size_t& bitp, unsigned char* bits, unsigned long bit) { bits[bitp >> 3] |= (bit << (7 - (bitp & 0x7))); bitp++; }
+			unsigned long read32bitInt(const unsigned char* buffer) { return (buffer[0] << 24) | (buffer[1] << 16) | (buffer[2] << 8) | buffer[3]; }
+			int checkColorValidity(unsigned long colorType, unsigned long bd) //return type is a LodePNG error code
+			{
+				if ((colorType == 2 || colorType == 4 || colorType == 6)) { if (!(bd == 8 || bd == 16)) return 37; else return 0; }
+				else if (colorType == 0) { if (!(bd == 1 || bd == 2 || bd == 4 || bd == 8 || bd == 16)) return 37; else return 0; }
+				else if (colorType == 3) { if (!(bd == 1 || bd == 2 || bd == 4 || bd == 8)) return 37; else return 0; }
+				else return 31; //unexisting color type
+			}
+			unsigned long getBpp(const Info& info)
+			{
+				if (info.colorType == 2) return (3 * info.bitDepth);
+				else if (info.colorType >= 4) return (info.colorType - 2) * info.bitDepth;
+				else return info.bitDepth;
+			}
+			int convert(std::vector<unsigned char>& out, const unsigned char* in, Info& infoIn, unsigned long w, unsigned long h)
+			{ //converts from any color type to 32-bit. return value = LodePNG error code
+				out.resize(w * h * 4);
+				return convertPixels(out.empty() ? 0 : &out[0], in, 0, infoIn, w * h);
+			}
+			int convertPixels(unsigned char* out_, const unsigned char* in, size_t firstBit, Info& infoIn, size_t numpixels)
+			{ //converts numpixels starting firstBit bits into in to 32-bit. return value = LodePNG error code
+				size_t bp = firstBit;
+				if (infoIn.bitDepth >= 8) in += firstBit / 8;
+				if (infoIn.bitDepth == 8 && infoIn.colorType == 0) //greyscale
+					for (size_t i = 0; i < numpixels; i++)
+					{
+						out_[4 * i + 0] = out_[4 * i + 1] = out_[4 * i + 2] = in[i];
+						out_[4 * i + 3] = (infoIn.key_defined && in[i] == infoIn.key_r) ? 0 : 255;
+					}
+				else if (infoIn.bitDepth == 8 && infoIn.colorType == 2) //RGB color
+					for (size_t i = 0; i < numpixels; i++)
+					{
+						for (size_t c = 0; c < 3; c++) out_[4 * i + c] = in[3 * i + c];
+						out_[4 * i + 3] = (infoIn.key_defined == 1 && in[3 * i + 0] == infoIn.key_r && in[3 * i + 1] == infoIn.key_g && in[3 * i + 2] == infoIn.key_b) ? 0 : 255;
+					}
+				else if (infoIn.bitDepth == 8 && infoIn.colorType == 3) //indexed color (palette)
+					for (size_t i = 0; i < numpixels; i++)
+					{
+						if (4U * in[i] >= infoIn.palette.size()) return 46;
+						for (size_t c = 0; c < 4; c++) out_[4 * i + c] = infoIn.palette[4 * in[i] + c]; //get rgb colors from the palette
+					}
+				else if (infoIn.bitDepth == 8 && infoIn.colorType == 4) //greyscale with alpha
+					for (size_t i = 0; i < numpixels; i++)
+					{
+						out_[4 * i + 0] = out_[4 * i + 1] = out_[4 * i + 2] = in[2 * i + 0];
+						out_[4 * i + 3] = in[2 * i + 1];
+					}
+				else if (infoIn.bitDepth == 8 && infoIn.colorType == 6) for (size_t i = 0; i < numpixels; i++) for (size_t c = 0; c < 4; c++) out_[4 * i + c] = in[4 * i + c]; //RGB with alpha
+				else if (infoIn.bitDepth == 16 && infoIn.colorType == 0) //greyscale
+					for (size_t i = 0; i < numpixels; i++)
+					{
+						out_[4 * i + 0] = out_[4 * i + 1] = out_[4 * i + 2] = in[2 * i];
+						out_[4 * i + 3] = (infoIn.key_defined && 256U * in[2 * i] + in[2 * i + 1] == infoIn.key_r) ? 0 : 255;
+					}
+				else if (infoIn.bitDepth == 16 && infoIn.colorType == 2) //RGB color
+					for (size_t i = 0; i < numpixels; i++)
+					{
+						for (size_t c = 0; c < 3; c++) out_[4 * i + c] = in[6 * i + 2 * c];
+						out_[4 * i + 3] = (infoIn.key_defined && 256U*in[6 * i + 0] + in[6 * i + 1] == infoIn.key_r && 256U*in[6 * i + 2] + in[6 * i + 3] == infoIn.key_g && 256U*in[6 * i + 4] + in[6 * i + 5] == infoIn.key_b) ? 0 : 255;
+					}
+				else if (infoIn.bitDepth == 16 && infoIn.colorType == 4) //greyscale with alpha
+					for (size_t i = 0; i < numpixels; i++)
+					{
+						out_[4 * i + 0] = out_[4 * i + 1] = out_[4 * i + 2] = in[4 * i]; //most significant byte
+						out_[4 * i + 3] = in[4 * i + 2];
+					}
+				else if (infoIn.bitDepth == 16 && infoIn.colorType == 6) for (size_t i = 0; i < numpixels; i++) for (size_t c = 0; c < 4; c++) out_[4 * i + c] = in[8 * i + 2 * c]; //RGB with alpha
+				else if (infoIn.bitDepth < 8 && infoIn.colorType == 0) //greyscale
+					for (size_t i = 0; i < numpixels; i++)
+					{
+						unsigned long value = (readBitsFromReversedStream(bp, in, infoIn.bitDepth) * 255) / ((1 << infoIn.bitDepth) - 1); //scale value from 0 to 255
+						out_[4 * i + 0] = out_[4 * i + 1] = out_[4 * i + 2] = (unsigned char)(value);
+						out_[4 * i + 3] = (infoIn.key_defined && value && ((1U << infoIn.bitDepth) - 1U) == infoIn.key_r && ((1U << infoIn.bitDepth) - 1U)) ? 0 : 255;
+					}
+				else if (infoIn.bitDepth < 8 && infoIn.colorType == 3) //palette
+					for (size_t i = 0; i < numpixels; i++)
+					{
+						unsigned long value = readBitsFromReversedStream(bp, in, infoIn.bitDepth);
+						if (4 * value >= infoIn.palette.size()) return 47;
+						for (size_t c = 0; c < 4; c++) out_[4 * i + c] = infoIn.palette[4 * value + c]; //get rgb colors from the palette
+					}
+				return 0;
+			}
+			unsigned char paethPredictor(short a, short b, short c) //Paeth predicter, used by PNG filter type 4
+			{
+				short p = a + b - c, pa = p > a ? (p - a) : (a - p), pb = p > b ? (p - b) : (b - p), pc = p > c ? (p - c) : (c - p);
+				return (unsigned char)((pa <= pb && pa <= pc) ? a : pb <= pc ? b : c);
+			}
+		};
+		PNG decoder;
+		if (buffers) decoder.decodeInto(out_image, in_png, in_size, format, flip_y, *buffers);
+		else decoder.decode(out_image, in_png, in_size, convert_to_rgba32);
+		image_width = decoder.info.width; image_height = decoder.info.height;
+		return decoder.error;
+	}
+
+	/*
+	decodePNG: The picoPNG function, decodes a PNG file buffer in memory, into a raw pixel buffer.
+	out_image: output parameter, this will contain the raw pixels after decoding.
+	  By default the output is 32-bit RGBA color.
+	  The std::vector is automatically resized to the correct size.
+	image_width: output_parameter, this will contain the width of the image in pixels.
+	image_height: output_parameter, this will contain the height of the image in pixels.
+	in_png: pointer to the buffer of the PNG file in memory. To get it from a file on
+	  disk, load it and store it in a memory buffer yourself first.
+	in_size: size of the input PNG file in bytes.
+	convert_to_rgba32: optional parameter, true by default.
+	  Set to true to get the output in RGBA 32-bit (8 bit per channel) color format
+	  no matter what color type the original PNG image had. This gives predictable,
+	  useable data from any random input PNG.
+	  Set to false to do no color conversion at all. The result then has the same data
+	  type as the PNG image, which can range from 1 bit to 64 bits per pixel.
+	  Information about the color type or palette colors are not provided. You need
+	  to know this information yourself to be able to use the data so this only
+	  works for trusted PNG files. Use LodePNG instead of picoPNG if you need this information.
+	return: 0 if success, not 0 if some error occured.
+	*/
+	int decodePNG(std::vector<unsigned char>& out_image, unsigned long& image_width, unsigned long& image_height, const unsigned char* in_png, size_t in_size, bool convert_to_rgba32)
+	{
+		return decodeImage(out_image, image_width, image_height, in_png, in_size, convert_to_rgba32, PixelRGBA8888, false, 0);
+	}
+
+	int decodePNG(std::vector<unsigned char>& out_image, unsigned long& image_width, unsigned long& image_height, const unsigned char* in_png, size_t in_size, PixelFormat format, bool flip_y, DecodeBuffers& buffers)
+	{
+		return decodeImage(out_image, image_width, image_height, in_png, in_size, true, format, flip_y, &buffers);
+	}
+
+
+
+
+
+	//an example using the PNG loading function:
+	//
+	//#include <iostream>
+	//#include <fstream>
+	//
+	//void loadFile(std::vector<unsigned char>& buffer, const std::string& filename) //designed for loading files from hard disk in an std::vector
+	//{
+	//  std::ifstream file(filename.c_str(), std::ios::in|std::ios::binary|std::ios::ate);
+	//
+	//  //get filesize
+	//  std::streamsize size = 0;
+	//  if(file.seekg(0, std::ios::end).good()) size = file.tellg();
+	//  if(file.seekg(0, std::ios::beg).good()) size -= file.tellg();
+	//
+	//  //read contents of the file into the vector
+	//  if(size > 0)
+	//  {
+	//    buffer.resize((size_t)size);
+	//    file.read((char*)(&buffer[0]), size);
+	//  }
+	//  else buffer.clear();
+	//}
+	//
+	//int main(int argc, char *argv[])
+	//{
+	//  const char* filename = argc > 1 ? argv[1] : "test.png";
+	//
+	//  //load and decode
+	//  std::vector<unsigned char> buffer, image;
+	//  loadFile(buffer, filename);
+	//  unsigned long w, h;
+	//  int error = decodePNG(image, w, h, buffer.empty() ? 0 : &buffer[0], (unsigned long)buffer.size());
+	//
+	//  //if there's an error, display it
+	//  if(error != 0) std::cout << "error: " << error << std::endl;
+	//
+	//  //the pixels are now in the vector "image", use it as texture, draw it, ...
+	//
+	//  if(image.size() > 4) std::cout << "width: " << w << " height: " << h << " first pixel: " << std::hex << int(image[0]) << int(image[1]) << int(image[2]) << int(image[3]) << std::endl;
+	//}
+
+	/*
+	  //this is test code, it displays the pixels of a 1 bit PNG. To use it, set the flag convert_to_rgba32 to false and load a 1-bit PNG image with a small size (so that its ASCII representation can fit in a console window)
+	  for(int y = 0; y < h; y++)
+	  {
+		for(int x = 0; x < w; x++)
+		{
+		  int i = y * h + x;
+		  std::cout << (((image[i/8] >> (7-i%8)) & 1) ? '.' : '#');
+		}
+		std::cout << std::endl;
+	  }
+	*/
+
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+namespace pico
+{
+	int decodePNG(std::vector<unsigned char>& out_image, unsigned long& image_width, unsigned long& image_height, const unsigned char* in_png, size_t in_size, bool convert_to_rgba32 = true);
+
+	//Pixel layouts the buffered decodePNG writes, 565 is a native endian unsigned short as GL_UNSIGNED_SHORT_5_6_5 wants it
+	enum PixelFormat { PixelRGBA8888, PixelRGB888, PixelRGB565 };
+
+	//Working memory of the buffered decodePNG. Decoding several images with the same one reuses its allocations.
+	struct DecodeBuffers
+	{
+		std::vector<unsigned char> idat; //the concatenated IDAT chunks
+		std::vector<unsigned char> scanlines; //the inflated, still filtered image
+		std::vector<unsigned char> lines; //the current and previous unfiltered line, or the whole unfiltered image when interlaced
+		std::vector<unsigned char> rgba; //one line of RGBA when the format is another one
+	};
+
+	//Decodes into out_image in the given format, converting each line as soon as it's unfiltered so only out_image
+	//holds the whole image. flip_y stores the rows bottom-up, the way glTexImage2D expects them.
+	int decodePNG(std::vector<unsigned char>& out_image, unsigned long& image_width, unsigned long& image_height, const unsigned char* in_png, size_t in_size, PixelFormat format, bool flip_y, DecodeBuffers& buffers);
+}